@@ -0,0 +1,335 @@
+//
+//  RangeDecoderBench.c
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Cost of the always on audio decode (RangeSignalDecoder), on synthetic Range signals.
+// NOTE: RangeSignalDecoder's protocol is a placeholder, and the signals here come from its own encoder
+// (range_signal_encode_frame). The numbers say nothing about decoding what a shipping Range sends,
+// or about the decoder built into libRangeLib that does. Every result says so in its signal field.
+// That decoder is not benched anywhere yet. It only ships as arm64 iOS objects, and it runs inside
+// libRangeLib's AudioInputCallback, which hands each buffer back to RangeAudioInput's own AudioQueue.
+// Timing it needs a device, a real queue and captures of a shipping Range, none of which a harness has.
+// Not part of the plugin. The decoder is compiled into this file so its allocations can be counted,
+// so build and run from the repository root with just:
+//
+//   cc -O2 -std=c11 -Isrc/ios/RangeLib bench/RangeDecoderBench.c -lm -o decoder_bench
+//   ./decoder_bench [--rate HZ] [--snr DB] [--buffer FRAMES] [--seconds S] [--label TEXT] [--csv]
+//
+// Without --snr / --buffer it sweeps a few of each. Every run prints one line of JSON (or CSV with --csv)
+// so results from different releases can be kept and compared:
+//   ns_per_frame        decode time per input audio frame
+//   cpu_percent         share of one core the decode would use in real time
+//   latency_*_ms        from the end of a frame's last tone to its sample reaching the sink, counting
+//                       the wait for the buffer holding it to fill and the time decoding that buffer
+//   allocs_per_buffer   allocations made while decoding (init excluded)
+//   decoded / sent      frames that came out right, and rejected frames that failed their CRC
+//   signal              always "placeholder": RangeSignalDecoder against its own encoder, not production
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// What was decoded, in every result (see the note at the top).
+#define BENCH_SIGNAL "placeholder"
+
+static uint64_t bench_allocations = 0;
+
+static void* bench_malloc(size_t size)
+{
+    bench_allocations++;
+    return malloc(size);
+}
+
+static void* bench_calloc(size_t count, size_t size)
+{
+    bench_allocations++;
+    return calloc(count, size);
+}
+
+// Count what the decoder allocates.
+#define malloc bench_malloc
+#define calloc bench_calloc
+#define realloc(pointer, size) (bench_allocations++, realloc(pointer, size))
+#include "../src/ios/RangeLib/RangeSignalDecoder.c"
+#undef malloc
+#undef calloc
+#undef realloc
+
+#define BENCH_AMPLITUDE 0.3
+#define BENCH_MAX_FRAMES 100000
+
+typedef struct {
+    double      rate;
+    double      snr_db;
+    int         buffer_frames;
+    double      seconds;
+} bench_config_t;
+
+typedef struct {
+    // Where each sent frame ends in the signal, and what it carried.
+    long long*  frame_ends;
+    float*      temperatures;
+    int         frames_sent;
+    // Next sent frame we expect to see in the sink.
+    int         next_frame;
+    int         frames_decoded;
+    // End (exclusive) of the buffer being decoded, and when decoding it started.
+    long long   buffer_end;
+    double      push_start_ns;
+    double*     latencies_ms;
+    int         latency_count;
+    double      rate;
+    // A bit, in samples.
+    long long   slack;
+} bench_state_t;
+
+static uint64_t bench_random_state = 0x2545F4914F6CDD1DULL;
+
+static double bench_uniform(void)
+{
+    // xorshift64*, so runs are repeatable everywhere.
+    bench_random_state ^= bench_random_state >> 12;
+    bench_random_state ^= bench_random_state << 25;
+    bench_random_state ^= bench_random_state >> 27;
+    return (double)((bench_random_state * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double bench_gaussian(void)
+{
+    double u = bench_uniform();
+    double v = bench_uniform();
+    return sqrt(-2.0 * log(u + 1e-300)) * cos(6.283185307179586 * v);
+}
+
+static double bench_now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+static void bench_sink(void* context, const range_uid_t* uid, range_sample_t sample)
+{
+    (void)uid;
+    bench_state_t* state = context;
+    double now = bench_now_ns();
+    // Match the sample to the next frame (skipping any that were lost) that carried its temperature.
+    // The decoder may finish a frame a little before its stop bit is over, hence the slack.
+    for(int frame = state->next_frame;
+        frame < state->frames_sent && state->frame_ends[frame] <= state->buffer_end + state->slack;
+        frame++)
+    {
+        if(fabsf(sample.temperature - state->temperatures[frame]) < 0.051f)
+        {
+            state->frames_decoded++;
+            state->next_frame = frame + 1;
+            double wait_ms = (double)(state->buffer_end - state->frame_ends[frame]) * 1000.0 / state->rate;
+            state->latencies_ms[state->latency_count++] = wait_ms + (now - state->push_start_ns) / 1e6;
+            return;
+        }
+    }
+}
+
+static int bench_compare_double(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double bench_percentile(const double* sorted, int count, double fraction)
+{
+    if(count == 0)
+    {
+        return NAN;
+    }
+    int index = (int)(fraction * (double)(count - 1) + 0.5);
+    return sorted[index];
+}
+
+static int bench_run(const bench_config_t* config, const char* label, int csv)
+{
+    range_signal_config_t signal;
+    range_signal_default_config(&signal);
+    signal.sample_rate = config->rate;
+
+    long long count = (long long)(config->seconds * config->rate);
+    float* pcm = calloc((size_t)count, sizeof(float));
+    bench_state_t state;
+    memset(&state, 0, sizeof(state));
+    state.rate = config->rate;
+    state.slack = (long long)ceil(signal.sample_rate / signal.baud_rate);
+    state.frame_ends = malloc(sizeof(long long) * BENCH_MAX_FRAMES);
+    state.temperatures = malloc(sizeof(float) * BENCH_MAX_FRAMES);
+    state.latencies_ms = malloc(sizeof(double) * BENCH_MAX_FRAMES);
+    if(pcm == NULL || state.frame_ends == NULL || state.temperatures == NULL || state.latencies_ms == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 0;
+    }
+
+    // Frames back to back with a short random pause (silence) between them.
+    range_uid_t uid = {{0x12, 0x34, 0x56, 0x78}, 4};
+    double phase = 0.0;
+    long long position = 0;
+    while(state.frames_sent < BENCH_MAX_FRAMES)
+    {
+        float temperature = (float)((int)(bench_uniform() * 5000.0) - 400) / 10.0f;
+        int written = range_signal_encode_frame(&signal, &uid, temperature, (float)BENCH_AMPLITUDE, &phase,
+                                                pcm + position, (int)(count - position));
+        if(written == 0)
+        {
+            break;
+        }
+        position += written;
+        state.frame_ends[state.frames_sent] = position;
+        state.temperatures[state.frames_sent] = temperature;
+        state.frames_sent++;
+        position += (long long)(bench_uniform() * 0.01 * config->rate);
+    }
+    double noise = BENCH_AMPLITUDE / sqrt(2.0) / pow(10.0, config->snr_db / 20.0);
+    for(long long i = 0; i < count; i++)
+    {
+        pcm[i] += (float)(noise * bench_gaussian());
+    }
+
+    range_signal_decoder_t decoder;
+    if(!range_signal_decoder_init(&decoder, &signal, bench_sink, &state))
+    {
+        fprintf(stderr, "decoder can't run at %.0f Hz\n", config->rate);
+        return 0;
+    }
+
+    uint64_t allocations_before = bench_allocations;
+    long long buffers = 0;
+    double start = bench_now_ns();
+    for(long long offset = 0; offset < count; offset += config->buffer_frames)
+    {
+        int frames = (int)((count - offset) < config->buffer_frames ? (count - offset) : config->buffer_frames);
+        state.buffer_end = offset + frames;
+        state.push_start_ns = bench_now_ns();
+        range_signal_decoder_push(&decoder, pcm + offset, frames, offset == 0 ? 0.0 : NAN);
+        buffers++;
+    }
+    double elapsed = bench_now_ns() - start;
+    uint64_t allocations = bench_allocations - allocations_before;
+
+    qsort(state.latencies_ms, (size_t)state.latency_count, sizeof(double), bench_compare_double);
+    double latency_mean = 0.0;
+    for(int i = 0; i < state.latency_count; i++)
+    {
+        latency_mean += state.latencies_ms[i] / state.latency_count;
+    }
+
+    double ns_per_frame = elapsed / (double)count;
+    double cpu_percent = elapsed / 1e9 / config->seconds * 100.0;
+    double allocs_per_buffer = (double)allocations / (double)buffers;
+    double p50 = bench_percentile(state.latencies_ms, state.latency_count, 0.50);
+    double p99 = bench_percentile(state.latencies_ms, state.latency_count, 0.99);
+    double latency_max = state.latency_count > 0 ? state.latencies_ms[state.latency_count - 1] : NAN;
+    if(csv)
+    {
+        printf("%s,%s,%.0f,%.1f,%d,%.0f,%.3f,%.4f,%.3f,%.3f,%.3f,%.3f,%.3f,%d,%d,%llu\n",
+               label, BENCH_SIGNAL, config->rate, config->snr_db, config->buffer_frames, config->seconds,
+               ns_per_frame, cpu_percent, latency_mean, p50, p99, latency_max, allocs_per_buffer,
+               state.frames_decoded, state.frames_sent, (unsigned long long)decoder.frames_rejected);
+    } else {
+        printf("{\"label\":\"%s\",\"signal\":\"%s\",\"rate\":%.0f,\"snr_db\":%.1f,\"buffer_frames\":%d,\"seconds\":%.0f,"
+               "\"ns_per_frame\":%.3f,\"cpu_percent\":%.4f,\"latency_mean_ms\":%.3f,\"latency_p50_ms\":%.3f,"
+               "\"latency_p99_ms\":%.3f,\"latency_max_ms\":%.3f,\"allocs_per_buffer\":%.3f,"
+               "\"decoded\":%d,\"sent\":%d,\"rejected\":%llu}\n",
+               label, BENCH_SIGNAL, config->rate, config->snr_db, config->buffer_frames, config->seconds,
+               ns_per_frame, cpu_percent, latency_mean, p50, p99, latency_max, allocs_per_buffer,
+               state.frames_decoded, state.frames_sent, (unsigned long long)decoder.frames_rejected);
+    }
+    fflush(stdout);
+
+    range_signal_decoder_destroy(&decoder);
+    free(state.frame_ends);
+    free(state.temperatures);
+    free(state.latencies_ms);
+    free(pcm);
+    return 1;
+}
+
+int main(int argc, char** argv)
+{
+    double rate = RANGE_SIGNAL_SAMPLE_RATE;
+    double seconds = 60.0;
+    double snr = NAN;
+    int buffer = 0;
+    const char* label = "";
+    int csv = 0;
+    for(int i = 1; i < argc; i++)
+    {
+        int has_value = i + 1 < argc;
+        if(strcmp(argv[i], "--rate") == 0 && has_value) {
+            rate = atof(argv[++i]);
+        } else if(strcmp(argv[i], "--snr") == 0 && has_value) {
+            snr = atof(argv[++i]);
+        } else if(strcmp(argv[i], "--buffer") == 0 && has_value) {
+            buffer = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--seconds") == 0 && has_value) {
+            seconds = atof(argv[++i]);
+        } else if(strcmp(argv[i], "--label") == 0 && has_value) {
+            label = argv[++i];
+        } else if(strcmp(argv[i], "--csv") == 0) {
+            csv = 1;
+        } else {
+            fprintf(stderr, "usage: %s [--rate HZ] [--snr DB] [--buffer FRAMES] [--seconds S] [--label TEXT] [--csv]\n", argv[0]);
+            return 1;
+        }
+    }
+    if(!(rate > 0.0) || !(seconds > 0.0) || buffer < 0)
+    {
+        fprintf(stderr, "rate, seconds and buffer must be positive\n");
+        return 1;
+    }
+
+    const double snrs[] = {40.0, 20.0, 10.0, 6.0};
+    const int buffers[] = {256, 1024, 4096};
+    int snr_count = isnan(snr) ? (int)(sizeof(snrs) / sizeof(snrs[0])) : 1;
+    int buffer_count = buffer == 0 ? (int)(sizeof(buffers) / sizeof(buffers[0])) : 1;
+
+    if(csv)
+    {
+        printf("label,signal,rate,snr_db,buffer_frames,seconds,ns_per_frame,cpu_percent,latency_mean_ms,"
+               "latency_p50_ms,latency_p99_ms,latency_max_ms,allocs_per_buffer,decoded,sent,rejected\n");
+    }
+    for(int s = 0; s < snr_count; s++)
+    {
+        for(int b = 0; b < buffer_count; b++)
+        {
+            bench_config_t config;
+            config.rate = rate;
+            config.snr_db = isnan(snr) ? snrs[s] : snr;
+            config.buffer_frames = buffer == 0 ? buffers[b] : buffer;
+            config.seconds = seconds;
+            if(!bench_run(&config, label, csv))
+            {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
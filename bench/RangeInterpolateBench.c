@@ -0,0 +1,157 @@
+//
+//  RangeInterpolateBench.c
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Batch interpolation (range_store_interpolate) against one lookup per time,
+// which is what calling RangeData interpolateTemperatureAtTime in a loop does (minus the message sends).
+// Not part of the plugin. Build and run from the repository root with:
+//
+//   cc -O2 -std=c11 -Isrc/ios/RangeLib bench/RangeInterpolateBench.c src/ios/RangeLib/RangeSampleStore.c src/ios/RangeLib/RangeSampleCodec.c -lm -o interpolate_bench
+//   ./interpolate_bench
+//
+// "graph" resamples the whole session onto 2000 pixels, "export" onto one time per second.
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "RangeSampleStore.h"
+
+static double bench_now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+// interpolateTemperatureAtTime:outIntervalInterpolated: without the Objective-C around it.
+static float bench_interpolate_one(const range_store_t* store, double time, double* interval_out)
+{
+    int length = store->length;
+    int index = range_store_lower_bound(store, time);
+    if(index == length)
+    {
+        *interval_out = -1.0;
+        return range_store_temperature_at(store, length - 1);
+    }
+    if(range_store_time_at(store, index) == time)
+    {
+        *interval_out = 0.0;
+        return range_store_temperature_at(store, index);
+    }
+    if(index == 0)
+    {
+        *interval_out = -1.0;
+        return range_store_temperature_at(store, 0);
+    }
+
+    double t0 = range_store_time_at(store, index - 1);
+    double t1 = range_store_time_at(store, index);
+    float v0 = range_store_temperature_at(store, index - 1);
+    float v1 = range_store_temperature_at(store, index);
+    *interval_out = t1 - t0;
+    return v0 + (v1 - v0) * (float)((time - t0) / *interval_out);
+}
+
+static void bench_resample(const char* name, const range_store_t* store, int count)
+{
+    double first = range_store_time_at(store, 0);
+    double span = range_store_time_at(store, store->length - 1) - first;
+
+    // A little past both ends, like a graph with some margin.
+    double* times = malloc(sizeof(double) * count);
+    float* batchTemperatures = malloc(sizeof(float) * count);
+    double* batchIntervals = malloc(sizeof(double) * count);
+    if(times == NULL || batchTemperatures == NULL || batchIntervals == NULL)
+    {
+        printf("Out of memory\n");
+        free(times);
+        free(batchTemperatures);
+        free(batchIntervals);
+        return;
+    }
+    for(int i = 0; i < count; i++)
+    {
+        times[i] = first - span * 0.01 + span * 1.02 * i / (count - 1);
+    }
+
+    int repeats = count < 100000 ? 200 : 5;
+    double start = bench_now_ns();
+    for(int r = 0; r < repeats; r++)
+    {
+        range_store_interpolate(store, times, count, batchTemperatures, batchIntervals);
+    }
+    double batch = (bench_now_ns() - start) / ((double)repeats * count);
+
+    int mismatches = 0;
+    double single = 0.0;
+    for(int r = 0; r < repeats; r++)
+    {
+        start = bench_now_ns();
+        for(int i = 0; i < count; i++)
+        {
+            double interval;
+            float temperature = bench_interpolate_one(store, times[i], &interval);
+            if(r == 0 && (temperature != batchTemperatures[i] || interval != batchIntervals[i]))
+            {
+                mismatches++;
+            }
+        }
+        single += bench_now_ns() - start;
+    }
+    single /= (double)repeats * count;
+
+    printf("%9d samples, %-6s %8d times: batch %6.1f ns/time, one at a time %6.1f ns/time%s\n",
+           store->length, name, count, batch, single, mismatches == 0 ? "" : "  MISMATCH");
+
+    free(times);
+    free(batchTemperatures);
+    free(batchIntervals);
+}
+
+static void bench_store(int length)
+{
+    range_store_t store;
+    range_store_init(&store);
+
+    // About one sample a second with some jitter, like a Range left in a smoker.
+    double time = 1400000000.0;
+    for(int i = 0; i < length; i++)
+    {
+        time += 0.5 + (double)rand() / RAND_MAX;
+        if(!range_store_append(&store, time, 70.0f + (float)(i % 100)))
+        {
+            printf("Out of memory at %d samples\n", i);
+            range_store_destroy(&store);
+            return;
+        }
+    }
+
+    bench_resample("graph", &store, 2000);
+    bench_resample("export", &store, (int)(range_store_time_at(&store, length - 1) - range_store_time_at(&store, 0)));
+    range_store_destroy(&store);
+}
+
+int main(void)
+{
+    srand(1);
+    bench_store(1000000);
+    bench_store(10000000);
+    return 0;
+}
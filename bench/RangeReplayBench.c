@@ -0,0 +1,222 @@
+//
+//  RangeReplayBench.c
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// End to end replay throughput: WAV captures read back with RangePcmReader, decoded by
+// RangeSignalDecoder, drained from the rings into sample stores and checked against a threshold
+// (what RangeReplay does, minus the Objective-C). Not part of the plugin. Build and run from the repository root with:
+//
+//   cc -O2 -std=c11 -pthread -Isrc/ios/RangeLib bench/RangeReplayBench.c src/ios/RangeLib/RangeDecodePool.c src/ios/RangeLib/RangeReplayStream.c src/ios/RangeLib/RangePcmReader.c src/ios/RangeLib/RangeSignalDecoder.c src/ios/RangeLib/RangeSampleRing.c src/ios/RangeLib/RangeSampleStore.c src/ios/RangeLib/RangeSampleCodec.c -lm -o replay_bench
+//   ./replay_bench [--streams N] [--workers W] [capture.wav]
+//
+// Without a capture it writes replay_bench.wav: minutes of one Range sending a sample a second
+// over a slow rise in temperature, with a little noise.
+// --streams replays the capture that many times at once (as if from that many devices).
+// With --workers they are decoded on a RangeDecodePool of that many threads, otherwise one after the other
+// on the main thread. Compare --workers 1, 2, 4... to see how decoding scales over cores.
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "RangeDecodePool.h"
+#include "RangeReplayStream.h"
+#include "RangeSampleStore.h"
+
+#define BENCH_MINUTES 30
+#define BENCH_THRESHOLD 150.0f
+#define BENCH_DRAIN_BATCH 64
+
+typedef struct {
+    range_store_t   store;
+    int             crossings;
+    float           last_temperature;
+} bench_sink_t;
+
+static double bench_now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+static int bench_make_capture(const char* path)
+{
+    const int seconds = BENCH_MINUTES * 60;
+    const long long count = (long long)(seconds * RANGE_SIGNAL_SAMPLE_RATE);
+    float* pcm = calloc((size_t)count, sizeof(float));
+    if(pcm == NULL)
+    {
+        return 0;
+    }
+
+    range_uid_t uid = {{0x12, 0x34, 0x56, 0x78}, 4};
+    double phase = 0.0;
+    for(int s = 0; s < seconds; s++)
+    {
+        long long start = (long long)(s * RANGE_SIGNAL_SAMPLE_RATE);
+        float temperature = 70.0f + 200.0f * (float)s / (float)seconds;
+        range_signal_encode_frame(NULL, &uid, temperature, 0.3f, &phase, pcm + start, (int)(count - start));
+    }
+    srand(1);
+    for(long long i = 0; i < count; i++)
+    {
+        pcm[i] += ((float)(rand() % 2001) - 1000.0f) * (0.01f / 1000.0f);
+    }
+
+    int ok = range_pcm_write_wav(path, pcm, count, RANGE_SIGNAL_SAMPLE_RATE);
+    free(pcm);
+    return ok;
+}
+
+// Moves everything waiting in a stream's ring into its store.
+static void bench_drain(range_replay_stream_t* stream, bench_sink_t* sink)
+{
+    range_ring_entry_t entries[BENCH_DRAIN_BATCH];
+    size_t count;
+    while((count = range_ring_pop(&stream->ring, entries, BENCH_DRAIN_BATCH)) > 0)
+    {
+        for(size_t i = 0; i < count; i++)
+        {
+            range_sample_t sample = entries[i].sample;
+            range_store_append(&sink->store, sample.unix_time, sample.temperature);
+            if(sink->last_temperature < BENCH_THRESHOLD && sample.temperature >= BENCH_THRESHOLD)
+            {
+                sink->crossings++;
+            }
+            sink->last_temperature = sample.temperature;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* path = NULL;
+    int stream_count = 1;
+    int worker_count = 0;
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--streams") == 0 && i + 1 < argc) {
+            stream_count = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            worker_count = atoi(argv[++i]);
+        } else if(argv[i][0] != '-' && path == NULL) {
+            path = argv[i];
+        } else {
+            fprintf(stderr, "usage: %s [--streams N] [--workers W] [capture.wav]\n", argv[0]);
+            return 1;
+        }
+    }
+    if(stream_count < 1 || worker_count < 0)
+    {
+        fprintf(stderr, "--streams must be at least 1\n");
+        return 1;
+    }
+    if(path == NULL)
+    {
+        path = "replay_bench.wav";
+        if(!bench_make_capture(path))
+        {
+            fprintf(stderr, "couldn't write %s\n", path);
+            return 1;
+        }
+    }
+
+    range_replay_stream_t* streams = calloc((size_t)stream_count, sizeof(range_replay_stream_t));
+    range_replay_stream_t** stream_pointers = calloc((size_t)stream_count, sizeof(range_replay_stream_t*));
+    bench_sink_t* sinks = calloc((size_t)stream_count, sizeof(bench_sink_t));
+    if(streams == NULL || stream_pointers == NULL || sinks == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for(int i = 0; i < stream_count; i++)
+    {
+        range_pcm_reader_t reader;
+        if(!range_pcm_open_wav(&reader, path) || !range_replay_stream_init(&streams[i], &reader, 1.0e9, 4096))
+        {
+            fprintf(stderr, "couldn't replay %s\n", path);
+            return 1;
+        }
+        stream_pointers[i] = &streams[i];
+        range_store_init(&sinks[i].store);
+        sinks[i].last_temperature = NAN;
+    }
+
+    double start = bench_now_ns();
+    if(worker_count == 0)
+    {
+        for(int i = 0; i < stream_count; i++)
+        {
+            while(range_replay_stream_step(&streams[i]) > 0)
+            {
+                bench_drain(&streams[i], &sinks[i]);
+            }
+            bench_drain(&streams[i], &sinks[i]);
+        }
+    } else {
+        range_decode_pool_t* pool = range_decode_pool_create(stream_pointers, stream_count, worker_count);
+        if(pool == NULL)
+        {
+            fprintf(stderr, "couldn't start the workers\n");
+            return 1;
+        }
+        bool running = true;
+        while(running)
+        {
+            running = range_decode_pool_wait(pool, -1.0);
+            for(int i = 0; i < stream_count; i++)
+            {
+                bench_drain(&streams[i], &sinks[i]);
+            }
+            range_decode_pool_drained(pool);
+        }
+        range_decode_pool_destroy(pool);
+    }
+    double elapsed = bench_now_ns() - start;
+
+    double audio_seconds = 0.0;
+    long long frames = 0;
+    int samples = 0;
+    int crossings = 0;
+    unsigned long long rejected = 0;
+    for(int i = 0; i < stream_count; i++)
+    {
+        audio_seconds += range_replay_stream_seconds(&streams[i]);
+        frames += streams[i].frames_decoded;
+        samples += sinks[i].store.length;
+        crossings += sinks[i].crossings;
+        rejected += (unsigned long long)streams[i].decoder.frames_rejected;
+    }
+    printf("%d streams, %d workers: %.0f s of audio in %.3f s: %.0fx real time, %.1f ns per audio frame\n",
+           stream_count, worker_count, audio_seconds, elapsed / 1e9, audio_seconds / (elapsed / 1e9), elapsed / (double)frames);
+    printf("%d samples, %llu rejected frames, %d threshold crossings\n", samples, rejected, crossings);
+
+    for(int i = 0; i < stream_count; i++)
+    {
+        range_store_destroy(&sinks[i].store);
+        range_replay_stream_destroy(&streams[i]);
+    }
+    free(sinks);
+    free(stream_pointers);
+    free(streams);
+    return 0;
+}
@@ -0,0 +1,299 @@
+//
+//  RangeSampleLogCheck.c
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Recovery check for the sample log (RangeSampleLog, behind RangeDataManager persistToDirectory:).
+// Writes a segment, damages it the ways an app killed or a phone losing power can leave it (samples
+// never synced, a tail block torn or cut short, a replacement block never synced, a header that
+// didn't reach the disk after chunks were dropped and their blocks reused) and reopens it.
+// What loads has to be exactly the samples the last sync vouched for, as far as the damage allows.
+// Not part of the plugin. Build and run from the repository root with:
+//
+//   cc -O2 -std=c11 -Isrc/ios/RangeLib bench/RangeSampleLogCheck.c src/ios/RangeLib/RangeSampleLog.c src/ios/RangeLib/RangeSampleStore.c src/ios/RangeLib/RangeSampleCodec.c -lm -lpthread -o sample_log_check
+//   ./sample_log_check [path]
+//
+// The segment is written to path (sample_log_check.rangelog by default) and removed at the end.
+// Exits with 1 and prints the first disagreement if there is one.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "RangeSampleLog.h"
+
+#define CHECK_UID "CHECK"
+// The header is at the start of the file and a lot smaller than this.
+#define CHECK_HEADER_BYTES 512
+
+static const char* check_path = "sample_log_check.rangelog";
+
+static double check_time(int sample)
+{
+    return 1000.0 + sample * 0.25;
+}
+
+static float check_temperature(int sample)
+{
+    return (float)(sample % 977) * 0.5f - 40.0f;
+}
+
+static range_log_t* check_open(range_store_t* store)
+{
+    range_store_init(store);
+    range_log_t* log = range_log_open(check_path, CHECK_UID, store);
+    if(log == NULL)
+    {
+        printf("could not open %s\n", check_path);
+        exit(1);
+    }
+    return log;
+}
+
+static void check_close(range_store_t* store, range_log_t* log)
+{
+    range_store_destroy(store);
+    range_log_close(log);
+}
+
+static void check_append(range_store_t* store, int from, int to)
+{
+    for(int i = from; i < to; i++)
+    {
+        if(!range_store_append(store, check_time(i), check_temperature(i)))
+        {
+            printf("could not append sample %d\n", i);
+            exit(1);
+        }
+    }
+}
+
+static void check_sync(range_log_t* log, range_store_t* store)
+{
+    if(!range_log_sync(log, store))
+    {
+        printf("could not sync %s\n", check_path);
+        exit(1);
+    }
+}
+
+// The store has to hold samples first to first + length - 1, in order.
+static bool check_samples(const char* scenario, range_store_t* store, int first, int length)
+{
+    if(store->length != length)
+    {
+        printf("%s: %d samples loaded, expected %d\n", scenario, store->length, length);
+        return false;
+    }
+    for(int i = 0; i < length; i++)
+    {
+        if(range_store_time_at(store, i) != check_time(first + i) ||
+           range_store_temperature_at(store, i) != check_temperature(first + i))
+        {
+            printf("%s: sample %d is (%.3f, %g), expected (%.3f, %g)\n", scenario, i,
+                   range_store_time_at(store, i), range_store_temperature_at(store, i),
+                   check_time(first + i), check_temperature(first + i));
+            return false;
+        }
+    }
+    return true;
+}
+
+static long long check_file_size(void)
+{
+    struct stat fileStat;
+    return stat(check_path, &fileStat) == 0 ? (long long)fileStat.st_size : -1;
+}
+
+static bool check_file_bytes(off_t offset, void* bytes, size_t length, bool write)
+{
+    int fd = open(check_path, O_RDWR);
+    if(fd < 0)
+    {
+        return false;
+    }
+    ssize_t done = write ? pwrite(fd, bytes, length, offset) : pread(fd, bytes, length, offset);
+    close(fd);
+    return done == (ssize_t)length;
+}
+
+// Samples appended after the last sync aren't vouched for and must not come back.
+static bool check_unsynced_tail(void)
+{
+    int synced = RANGE_STORE_CHUNK_CAPACITY * 2 + 100;
+    unlink(check_path);
+    range_store_t store;
+    range_log_t* log = check_open(&store);
+    check_append(&store, 0, synced);
+    check_sync(log, &store);
+    check_append(&store, synced, synced + 500);
+    check_close(&store, log);
+
+    log = check_open(&store);
+    bool output = check_samples("unsynced tail", &store, 0, synced);
+    check_close(&store, log);
+    return output;
+}
+
+// A tail block whose samples changed after its footer was written (the app died part way through a
+// sync) keeps the samples that still follow on from each other.
+static bool check_torn_tail(void)
+{
+    int synced = RANGE_STORE_CHUNK_CAPACITY * 2 + 300;
+    int torn_at = 120;
+    unlink(check_path);
+    range_store_t store;
+    range_log_t* log = check_open(&store);
+    check_append(&store, 0, synced);
+    check_sync(log, &store);
+    // The chunk is mapped from the file, so this is what the next open reads.
+    double* tail_times = (double*)range_chunk_times(store.chunks[2]);
+    tail_times[torn_at] = 0.0;
+    check_close(&store, log);
+
+    log = check_open(&store);
+    bool output = check_samples("torn tail", &store, 0, RANGE_STORE_CHUNK_CAPACITY * 2 + torn_at);
+    check_close(&store, log);
+    return output;
+}
+
+// A block cut short (the file was being made bigger for it) holds nothing. The full chunks
+// before it still load.
+static bool check_truncated_tail(void)
+{
+    int synced = RANGE_STORE_CHUNK_CAPACITY * 3 + 50;
+    unlink(check_path);
+    range_store_t store;
+    range_log_t* log = check_open(&store);
+    check_append(&store, 0, synced);
+    check_sync(log, &store);
+    check_close(&store, log);
+    if(truncate(check_path, (off_t)(check_file_size() - 1000)) != 0)
+    {
+        printf("truncated tail: could not truncate %s\n", check_path);
+        return false;
+    }
+
+    log = check_open(&store);
+    bool output = check_samples("truncated tail", &store, 0, RANGE_STORE_CHUNK_CAPACITY * 3);
+    check_close(&store, log);
+    return output;
+}
+
+// A merge into a full chunk writes a new block. Until a sync vouches for it the old block wins.
+static bool check_unsynced_replacement(void)
+{
+    int synced = RANGE_STORE_CHUNK_CAPACITY * 2 + 100;
+    unlink(check_path);
+    range_store_t store;
+    range_log_t* log = check_open(&store);
+    check_append(&store, 0, synced);
+    check_sync(log, &store);
+    double time = check_time(10) + 0.1;
+    float temperature = -100.0f;
+    if(!range_store_merge(&store, &time, &temperature, 1))
+    {
+        printf("unsynced replacement: could not merge\n");
+        return false;
+    }
+    check_close(&store, log);
+
+    log = check_open(&store);
+    bool output = check_samples("unsynced replacement", &store, 0, synced);
+    check_close(&store, log);
+    return output;
+}
+
+// Dropped chunks stay dropped, and once their blocks are reused the samples that replaced them load
+// even from a header that still names the dropped chunks (written before drops waited for the disk).
+static bool check_dropped_front(void)
+{
+    int synced = RANGE_STORE_CHUNK_CAPACITY * 4 + 200;
+    int dropped = RANGE_STORE_CHUNK_CAPACITY * 2;
+    unlink(check_path);
+    range_store_t store;
+    range_log_t* log = check_open(&store);
+    check_append(&store, 0, synced);
+    check_sync(log, &store);
+
+    unsigned char stale_header[CHECK_HEADER_BYTES];
+    if(!check_file_bytes(0, stale_header, sizeof(stale_header), false))
+    {
+        printf("dropped front: could not read the header\n");
+        return false;
+    }
+    if(range_log_drop_front(log, &store, 2) != 2)
+    {
+        printf("dropped front: could not drop 2 chunks\n");
+        return false;
+    }
+    check_close(&store, log);
+
+    log = check_open(&store);
+    bool output = check_samples("dropped front", &store, dropped, synced - dropped);
+    long long size = check_file_size();
+
+    // Enough new samples that the dropped blocks are written over.
+    int total = synced + RANGE_STORE_CHUNK_CAPACITY * 2 + 50;
+    check_append(&store, synced, total);
+    check_sync(log, &store);
+    check_close(&store, log);
+    if(output && check_file_size() != size)
+    {
+        printf("dropped front: the file grew from %lld to %lld bytes instead of reusing blocks\n", size, check_file_size());
+        output = false;
+    }
+
+    log = check_open(&store);
+    output = output && check_samples("reused blocks", &store, dropped, total - dropped);
+    check_close(&store, log);
+
+    if(output && !check_file_bytes(0, stale_header, sizeof(stale_header), true))
+    {
+        printf("stale header: could not write the header\n");
+        output = false;
+    }
+    log = check_open(&store);
+    output = output && check_samples("stale header", &store, dropped, total - dropped);
+    check_close(&store, log);
+    return output;
+}
+
+int main(int argc, char** argv)
+{
+    if(argc > 1)
+    {
+        check_path = argv[1];
+    }
+
+    bool output = check_unsynced_tail() &&
+                  check_torn_tail() &&
+                  check_truncated_tail() &&
+                  check_unsynced_replacement() &&
+                  check_dropped_front();
+    unlink(check_path);
+    if(!output)
+    {
+        return 1;
+    }
+    printf("All sample log recovery checks passed.\n");
+    return 0;
+}
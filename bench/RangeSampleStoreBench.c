@@ -0,0 +1,117 @@
+//
+//  RangeSampleStoreBench.c
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Time lookup latency of RangeSampleStore at 1M and 10M samples.
+// Not part of the plugin. Build and run from the repository root with:
+//
+//   cc -O2 -std=c11 -Isrc/ios/RangeLib bench/RangeSampleStoreBench.c src/ios/RangeLib/RangeSampleStore.c src/ios/RangeLib/RangeSampleCodec.c -lm -o store_bench
+//   ./store_bench
+//
+// "plain" is a binary search over every sample (what the store did before the chunk index)
+// and is there to compare against.
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "RangeSampleStore.h"
+
+#define kBenchLookups 1000000
+
+static double bench_now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+static int bench_plain_lower_bound(const range_store_t* store, double time)
+{
+    int low = 0;
+    int high = store->length;
+    while(low < high)
+    {
+        int mid = low + (high - low) / 2;
+        if(range_store_time_at(store, mid) < time)
+        {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static void bench_store(int length)
+{
+    range_store_t store;
+    range_store_init(&store);
+
+    // About one sample a second with some jitter, like a Range left in a smoker.
+    double time = 1400000000.0;
+    for(int i = 0; i < length; i++)
+    {
+        time += 0.5 + (double)rand() / RAND_MAX;
+        if(!range_store_append(&store, time, 70.0f + (float)(i % 100)))
+        {
+            printf("Out of memory at %d samples\n", i);
+            range_store_destroy(&store);
+            return;
+        }
+    }
+
+    double first = range_store_time_at(&store, 0);
+    double span = range_store_time_at(&store, length - 1) - first;
+    double* queries = malloc(sizeof(double) * kBenchLookups);
+    for(int i = 0; i < kBenchLookups; i++)
+    {
+        queries[i] = first + span * ((double)rand() / RAND_MAX);
+    }
+
+    long check = 0;
+    double start = bench_now_ns();
+    for(int i = 0; i < kBenchLookups; i++)
+    {
+        check += range_store_lower_bound(&store, queries[i]);
+    }
+    double indexed = (bench_now_ns() - start) / kBenchLookups;
+
+    long plainCheck = 0;
+    start = bench_now_ns();
+    for(int i = 0; i < kBenchLookups; i++)
+    {
+        plainCheck += bench_plain_lower_bound(&store, queries[i]);
+    }
+    double plain = (bench_now_ns() - start) / kBenchLookups;
+
+    printf("%9d samples: indexed %7.1f ns/lookup, plain %7.1f ns/lookup%s\n",
+           length, indexed, plain, check == plainCheck ? "" : "  MISMATCH");
+
+    free(queries);
+    range_store_destroy(&store);
+}
+
+int main(void)
+{
+    srand(1);
+    bench_store(1000000);
+    bench_store(10000000);
+    return 0;
+}
@@ -0,0 +1,294 @@
+//
+//  RangeTemperatureFormatCheck.c
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Randomized comparison of RangeTemperatureFormat and RangeSampleWriter against printf.
+// range_format_temperature has to print exactly what printSample:withFormat:withScale: did with
+// stringWithFormat: (copied below with snprintf), error strings included, and range_format_time what
+// "%.3f" does. The inputs include values too big for the integer path, NaN, infinities and times
+// near rounding edges. Then CSV and JSON exports from range_sample_writer_write and
+// range_sample_writer_write_columns are compared with the same text put together one sample at a time with snprintf.
+// Not part of the plugin. Build and run from the repository root with:
+//
+//   cc -O2 -std=c11 -Isrc/ios/RangeLib bench/RangeTemperatureFormatCheck.c src/ios/RangeLib/RangeTemperatureFormat.c src/ios/RangeLib/RangeTemperatureKernels.c src/ios/RangeLib/RangeSampleWriter.c -lm -o temperature_format_check
+//   ./temperature_format_check [values]
+//
+// Exits with 1 and prints the first disagreement if there is one.
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "RangeSampleWriter.h"
+#include "RangeTemperatureFormat.h"
+#include "RangeTemperatureKernels.h"
+
+#define CHECK_DEGREE_SIGN "\xC2\xBA"
+#define CHECK_WRITER_SAMPLES 30000
+
+// printSample:withFormat:withScale: before RangeTemperatureFormat.
+static void check_print_sample(char* buffer, size_t size, float rawSample, int formatType, int scaleType)
+{
+    float translatedSample = range_translate_and_round_temperature(rawSample, scaleType, formatType);
+    bool valid_scale = scaleType == RANGE_SCALE_KELVIN || scaleType == RANGE_SCALE_CELCIUS ||
+                       scaleType == RANGE_SCALE_FAHRENHEIT;
+    switch (formatType) {
+        case RANGE_FORMAT_HUMAN_READABLE:
+            snprintf(buffer, size, valid_scale ? "%.0f" CHECK_DEGREE_SIGN : "ErrorTemperatureScale", translatedSample);
+            break;
+        case RANGE_FORMAT_HUMAN_READABLE_PRECISION:
+            snprintf(buffer, size, valid_scale ? "%.1f" CHECK_DEGREE_SIGN : "ErrorTemperatureScale", translatedSample);
+            break;
+        case RANGE_FORMAT_RAW_DATA:
+            if(!valid_scale)
+            {
+                snprintf(buffer, size, "ErrorTemperatureScale");
+            } else {
+                snprintf(buffer, size, scaleType == RANGE_SCALE_FAHRENHEIT ? "%.1f" : "%.2f", translatedSample);
+            }
+            break;
+        default:
+            snprintf(buffer, size, "ErrorTemperatureFormat");
+            break;
+    }
+}
+
+static float check_temperature(long n)
+{
+    float raw = n % 1000 == 0 ? (float)rand() / (float)RAND_MAX * 2e8f - 1e8f
+                              : (float)rand() / (float)RAND_MAX * 1200.0f - 500.0f;
+    if(n % 97 == 0)
+    {
+        // On a twentieth, where rounding to a tenth is halfway.
+        raw = roundf(raw * 20.0f) / 20.0f;
+    }
+    switch(n % 5003)
+    {
+        case 5:
+            return NAN;
+        case 6:
+            return INFINITY;
+        case 7:
+            return -INFINITY;
+        case 8:
+            return -0.3f;
+        case 9:
+            return 31.99f;
+        default:
+            return raw;
+    }
+}
+
+static double check_time(long n)
+{
+    switch(n % 5003)
+    {
+        case 11:
+            return 0.0005;
+        case 12:
+            return -0.0004;
+        case 13:
+            return 2.0005;
+        case 14:
+            return NAN;
+        case 15:
+            return 1e18;
+        default:
+            break;
+    }
+    if(n % 3 == 0)
+    {
+        return 1.4e9 + (double)(n % 100000) * 0.125;
+    }
+    if(n % 3 == 1)
+    {
+        return (double)rand() / (double)RAND_MAX * 2e9;
+    }
+    return ((double)rand() / (double)RAND_MAX - 0.5) * 20.0;
+}
+
+static bool check_formats(long count)
+{
+    char found[RANGE_FORMAT_MAX_LENGTH];
+    char expected[RANGE_FORMAT_MAX_LENGTH];
+    for(long n = 0; n < count; n++)
+    {
+        float raw = check_temperature(n);
+        // Every scale and format, and one of each that isn't valid.
+        int scale = (int)(n % 4) - (n % 101 == 0 ? 4 : 0);
+        int format = (int)((n / 4) % 4);
+        int length = range_format_temperature(found, raw, scale, format);
+        check_print_sample(expected, sizeof(expected), raw, format, scale);
+        if(strcmp(found, expected) != 0 || length != (int)strlen(expected))
+        {
+            printf("temperature %.9g scale %d format %d: '%s', printf '%s'\n", raw, scale, format, found, expected);
+            return false;
+        }
+
+        double time = check_time(n);
+        length = range_format_time(found, time);
+        snprintf(expected, sizeof(expected), "%.3f", time);
+        if(strcmp(found, expected) != 0 || length != (int)strlen(expected))
+        {
+            printf("time %.17g: '%s', printf '%s'\n", time, found, expected);
+            return false;
+        }
+    }
+    return true;
+}
+
+typedef struct {
+    char*   text;
+    size_t  length;
+    size_t  capacity;
+} check_text_t;
+
+static bool check_append(check_text_t* text, const char* data, size_t length)
+{
+    if(text->length + length > text->capacity)
+    {
+        size_t capacity = (text->length + length) * 2;
+        char* grown = realloc(text->text, capacity);
+        if(grown == NULL)
+        {
+            return false;
+        }
+        text->text = grown;
+        text->capacity = capacity;
+    }
+    memcpy(text->text + text->length, data, length);
+    text->length += length;
+    return true;
+}
+
+static bool check_sink(void* context, const char* data, size_t length)
+{
+    return check_append(context, data, length);
+}
+
+// What the writer should print, a sample at a time.
+static void check_expected_export(check_text_t* text, int kind, int scale, int format,
+                                  const double* times, const float* temperatures, int count)
+{
+    char number[RANGE_FORMAT_MAX_LENGTH];
+    int decimals = range_format_decimals(scale, format);
+    bool json = kind == RANGE_WRITER_JSON;
+    check_append(text, json ? "[" : "time,temperature\n", json ? 1 : 17);
+    for(int i = 0; i < count; i++)
+    {
+        if(json)
+        {
+            check_append(text, i > 0 ? ",{\"time\":" : "{\"time\":", i > 0 ? 9 : 8);
+        }
+        if(isfinite(times[i]))
+        {
+            check_append(text, number, (size_t)snprintf(number, sizeof(number), "%.3f", times[i]));
+        } else if(json) {
+            check_append(text, "null", 4);
+        }
+        check_append(text, json ? ",\"temperature\":" : ",", json ? 15 : 1);
+        float rounded = range_translate_and_round_temperature(temperatures[i], scale, format);
+        if(isfinite(rounded))
+        {
+            check_append(text, number, (size_t)snprintf(number, sizeof(number), "%.*f", decimals, rounded));
+        } else if(json) {
+            check_append(text, "null", 4);
+        }
+        check_append(text, json ? "}" : "\n", 1);
+    }
+    if(json)
+    {
+        check_append(text, "]", 1);
+    }
+}
+
+static bool check_writer(void)
+{
+    static double times[CHECK_WRITER_SAMPLES];
+    static float temperatures[CHECK_WRITER_SAMPLES];
+    static range_sample_t samples[CHECK_WRITER_SAMPLES];
+    for(int i = 0; i < CHECK_WRITER_SAMPLES; i++)
+    {
+        times[i] = i % 997 == 3 ? NAN : 1.4e9 + i * 0.37;
+        temperatures[i] = check_temperature(i);
+        samples[i].unix_time = times[i];
+        samples[i].temperature = temperatures[i];
+    }
+
+    bool output = true;
+    for(int kind = RANGE_WRITER_CSV; kind <= RANGE_WRITER_JSON && output; kind++)
+    {
+        for(int scale = RANGE_SCALE_FAHRENHEIT; scale <= RANGE_SCALE_KELVIN && output; scale++)
+        {
+            for(int format = RANGE_FORMAT_RAW_DATA; format <= RANGE_FORMAT_HUMAN_READABLE_PRECISION && output; format++)
+            {
+                check_text_t expected = { NULL, 0, 0 };
+                check_text_t rows = { NULL, 0, 0 };
+                check_text_t columns = { NULL, 0, 0 };
+                check_expected_export(&expected, kind, scale, format, times, temperatures, CHECK_WRITER_SAMPLES);
+
+                // Runs of odd lengths, like chunks of a store.
+                range_sample_writer_t writer;
+                range_sample_writer_init(&writer, kind, scale, format, check_sink, &rows);
+                for(int done = 0; done < CHECK_WRITER_SAMPLES; )
+                {
+                    int count = 1 + rand() % 1000;
+                    count = done + count > CHECK_WRITER_SAMPLES ? CHECK_WRITER_SAMPLES - done : count;
+                    range_sample_writer_write(&writer, samples + done, count);
+                    done += count;
+                }
+                range_sample_writer_finish(&writer);
+
+                range_sample_writer_init(&writer, kind, scale, format, check_sink, &columns);
+                for(int done = 0; done < CHECK_WRITER_SAMPLES; )
+                {
+                    int count = 1 + rand() % 1000;
+                    count = done + count > CHECK_WRITER_SAMPLES ? CHECK_WRITER_SAMPLES - done : count;
+                    range_sample_writer_write_columns(&writer, times + done, temperatures + done, count);
+                    done += count;
+                }
+                range_sample_writer_finish(&writer);
+
+                if(rows.length != expected.length || memcmp(rows.text, expected.text, expected.length) != 0 ||
+                   columns.length != expected.length || memcmp(columns.text, expected.text, expected.length) != 0)
+                {
+                    printf("export kind %d scale %d format %d: %zu bytes from rows, %zu from columns, %zu expected\n",
+                           kind, scale, format, rows.length, columns.length, expected.length);
+                    output = false;
+                }
+                free(expected.text);
+                free(rows.text);
+                free(columns.text);
+            }
+        }
+    }
+    return output;
+}
+
+int main(int argc, char** argv)
+{
+    long count = argc > 1 ? atol(argv[1]) : 20000000;
+    srand(1);
+    if(!check_formats(count) || !check_writer())
+    {
+        return 1;
+    }
+    printf("%ld temperatures and times, and every export: same text as printf\n", count);
+    return 0;
+}
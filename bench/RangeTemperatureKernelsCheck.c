@@ -0,0 +1,169 @@
+//
+//  RangeTemperatureKernelsCheck.c
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Randomized comparison of RangeTemperatureKernels against the expressions RangeTemperatureTranslator
+// used before it (translateSample:toScale: and translateAndRoundSample:withFormat:toScale:, copied below).
+// Every scale and format, valid or not, over random temperatures plus NaN, infinities and values that
+// round halfway. The array functions run on odd lengths at odd offsets so the loop tails are covered.
+// Results have to agree to the bit, single values and arrays alike.
+// Not part of the plugin. Build and run from the repository root with:
+//
+//   cc -O2 -std=c11 -Isrc/ios/RangeLib bench/RangeTemperatureKernelsCheck.c src/ios/RangeLib/RangeTemperatureKernels.c -lm -o temperature_kernels_check
+//   ./temperature_kernels_check [values]
+//
+// Exits with 1 and prints the first disagreement if there is one.
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "RangeTemperatureKernels.h"
+
+static float check_translate(float rawSample, int scaleType)
+{
+    switch (scaleType) {
+        case RANGE_SCALE_KELVIN:
+            return ((rawSample - 32.0f) * (5.0f/9.0f)) + 273.15f;
+        case RANGE_SCALE_CELCIUS:
+            return (rawSample - 32.0f) * 5.0f/9.0f;
+        case RANGE_SCALE_FAHRENHEIT:
+            return rawSample;
+        default:
+            return 0.0f;
+    }
+}
+
+static float check_translate_and_round(float rawSample, int formatType, int scaleType)
+{
+    float translatedSample = check_translate(rawSample, scaleType);
+    bool valid_scale = scaleType == RANGE_SCALE_KELVIN || scaleType == RANGE_SCALE_CELCIUS ||
+                       scaleType == RANGE_SCALE_FAHRENHEIT;
+    if(!valid_scale)
+    {
+        return NAN;
+    }
+
+    switch (formatType) {
+        case RANGE_FORMAT_HUMAN_READABLE:
+            return roundf(translatedSample);
+        case RANGE_FORMAT_HUMAN_READABLE_PRECISION:
+            return roundf(translatedSample * 10.0f) / 10.0f;
+        case RANGE_FORMAT_RAW_DATA:
+            if(scaleType == RANGE_SCALE_FAHRENHEIT)
+            {
+                return roundf(translatedSample * 10.0f) / 10.0f;
+            }
+            return roundf(translatedSample * 100.0f) / 100.0f;
+        default:
+            return NAN;
+    }
+}
+
+// Same bits, or both NaN.
+static bool check_same(float a, float b)
+{
+    return memcmp(&a, &b, sizeof(float)) == 0 || (isnan(a) && isnan(b));
+}
+
+static float check_value(int i)
+{
+    switch(i % 50)
+    {
+        case 0:
+            return NAN;
+        case 1:
+            return INFINITY;
+        case 2:
+            return -INFINITY;
+        case 3:
+            // Halfway between two hundredths (as near as a float gets).
+            return (float)(rand() % 100000 - 30000) / 100.0f + 0.005f;
+        case 4:
+            return (float)rand() / (float)RAND_MAX * 2e8f - 1e8f;
+        default:
+            return (float)rand() / (float)RAND_MAX * 600.0f - 100.0f;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int count = argc > 1 ? atoi(argv[1]) : 1 << 20;
+    float* raw = malloc(sizeof(float) * count);
+    float* out = malloc(sizeof(float) * count);
+    if(raw == NULL || out == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    srand(1);
+    for(int i = 0; i < count; i++)
+    {
+        raw[i] = check_value(i);
+    }
+
+    for(int scale = -1; scale <= 3; scale++)
+    {
+        // Whole array, then odd pieces at odd offsets.
+        range_translate_temperatures(raw, out, count, scale);
+        for(int start = 1; start < count; )
+        {
+            int length = start + 7 < count ? 1 + rand() % 7 : count - start;
+            range_translate_temperatures(raw + start, out + start, length, scale);
+            start += length + 2 * (rand() % 13);
+        }
+        for(int i = 0; i < count; i++)
+        {
+            float expected = check_translate(raw[i], scale);
+            if(!check_same(out[i], expected) || !check_same(range_translate_temperature(raw[i], scale), expected))
+            {
+                printf("scale %d: %.9g translated to %.9g (single %.9g), expected %.9g\n",
+                       scale, raw[i], out[i], range_translate_temperature(raw[i], scale), expected);
+                return 1;
+            }
+        }
+
+        for(int format = -1; format <= 3; format++)
+        {
+            range_translate_and_round_temperatures(raw, out, count, scale, format);
+            for(int start = 1; start < count; )
+            {
+                int length = start + 7 < count ? 1 + rand() % 7 : count - start;
+                range_translate_and_round_temperatures(raw + start, out + start, length, scale, format);
+                start += length + 2 * (rand() % 13);
+            }
+            for(int i = 0; i < count; i++)
+            {
+                float expected = check_translate_and_round(raw[i], format, scale);
+                float single = range_translate_and_round_temperature(raw[i], scale, format);
+                if(!check_same(out[i], expected) || !check_same(single, expected))
+                {
+                    printf("scale %d format %d: %.9g rounded to %.9g (single %.9g), expected %.9g\n",
+                           scale, format, raw[i], out[i], single, expected);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    free(raw);
+    free(out);
+    printf("%d values in every scale and format: kernels agreed with the translator to the bit\n", count);
+    return 0;
+}
@@ -0,0 +1,220 @@
+//
+//  RangeTriggerIndexCheck.c
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Randomized comparison of RangeTriggerIndex (what RangeTriggerSet runs on) against the state machine
+// RangeTrigger isTriggerForRawData: runs, one copy per trigger. Triggers are added, removed and the
+// index reset while temperatures drift, jump, land exactly on thresholds and go NaN; every trigger has
+// to fire on exactly the samples its own state machine does.
+// Not part of the plugin. Build and run from the repository root with:
+//
+//   cc -O2 -std=c11 -Isrc/ios/RangeLib bench/RangeTriggerIndexCheck.c src/ios/RangeLib/RangeTriggerIndex.c -lm -o trigger_index_check
+//   ./trigger_index_check [trials]
+//
+// Exits with 1 and prints the first disagreement if there is one.
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "RangeTriggerIndex.h"
+
+#define CHECK_MAX_TRIGGERS 256
+// Ids are reused, so this keeps them below CHECK_MAX_TRIGGERS.
+#define CHECK_LIVE_TRIGGERS 200
+#define CHECK_STEPS 20000
+
+// One trigger the way RangeTrigger keeps it.
+typedef struct {
+    float   temperature;
+    float   offset;
+    int     direction;
+    bool    in_use;
+    bool    data_ever_read;
+    float   last_temperature;
+    bool    hysteresis_enabled;
+} check_trigger_t;
+
+// isTriggerForRawData:, line for line.
+static bool check_reference(check_trigger_t* trigger, float current)
+{
+    bool output = false;
+    if(!trigger->data_ever_read)
+    {
+        trigger->data_ever_read = true;
+        trigger->last_temperature = current;
+        return false;
+    }
+
+    int crossing = 0;
+    if(trigger->last_temperature < trigger->temperature && current >= trigger->temperature)
+    {
+        if(!trigger->hysteresis_enabled)
+        {
+            crossing = RANGE_TRIGGER_RISING;
+            trigger->hysteresis_enabled = true;
+        }
+    }
+    else if(trigger->last_temperature > trigger->temperature && current <= trigger->temperature)
+    {
+        if(!trigger->hysteresis_enabled)
+        {
+            crossing = RANGE_TRIGGER_FALLING;
+            trigger->hysteresis_enabled = true;
+        }
+    }
+
+    if(trigger->direction == RANGE_TRIGGER_RISING && current < trigger->temperature - trigger->offset)
+    {
+        trigger->hysteresis_enabled = false;
+    }
+    else if(trigger->direction == RANGE_TRIGGER_FALLING && current > trigger->temperature + trigger->offset)
+    {
+        trigger->hysteresis_enabled = false;
+    }
+    else if(trigger->direction == RANGE_TRIGGER_BIDIRECTIONAL && fabsf(current - trigger->temperature) > trigger->offset)
+    {
+        trigger->hysteresis_enabled = false;
+    }
+
+    if(trigger->direction == crossing)
+    {
+        output = true;
+    }
+    else if(trigger->direction == RANGE_TRIGGER_BIDIRECTIONAL && crossing != 0)
+    {
+        output = true;
+    }
+    trigger->last_temperature = current;
+    return output;
+}
+
+static float check_random(float low, float high)
+{
+    return low + (high - low) * (float)rand() / (float)RAND_MAX;
+}
+
+// A threshold, often on a round number so samples land on it exactly.
+static float check_threshold(void)
+{
+    return rand() % 4 == 0 ? (float)(rand() % 40) * 5.0f : check_random(-20.0f, 220.0f);
+}
+
+static bool check_trial(int trial)
+{
+    srand(trial);
+    range_trigger_index_t index;
+    range_trigger_index_init(&index);
+    static check_trigger_t triggers[CHECK_MAX_TRIGGERS];
+    int trigger_count = 0;
+    int fired[CHECK_MAX_TRIGGERS];
+    bool has_last = false;
+    float last = 0.0f;
+    float current = check_random(0.0f, 200.0f);
+    bool output = true;
+
+    for(int step = 0; step < CHECK_STEPS && output; step++)
+    {
+        int action = rand() % 100;
+        if(action < 3 && trigger_count < CHECK_LIVE_TRIGGERS)
+        {
+            float temperature = check_threshold();
+            int direction = RANGE_TRIGGER_RISING + rand() % 3;
+            int id = range_trigger_index_add(&index, temperature, direction);
+            if(id < 0 || id >= CHECK_MAX_TRIGGERS)
+            {
+                printf("trial %d step %d: bad id %d\n", trial, step, id);
+                output = false;
+                break;
+            }
+            trigger_count = id >= trigger_count ? id + 1 : trigger_count;
+            // Added mid stream, it is checked against the last temperature the index saw.
+            check_trigger_t trigger = { temperature, range_trigger_hysteresis_offset(temperature), direction, true,
+                                        has_last, last, false };
+            triggers[id] = trigger;
+        }
+        else if(action < 5 && trigger_count > 0)
+        {
+            int id = rand() % trigger_count;
+            range_trigger_index_remove(&index, id);
+            triggers[id].in_use = false;
+        }
+        else if(action == 5 && rand() % 20 == 0)
+        {
+            range_trigger_index_reset(&index);
+            has_last = false;
+            for(int i = 0; i < trigger_count; i++)
+            {
+                triggers[i].data_ever_read = false;
+                triggers[i].hysteresis_enabled = false;
+            }
+        } else {
+            int move = rand() % 10;
+            if(move == 0)
+            {
+                current += check_random(-60.0f, 60.0f);
+            }
+            else if(move == 1 && trigger_count > 0)
+            {
+                current = triggers[rand() % trigger_count].temperature;
+            }
+            else if(move == 2 && rand() % 50 == 0)
+            {
+                current = NAN;
+            } else {
+                current = isnan(current) ? 100.0f : current + check_random(-3.0f, 3.0f);
+            }
+
+            int count = range_trigger_index_evaluate(&index, current, fired);
+            int times_fired[CHECK_MAX_TRIGGERS] = { 0 };
+            for(int i = 0; i < count; i++)
+            {
+                times_fired[fired[i]]++;
+            }
+            for(int i = 0; i < trigger_count; i++)
+            {
+                int expected = triggers[i].in_use && check_reference(&triggers[i], current) ? 1 : 0;
+                if(times_fired[i] != expected)
+                {
+                    printf("trial %d step %d: trigger %d (%g, direction %d) at %g fired %d times, expected %d\n",
+                           trial, step, i, triggers[i].temperature, triggers[i].direction, current, times_fired[i], expected);
+                    output = false;
+                    break;
+                }
+            }
+            has_last = true;
+            last = current;
+        }
+    }
+    range_trigger_index_destroy(&index);
+    return output;
+}
+
+int main(int argc, char** argv)
+{
+    int trials = argc > 1 ? atoi(argv[1]) : 300;
+    for(int trial = 0; trial < trials; trial++)
+    {
+        if(!check_trial(trial))
+        {
+            return 1;
+        }
+    }
+    printf("%d trials of %d steps: every trigger agreed with its own state machine\n", trials, CHECK_STEPS);
+    return 0;
+}
@@ -0,0 +1,213 @@
+//
+//  RangeTriggerSpanCheck.c
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Randomized comparison of the span evaluation (range_trigger_evaluate_span and
+// range_trigger_index_evaluate_span, behind triggerIndexesForRawData:length: and
+// RangeTriggerSet checkRawData:length:withBlock:) against feeding the same samples one at a time.
+// Spans are cut at random lengths and the index gets output buffers as small as it accepts, so the
+// places it stops and picks up again are checked too. Firings (sample, trigger and time) and the
+// state left behind have to match exactly.
+// Not part of the plugin. Build and run from the repository root with:
+//
+//   cc -O2 -std=c11 -Isrc/ios/RangeLib bench/RangeTriggerSpanCheck.c src/ios/RangeLib/RangeTriggerIndex.c -lm -o trigger_span_check
+//   ./trigger_span_check [trials]
+//
+// Exits with 1 and prints the first disagreement if there is one.
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "RangeTriggerIndex.h"
+
+#define CHECK_SAMPLES 20000
+#define CHECK_SINGLE_SAMPLES 3000
+#define CHECK_MAX_TRIGGERS 40
+// Room for every trigger to fire on every sample.
+#define CHECK_MAX_FIRINGS (CHECK_SAMPLES * CHECK_MAX_TRIGGERS)
+
+static range_sample_t check_samples[CHECK_SAMPLES];
+static range_trigger_firing_t check_expected[CHECK_MAX_FIRINGS];
+static range_trigger_firing_t check_found[CHECK_MAX_FIRINGS];
+
+static float check_random(float low, float high)
+{
+    return low + (high - low) * (float)rand() / (float)RAND_MAX;
+}
+
+// Long quiet stretches (what the span scan skips) broken by jumps, landings on a threshold and NaNs.
+static void check_make_samples(int count, const float* thresholds, int threshold_count)
+{
+    float current = check_random(0.0f, 200.0f);
+    for(int i = 0; i < count; i++)
+    {
+        int move = rand() % 200;
+        if(move == 0)
+        {
+            current += check_random(-60.0f, 60.0f);
+        }
+        else if(move == 1 && threshold_count > 0)
+        {
+            current = thresholds[rand() % threshold_count];
+        }
+        else if(move == 2 && rand() % 20 == 0)
+        {
+            current = NAN;
+        } else {
+            current = isnan(current) ? 100.0f : current + check_random(-0.3f, 0.3f);
+        }
+        check_samples[i].temperature = current;
+        check_samples[i].unix_time = i * 0.125;
+    }
+}
+
+static bool check_same(const range_trigger_firing_t* a, int a_count, const range_trigger_firing_t* b, int b_count)
+{
+    return a_count == b_count && memcmp(a, b, sizeof(range_trigger_firing_t) * a_count) == 0;
+}
+
+static bool check_same_float(float a, float b)
+{
+    return a == b || (isnan(a) && isnan(b));
+}
+
+// One trigger (any direction, Unset included): spans of random length against one sample at a time.
+static bool check_single(int trial, float temperature)
+{
+    range_trigger_state_t spans = { temperature, range_trigger_hysteresis_offset(temperature), rand() % 4, false, 0.0f, false };
+    range_trigger_state_t one_by_one = spans;
+    check_make_samples(CHECK_SINGLE_SAMPLES, &temperature, 1);
+
+    int expected = 0;
+    for(int i = 0; i < CHECK_SINGLE_SAMPLES; i++)
+    {
+        range_trigger_firing_t firing;
+        if(range_trigger_evaluate_span(&one_by_one, &check_samples[i], 1, &firing) > 0)
+        {
+            check_expected[expected] = firing;
+            check_expected[expected].index = i;
+            expected++;
+        }
+    }
+
+    int found = 0;
+    for(int start = 0; start < CHECK_SINGLE_SAMPLES; )
+    {
+        int length = 1 + rand() % 700;
+        length = start + length > CHECK_SINGLE_SAMPLES ? CHECK_SINGLE_SAMPLES - start : length;
+        int count = range_trigger_evaluate_span(&spans, &check_samples[start], length, &check_found[found]);
+        for(int i = 0; i < count; i++)
+        {
+            check_found[found + i].index += start;
+        }
+        found += count;
+        start += length;
+    }
+
+    if(!check_same(check_expected, expected, check_found, found) || spans.held != one_by_one.held ||
+       spans.has_last != one_by_one.has_last || !check_same_float(spans.last_temperature, one_by_one.last_temperature))
+    {
+        printf("trial %d: single trigger at %g, direction %d: %d firings one by one, %d in spans\n",
+               trial, temperature, spans.direction, expected, found);
+        return false;
+    }
+    return true;
+}
+
+static bool check_trial(int trial)
+{
+    srand(trial);
+    float thresholds[CHECK_MAX_TRIGGERS] = { 0 };
+    int threshold_count = 1 + rand() % CHECK_MAX_TRIGGERS;
+    range_trigger_index_t one_by_one;
+    range_trigger_index_t spans;
+    range_trigger_index_init(&one_by_one);
+    range_trigger_index_init(&spans);
+    bool output = true;
+
+    for(int t = 0; t < threshold_count && output; t++)
+    {
+        thresholds[t] = rand() % 3 == 0 ? (float)(rand() % 40) * 5.0f : check_random(-20.0f, 220.0f);
+        int direction = RANGE_TRIGGER_RISING + rand() % 3;
+        range_trigger_index_add(&one_by_one, thresholds[t], direction);
+        range_trigger_index_add(&spans, thresholds[t], direction);
+        output = check_single(trial, thresholds[t]);
+    }
+
+    check_make_samples(CHECK_SAMPLES, thresholds, threshold_count);
+    int fired[CHECK_MAX_TRIGGERS];
+    int expected = 0;
+    for(int i = 0; i < CHECK_SAMPLES && output; i++)
+    {
+        int count = range_trigger_index_evaluate(&one_by_one, check_samples[i].temperature, fired);
+        for(int j = 0; j < count; j++)
+        {
+            check_expected[expected].index = i;
+            check_expected[expected].id = fired[j];
+            check_expected[expected].unix_time = check_samples[i].unix_time;
+            expected++;
+        }
+    }
+
+    int found = 0;
+    for(int start = 0; start < CHECK_SAMPLES && output; )
+    {
+        // The smallest buffers the index takes, so it has to stop early often.
+        int capacity = threshold_count + rand() % 5;
+        int consumed = 0;
+        int count = range_trigger_index_evaluate_span(&spans, &check_samples[start], CHECK_SAMPLES - start,
+                                                      &check_found[found], capacity, &consumed);
+        if(consumed <= 0)
+        {
+            printf("trial %d: no progress at sample %d with room for %d firings\n", trial, start, capacity);
+            output = false;
+            break;
+        }
+        for(int i = 0; i < count; i++)
+        {
+            check_found[found + i].index += start;
+        }
+        found += count;
+        start += consumed;
+    }
+
+    if(output && !check_same(check_expected, expected, check_found, found))
+    {
+        printf("trial %d: %d triggers: %d firings one by one, %d in spans\n", trial, threshold_count, expected, found);
+        output = false;
+    }
+    range_trigger_index_destroy(&one_by_one);
+    range_trigger_index_destroy(&spans);
+    return output;
+}
+
+int main(int argc, char** argv)
+{
+    int trials = argc > 1 ? atoi(argv[1]) : 200;
+    for(int trial = 0; trial < trials; trial++)
+    {
+        if(!check_trial(trial))
+        {
+            return 1;
+        }
+    }
+    printf("%d trials: spans agreed with one sample at a time on every firing\n", trials);
+    return 0;
+}
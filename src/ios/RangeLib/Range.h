@@ -25,6 +25,7 @@
 // These headers are included as a convenience so that SDK users
 // can just import "Range.h" and get everything they need.
 #import "RangeTrigger.h"
+#import "RangeTriggerSet.h"
 #import "RangeDataManager.h"
 #import "RangeAudioManager.h"
 #import "RangeTemperatureTranslator.h"
@@ -53,7 +54,7 @@
 /*!
  Singleton class for interacting with Range hardware.
  */
-@NativeStorage : CDVPlugin
+@interface Range : NSObject
 
 /*!
  Convenience property to access the temperature translator singleton.
@@ -77,8 +78,12 @@
 + (Range *)sharedInstance;
 
 /*!
- This invalidates all previous pointers to range_sample_t. Those should never be stored between calls to this function.
+ Moves the samples decoded since the last call into the RangeDataManager.
+ If the audio input provides a sampleRing (see RangeAudioInput_internal.h), the audio thread hands samples over
+ through that lock free queue and never waits on this function (or on your locks). The libRangeLib RangeAudioInput
+ that ships doesn't, so the samples are merged from its allTemperatures instead.
  Use @synchronized(range) to keep this function from be called when you are accessing the Range object from other threads.
+ Only syncs the persistDataToDirectory: files every few seconds, so a refresh doesn't wait on the disk.
  */
 - (void) refreshRangeDataManager;
 
@@ -90,10 +95,29 @@
  */
 - (RangeDataManager*) allRangeData;
 
+/*!
+ Get an immutable view of all the data as of the last refreshRangeDataManager.
+ Unlike allRangeData this doesn't need @synchronized(range). Readers can take as long as
+ they like with it (graphing, exporting, triggers) without holding up the next refresh.
+ 
+ @return The latest published RangeDataSnapshot.
+ */
+- (RangeDataSnapshot*) snapshot;
+
+/*!
+ Keep all Range data on disk so it is still there after the app is killed or restarted.
+ Call it once, early (before enableAudio is a good spot). See RangeDataManager persistToDirectory:.
+ Every refreshRangeDataManager records the new samples in the files.
+ @param directory Where to keep the files. Something under Application Support is a good choice.
+ @return NO if directory can't be used.
+ */
+- (BOOL) persistDataToDirectory:(NSString*) directory;
+
 /*!
  This function allows us to clean up some things when the app exits.
  Mostly this has to do with returning various volumes to their original values.
  Not calling this on exit will cause volumes to be left in a max volume state.
+ Also records the samples refreshRangeDataManager added since its last sync in the persistDataToDirectory: files.
  */
 - (void) prepareForAppQuitting;
 
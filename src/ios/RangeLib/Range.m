@@ -48,10 +48,14 @@
 #import "RangeTemperatureTranslator.h"
 #import <MediaPlayer/MediaPlayer.h>
 #import "RangeAudioManager_internal.h"
+#import "RangeDataManager_internal.h"
 #import <Cordova/CDVPlugin.h>
 
 
 @interface Range()
+{
+    uint64_t _lastDroppedSampleCount;
+}
 
 @property (strong, readwrite) RangeTemperatureTranslator* temperatureTranslator;
 @property (strong, readwrite) RangeDataManager* rangeDataManager;
@@ -91,12 +95,47 @@
 - (void) prepareForAppQuitting
 {
     [self.audioManager prepareForAppQuitting];
+    // Refreshes run inside @synchronized(range), possibly on another thread.
+    @synchronized(self)
+    {
+        [self.rangeDataManager syncPersistentData];
+    }
+}
+
+// Prefers the ring the audio decode pushes into. The audio thread never waits on us that way.
+// Falls back to merging the RangeDataManager from the audio input if there is no ring.
+- (BOOL) addLatestAudioSamples
+{
+    range_ring_t* ring = [self.audioManager sampleRing];
+    if(ring == NULL)
+    {
+        return [self.rangeDataManager addRangeManager:[self.audioManager allTemperatures]];
+    }
+
+    BOOL output = [self.rangeDataManager addSamplesFromRing:ring];
+
+    uint64_t droppedCount = range_ring_dropped_count(ring);
+    if(droppedCount != _lastDroppedSampleCount)
+    {
+        NSLog(@"Sample ring overflowed. %llu samples dropped so far.", droppedCount);
+        _lastDroppedSampleCount = droppedCount;
+    }
+    return output;
 }
 
 - (void) refreshRangeDataManager
+{
+    [self refreshRangeDataManagerData];
+    [self.rangeDataManager applyRetention];
+    [self.rangeDataManager syncPersistentDataIfDue];
+    [self.rangeDataManager compressSealedData];
+    [self.rangeDataManager publishSnapshot];
+}
+
+- (void) refreshRangeDataManagerData
 {
 #if (TARGET_IPHONE_SIMULATOR)
-    BOOL addSuccess = [self.rangeDataManager addRangeManager:[self.audioManager allTemperatures]];
+    BOOL addSuccess = [self addLatestAudioSamples];
     if(!addSuccess)
     {
         NSLog(@"We were unable to merge our RangeManagers.");
@@ -104,7 +143,7 @@
 #else
     if(self.audioManager)
     {
-        BOOL addSuccess = [self.rangeDataManager addRangeManager:[self.audioManager allTemperatures]];
+        BOOL addSuccess = [self addLatestAudioSamples];
         if(!addSuccess)
         {
             NSLog(@"We were unable to merge our RangeManagers.");
@@ -121,5 +160,17 @@
     return self.rangeDataManager;
 }
 
+- (RangeDataSnapshot*) snapshot
+{
+    return [self.rangeDataManager snapshot];
+}
+
+- (BOOL) persistDataToDirectory:(NSString*) directory
+{
+    BOOL output = [self.rangeDataManager persistToDirectory:directory];
+    [self.rangeDataManager publishSnapshot];
+    return output;
+}
+
 
 @end
\ No newline at end of file
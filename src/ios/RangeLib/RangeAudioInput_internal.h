@@ -0,0 +1,35 @@
+//
+//  RangeAudioInput_internal.h
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "RangeAudioInput.h"
+#import "RangeSampleRing.h"
+
+/*!
+ It is unnecessary for the SDK end-user to directly use anything in this file.
+ */
+@interface RangeAudioInput()
+
+/*!
+ The ring the audio decode thread pushes every decoded sample into.
+ Only refreshRangeDataManager should pop from it.
+ Older builds of RangeAudioInput don't have a ring, so check respondsToSelector: before calling.
+ */
+- (range_ring_t *) sampleRing;
+
+@end
@@ -73,6 +73,15 @@ const float targetMicGain = 0.2f;
     return [self.audioInput allTemperatures];
 }
 
+- (range_ring_t *) sampleRing
+{
+    if([self.audioInput respondsToSelector:@selector(sampleRing)])
+    {
+        return [self.audioInput sampleRing];
+    }
+    return NULL;
+}
+
 #pragma mark - member functions
 
 - (BOOL) checkAndFixPowerVolume
@@ -826,7 +835,7 @@ static void audioInterruptionListener (
             
             if(self.audioOutput == nil)
             {
-                self.audioOutput = [[RangeAudioOutput alloc] init];
+                self.audioOutput = [[RangeAudioOutputClass alloc] init];
             }
             
             if(self.audioInput == nil)
@@ -1041,6 +1050,15 @@ static void audioInterruptionListener (
     }
 }
 
+- (range_ring_t *) sampleRing
+{
+    if([self.audioInput respondsToSelector:@selector(sampleRing)])
+    {
+        return [self.audioInput sampleRing];
+    }
+    return NULL;
+}
+
 @end
 
 #endif //!(TARGET_IPHONE_SIMULATOR)
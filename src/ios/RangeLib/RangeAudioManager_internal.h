@@ -19,13 +19,26 @@
 
 #import "RangeAudioManager.h"
 #import "RangeAudioOutput.h"
-#import "RangeAudioInput.h"
+#import "RangeAudioInput_internal.h"
+#import "RangeToneAudioOutput.h"
 #import <MediaPlayer/MediaPlayer.h>
 
 // SDK USER! - set this to 0 if your app doesn't run on any versions of iOS before 6
 // It will get rid of a number of deprecation warnings.
 #define MY_APP_DOES_RUN_ON_EARLIER_THAN_IOS_6 1
 
+// SDK USER! - set this to 1 to play the power tone with RangeToneRenderer
+// instead of the player built into libRangeLib.
+#ifndef RANGE_USE_TONE_RENDERER
+#define RANGE_USE_TONE_RENDERER 0
+#endif
+
+#if RANGE_USE_TONE_RENDERER
+#define RangeAudioOutputClass RangeToneAudioOutput
+#else
+#define RangeAudioOutputClass RangeAudioOutput
+#endif
+
 
 /*!
  It is unnecessary for the SDK end-user to directly use anything in this file.
@@ -52,7 +65,7 @@ typedef NS_ENUM(NSInteger, RangeAudioState) {
 }
 
 @property (strong, readwrite) RangeAudioInput* audioInput;
-@property (strong, readwrite) RangeAudioOutput* audioOutput;
+@property (strong, readwrite) RangeAudioOutputClass* audioOutput;
 @property (strong, readwrite) RangeDataManager* rangeDataManager;
 // maps the route to its last read volume
 @property (strong, readwrite) NSMutableDictionary* volumeManager;
@@ -68,4 +81,10 @@ typedef NS_ENUM(NSInteger, RangeAudioState) {
 - (void) prepareForAppQuitting;
 - (RangeDataManager*) allTemperatures;
 
+/*!
+ The ring of decoded samples from the current RangeAudioInput.
+ @return NULL if there is no input or the input doesn't provide a ring.
+ */
+- (range_ring_t *) sampleRing;
+
 @end
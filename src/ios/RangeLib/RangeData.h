@@ -18,37 +18,51 @@
 // limitations under the License.
 
 #import <Foundation/Foundation.h>
+#import "RangeTypes.h"
+#import "RangeTemperatureTranslator.h"
 
-static NSString * const kRDIllegalUid;
+static NSString * const kRDIllegalUid = @"RangeIllegalUid";
 
 /*!
  This is the value (returned from functions
  that return indicies) if an index was not found.
  */
-static const int kRangeIndexNotFound;
+static const int kRangeIndexNotFound = -1;
 
-typedef struct  {
-    /*!
-     Temperature (in F) of the sample.
-     */
-    float temperature;
-    /*!
-     Time since 1970 for sample.
-     Is the equivalent of what [[NSDate date] timeIntervalSince1970] 
-     would return at the moment the sample was taken.
-     */
-    double unix_time;
-} range_sample_t;
+/*!
+ Called once per sample when enumerating the samples of several Ranges in time order.
+ Set *stop to YES to end the enumeration early.
+ */
+typedef void (^RangeSampleEnumerationBlock)(NSString* uid, range_sample_t sample, BOOL* stop);
+
+/*!
+ @enum           RangeDataExportType options
+ @abstract       The kinds of text exportFromStart:toStop:as:withFormat:toScale:toStream: writes.
+ 
+ @constant       kRangeDataExportTypeCSV
+ A "time,temperature" header and then a line per sample.
+ @constant       kRangeDataExportTypeJSON
+ An array of {"time":..., "temperature":...} objects.
+ */
+typedef NS_ENUM(UInt32, RangeDataExportType) {
+    kRangeDataExportTypeCSV     = 0,
+    kRangeDataExportTypeJSON    = 1
+};
 
 /*!
  The most important assumption of the RangeData is that all the data comes from a single unique device.
  There is also an assumption that there is a guaranteed order to the samples contained within this object.
  All samples are in ascending order based on timestamp.
  
- Pointers are only valid until another RangeData is merged with this one.
+ Samples are stored in fixed size chunks that are never moved once allocated.
+ A range_sample_t pointer returned by this class stays valid for as long as this RangeData does,
+ when more data is merged in, unless the retention policy (RangeDataManager retainRawSamplesFor:summariesFor:)
+ drops its samples. The range_sample_t copies behind those pointers (16 bytes a sample) are kept just as long,
+ so for reading through a lot of history use a RangeDataSnapshot: its copies go when the snapshot does.
+ If a merge brings in samples older than ones we already have, the samples after the
+ insertion point shift over by one (the pointer is still valid but may refer to a different sample).
  Practically, for use in this library, this means that if the Range object is refreshed in another thread
- you will need to ensure that things are locked appropriately.
- Also, it is good practice to never hold onto a range_sample_t pointer for any extended period of time.
+ you will still need to ensure that things are locked appropriately.
  */
 @interface RangeData : NSObject
 
@@ -62,12 +76,47 @@ typedef struct  {
  */
 @property (nonatomic, readonly) NSNumber* sampleRateInHz;
 
+/*!
+ Creates a RangeData from the frames decoded by RangeAudioInput.
+ Same as initWithFrames:fromSender:withNumFrames:usingBoundedSampleRate: with a bound of 4 Hz.
+ */
+- (instancetype) initWithFrames: (const range_frame_t*) frames fromSender: (NSString*) uid withNumFrames: (int) numFrames;
+
+/*!
+ Creates a RangeData from the frames decoded by RangeAudioInput.
+ Only temperature frames become samples; info frames are skipped.
+ 
+ @param maxSampleRateInHz
+ Frames that come sooner than 1 / maxSampleRateInHz seconds after the last kept sample are dropped.
+ Rates of 7.5 Hz (the rate Ranges send at) and above keep every frame.
+ */
+- (instancetype) initWithFrames: (const range_frame_t*) frames fromSender: (NSString*) uid withNumFrames: (int) numFrames usingBoundedSampleRate: (float) maxSampleRateInHz;
+
 /*!
  Get the pointer to the sample at an index.
+ If the RangeDataManager drops old samples (see retainRawSamplesFor:summariesFor:) the pointer
+ is only good until the next refresh. Pointers from a snapshot stay good as long as the snapshot.
  @return pointer to a range_sample_t struct. If index is invalid then returns NULL.
  */
 - (const range_sample_t *) sampleAt: (int) index;
 
+/*!
+ How much smaller the samples are in memory than they would be uncompressed.
+ Older samples are compressed a few chunks at a time as the Range object is refreshed.
+ Reading old samples decodes the part you read again for a while.
+ The range_sample_t views that sampleAt: and friends read through count as used, so reading
+ through pointers can bring this below 1.0.
+ @return Uncompressed size divided by the size actually used (1.0 for an empty RangeData).
+ */
+- (double) compressionRatio;
+
+/*!
+ Memory used by the samples, their summaries and the recorded gaps.
+ Samples in a segment file count as well, as they are mapped in. Memory shared with snapshots counts in full.
+ @return The number of bytes.
+ */
+- (size_t) bytesInMemory;
+
 /*!
  Current length of the sample data.
  @return number of range_sample_t in the backing store
@@ -95,6 +144,24 @@ typedef struct  {
  */
 - (float) interpolateTemperatureAtTime: (double) time outIntervalInterpolated: (double*) intevalInterpolatedOver;
 
+/*!
+ interpolateTemperatureAtTime:outIntervalInterpolated: for many times at once, e.g. one per pixel of a graph
+ or one per second for an export. Gives exactly the same answers as calling it once for each time.
+ 
+ @param times
+ The times to give temperatures at. Sorted ascending is much faster: the data is then walked once from start to end.
+ 
+ @param count
+ Number of entries in times, temperaturesOut and intervalsInterpolatedOver.
+ 
+ @param temperaturesOut
+ Gets the interpolated temperature for each time.
+ 
+ @param intervalsInterpolatedOver
+ Optional (can be NULL). Gets the interval for each time, as intevalInterpolatedOver does.
+ */
+- (void) interpolateTemperaturesAtTimes: (const double*) times count: (int) count outTemperatures: (float*) temperaturesOut outIntervalsInterpolated: (double*) intervalsInterpolatedOver;
+
 /*!
  Gets a pointer to the sample that is closest to the given time.
  @return pointer to a range_sample_t struct. If length is 0 then it returns NULL.
@@ -107,6 +174,32 @@ typedef struct  {
  */
 - (int) findClosestSampleIndexAtTime: (double) time;
 
+/*!
+ Gets a pointer to the sample taken at exactly the given time.
+ @return pointer to a range_sample_t struct. NULL if there is no sample at that time.
+ */
+- (const range_sample_t *) findSampleAtTime: (double) time;
+
+/*!
+ Gets the index for the sample taken at exactly the given time.
+ @return index for a sample. RDC_NOT_FOUND if there is no sample at that time.
+ */
+- (int) findSampleIndexAtTime: (double) time;
+
+/*!
+ The samples on both sides of every gap longer than the gap length (see changeGapLength:).
+ The first sample is always in the list as the end of a gap, and (if there are at least two samples)
+ the latest sample is always in it as the start of one.
+ @return An array of RangeGapSample in ascending order by time.
+ */
+- (NSArray*) gaps;
+
+/*!
+ Sets the shortest time between two samples that counts as a gap for gaps.
+ Lengths of 60 seconds or less are ignored. The default is 300 seconds.
+ */
+- (void) changeGapLength: (double) seconds;
+
 /*!
  This function gives you a pointer to the starting struct and the length of the data described by the time window provided.
  
@@ -122,6 +215,8 @@ typedef struct  {
  The number of samples that fall within the time window.
  
  @return The pointer to the first range_sample_t in the RangeData's internal array of samples that is within the time window. NULL if there are no items that match the request.
+ If the window crosses a chunk boundary the samples are copied into an autoreleased buffer
+ that stays valid until the current autorelease pool drains.
  */
 - (const range_sample_t *) findSamplesFromStart: (double) startTime toStop: (double) stopTime withOutputLength:(int*) lengthOut;
 
@@ -143,4 +238,64 @@ typedef struct  {
  */
 - (int) findSamplesIndexFromStart: (double) startTime toStop: (double) stopTime withOutputLength:(int*) lengthOut;
 
+/*!
+ Copies samples into separate time and temperature arrays, straight from storage.
+ Unlike findSamplesFromStart:toStop:withOutputLength: no range_sample_t copy of the samples is made.
+ 
+ @param index
+ The index of the first sample to copy, e.g. from findSamplesIndexFromStart:toStop:withOutputLength:.
+ 
+ @param length
+ The number of samples to copy. times and temperatures must have room for this many.
+ 
+ @return NO if the samples aren't all there or we ran out of memory.
+ */
+- (BOOL) copySamplesFromIndex: (int) index length: (int) length toTimes: (double*) times temperatures: (float*) temperatures;
+
+/*!
+ Summarizes the samples in a time window into at most maxBuckets min/max/mean buckets.
+ Meant for overview graphs of long sessions: the raw samples are never touched and the
+ work done is proportional to maxBuckets, not to how many samples are in the window.
+ 
+ The buckets are 1 second, 10 seconds, 1 minute or 10 minutes wide (the finest that fits in maxBuckets).
+ If the window is so long that even 10 minute buckets don't fit, neighbouring buckets are combined.
+ Stretches of time without samples have no bucket.
+ 
+ @param startTime
+ The starting time for the window.
+ 
+ @param stopTime
+ The ending time for the window. The first and last bucket may reach a little outside of the window.
+ 
+ @param maxBuckets
+ The most buckets to return. bucketsOut must have room for this many.
+ 
+ @param bucketsOut
+ The buckets in ascending order by time.
+ 
+ @return The number of buckets written to bucketsOut.
+ */
+- (int) summarizeFromStart: (double) startTime toStop: (double) stopTime maxBuckets: (int) maxBuckets output: (range_bucket_t*) bucketsOut;
+
+/*!
+ Writes the samples in a time window to a stream as CSV or JSON text.
+ The samples go straight from storage into the stream a few kilobytes at a time; no objects are made per sample.
+ Temperatures are written the way printSample:withFormat:withScale: prints them (without the degree sign).
+ Times are seconds since 1970, to the millisecond.
+ 
+ @param startTime
+ The starting time (inclusive) for the samples written.
+ 
+ @param stopTime
+ The ending time (inclusive) for the samples written.
+ 
+ @param stream
+ An open stream. It is left open.
+ 
+ @return NO if the stream failed or the scale or format isn't valid.
+ */
+- (BOOL) exportFromStart: (double) startTime toStop: (double) stopTime as: (RangeDataExportType) exportType
+              withFormat: (RangeTemperaturePrintFormat) formatType toScale: (RangeTemperatureScale) scaleType
+                toStream: (NSOutputStream*) stream;
+
 @end
@@ -0,0 +1,990 @@
+//
+//  RangeData.m
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifdef __APPLE__
+#include "TargetConditionals.h"
+#endif
+
+#import "RangeData_internal.h"
+#import "RangeGapSample.h"
+#import "RangeSampleWriter.h"
+
+// Ranges send 7.5 samples a second.
+static const float kRDRangeSampleRateInHz = 7.5f;
+static const float kRDDefaultBoundedSampleRate = 4.0f;
+static const double kRDDefaultGapLength = 300.0;
+static const double kRDMinimumGapLength = 60.0;
+
+@interface RangeData()
+{
+    range_store_t _store;
+    // NULL unless the samples are kept in a segment file.
+    range_log_t* _log;
+    // Smallest time between two neighbouring samples. Zero until we have two samples.
+    double _minSampleInterval;
+    uint64_t _generation;
+    // Bumped when chunks are swapped for compressed ones, so snapshots know to pick those up.
+    uint64_t _chunkLayoutVersion;
+    range_pyramid_t _pyramid;
+    // Number of samples (from the start of the store) folded into _pyramid.
+    int _pyramidLength;
+    range_gap_index_t _gaps;
+    // Number of samples (from the start of the store) whose gaps are in _gaps.
+    int _gapsLength;
+    // RangeGapSample list handed out by gaps. nil until first asked for.
+    NSMutableArray* _gapSamples;
+    // Number of samples (from the start of the store) looked at for _gapSamples.
+    int _gapSamplesLength;
+    double _gapLength;
+    // Samples before this time were dropped (see dropSamplesBefore:maxChunks:). Resends of anything older are ignored.
+    double _mergeFloorTime;
+    // Frozen copies are read only views shared with readers on other threads.
+    BOOL _isFrozen;
+}
+
+@property (nonatomic, readwrite) NSString* rangeUid;
+
+@end
+
+
+@implementation RangeData
+
+- (instancetype) init
+{
+    return [self initWithUid:kRDIllegalUid];
+}
+
+- (instancetype) initWithUid: (NSString*) uid
+{
+    if (self = [super init])
+    {
+        self.rangeUid = uid;
+        range_store_init(&_store);
+        range_pyramid_init(&_pyramid);
+        _pyramidLength = 0;
+        range_gap_index_init(&_gaps);
+        _gapsLength = 0;
+        _gapSamples = nil;
+        _gapSamplesLength = 0;
+        _gapLength = kRDDefaultGapLength;
+        _minSampleInterval = 0.0;
+        _generation = 0;
+        _mergeFloorTime = -INFINITY;
+
+        return self;
+    } else {
+        return nil;
+    }
+}
+
+- (instancetype) initWithFrames: (const range_frame_t*) frames fromSender: (NSString*) uid withNumFrames: (int) numFrames
+{
+    return [self initWithFrames:frames fromSender:uid withNumFrames:numFrames usingBoundedSampleRate:kRDDefaultBoundedSampleRate];
+}
+
+- (instancetype) initWithFrames: (const range_frame_t*) frames fromSender: (NSString*) uid withNumFrames: (int) numFrames usingBoundedSampleRate: (float) maxSampleRateInHz
+{
+    if (self = [self initWithUid:uid])
+    {
+        BOOL bounded = maxSampleRateInHz < kRDRangeSampleRateInHz;
+        double minInterval = 1.0 / maxSampleRateInHz;
+
+        for(int i = 0; i < numFrames; i++)
+        {
+            const range_frame_t* frame = &(frames[i]);
+            if(frame->type == RANGE_FRAME_INFO)
+            {
+                continue;
+            }
+            if(frame->type != RANGE_FRAME_TEMPERATURE)
+            {
+                NSLog(@"Unknown frame type %d.", frame->type);
+                continue;
+            }
+
+            int length = _store.length;
+            if(bounded && length > 0 && (frame->unix_time - range_store_time_at(&_store, length - 1)) <= minInterval)
+            {
+                continue;
+            }
+
+            range_sample_t sample;
+            sample.temperature = frame->payload.sample.temperature;
+            sample.unix_time = frame->unix_time;
+            if(![self addSample:sample])
+            {
+                return nil;
+            }
+        }
+
+        return self;
+    } else {
+        return nil;
+    }
+}
+
+- (instancetype) initWithUid: (NSString*) uid logPath: (NSString*) logPath
+{
+    if (self = [self initWithUid:uid])
+    {
+        _log = range_log_open([logPath fileSystemRepresentation], [uid UTF8String], &_store);
+        if(_log == NULL)
+        {
+            NSLog(@"Unable to open the sample log at %@.", logPath);
+            return nil;
+        }
+
+        // The derived data isn't saved. One pass over what was mapped in rebuilds it.
+        if(![self samplesChangedFromIndex:0])
+        {
+            return nil;
+        }
+
+        return self;
+    } else {
+        return nil;
+    }
+}
+
+- (void) dealloc
+{
+    // Chunks shared with frozen copies stay mapped after the log is closed.
+    range_store_destroy(&_store);
+    range_log_close(_log);
+    range_pyramid_destroy(&_pyramid);
+    range_gap_index_destroy(&_gaps);
+}
+
+#pragma mark - internal functions
+
+- (range_store_t *) store
+{
+    return &_store;
+}
+
+- (uint64_t) generation
+{
+    return _generation;
+}
+
+- (BOOL) syncLog
+{
+    if(_log == NULL)
+    {
+        return YES;
+    }
+    return range_log_sync(_log, &_store);
+}
+
+- (uint64_t) chunkLayoutVersion
+{
+    return _chunkLayoutVersion;
+}
+
+- (int) compressSealedChunks: (int) maxChunks
+{
+    if(_isFrozen)
+    {
+        return 0;
+    }
+
+    int swapped = range_store_compress_sealed(&_store, maxChunks);
+    if(swapped > 0)
+    {
+        _chunkLayoutVersion++;
+    }
+    return swapped;
+}
+
+- (BOOL) isFrozen
+{
+    return _isFrozen;
+}
+
+- (int) dropSamplesBefore: (double) time maxChunks: (int) maxChunks
+{
+    if(_isFrozen)
+    {
+        return 0;
+    }
+
+    int chunkCount = 0;
+    while(chunkCount < maxChunks && chunkCount < _store.chunk_count &&
+          (chunkCount + 1) * RANGE_STORE_CHUNK_CAPACITY <= _store.length &&
+          _store.bounds[chunkCount].last_time < time)
+    {
+        chunkCount++;
+    }
+    if(chunkCount == 0)
+    {
+        return 0;
+    }
+
+    double lastDroppedTime = _store.bounds[chunkCount - 1].last_time;
+    int dropped = _log != NULL ? range_log_drop_front(_log, &_store, chunkCount) : range_store_drop_front(&_store, chunkCount);
+    if(dropped == 0)
+    {
+        return 0;
+    }
+
+    // The summaries of the dropped samples stay. A rewind must never reach the buckets holding them,
+    // as there is nothing left to rebuild them from.
+    double floorTime = range_pyramid_sealed_after(&_pyramid, lastDroppedTime);
+    if(floorTime > _mergeFloorTime)
+    {
+        _mergeFloorTime = floorTime;
+    }
+
+    int droppedSamples = dropped * RANGE_STORE_CHUNK_CAPACITY;
+    _pyramidLength = _pyramidLength > droppedSamples ? _pyramidLength - droppedSamples : 0;
+    _gapsLength = _gapsLength > droppedSamples ? _gapsLength - droppedSamples : 0;
+    range_gap_index_drop_front(&_gaps, droppedSamples);
+    // Every gap sample index moved. Rare enough to simply start the list over.
+    _gapSamples = nil;
+    _gapSamplesLength = 0;
+    _generation++;
+    return dropped;
+}
+
+- (int) dropSummariesBefore: (double) time maxBlocks: (int) maxBlocks
+{
+    if(_isFrozen)
+    {
+        return 0;
+    }
+
+    int dropped = range_pyramid_drop_before(&_pyramid, time, maxBlocks);
+    if(dropped > 0)
+    {
+        _generation++;
+    }
+    return dropped;
+}
+
+- (RangeData*) frozenCopy
+{
+    if(_isFrozen)
+    {
+        return self;
+    }
+
+    RangeData* output = [[RangeData alloc] initWithUid:self.rangeUid];
+    range_store_destroy(&(output->_store));
+    if(!range_store_init_frozen_copy(&(output->_store), &_store))
+    {
+        NSLog(@"RDC - Out of memory.");
+        return nil;
+    }
+    range_pyramid_destroy(&(output->_pyramid));
+    if(!range_pyramid_init_frozen_copy(&(output->_pyramid), &_pyramid))
+    {
+        NSLog(@"RDC - Out of memory.");
+        return nil;
+    }
+    output->_pyramidLength = _pyramidLength;
+    range_gap_index_destroy(&(output->_gaps));
+    if(!range_gap_index_init_copy(&(output->_gaps), &_gaps))
+    {
+        NSLog(@"RDC - Out of memory.");
+        return nil;
+    }
+    output->_gapsLength = _gapsLength;
+    output->_gapLength = _gapLength;
+    output->_minSampleInterval = _minSampleInterval;
+    output->_mergeFloorTime = _mergeFloorTime;
+    output->_generation = _generation;
+    output->_chunkLayoutVersion = _chunkLayoutVersion;
+    output->_isFrozen = YES;
+    return output;
+}
+
+// Building the range_sample_t view writes to the store. Frozen copies can be read
+// by several threads at once so they serialize that on themselves (never on the live data).
+- (const range_sample_t *) rowAt: (int) index contiguous: (int*) contiguousOut
+{
+    if(_isFrozen)
+    {
+        @synchronized(self)
+        {
+            return range_store_row_at(&_store, index, contiguousOut);
+        }
+    }
+    return range_store_row_at(&_store, index, contiguousOut);
+}
+
+// Only the samples at or after fromIndex can have changed, so only those intervals are checked.
+- (void) updateSampleIntervalFromIndex: (int) fromIndex
+{
+    int start = fromIndex > 0 ? fromIndex : 1;
+    for(int i = start; i < _store.length; i++)
+    {
+        double interval = range_store_time_at(&_store, i) - range_store_time_at(&_store, i - 1);
+        if(interval > 0.0 && (_minSampleInterval == 0.0 || interval < _minSampleInterval))
+        {
+            _minSampleInterval = interval;
+        }
+    }
+}
+
+- (BOOL) updatePyramidFromIndex: (int) fromIndex
+{
+    if(fromIndex < _pyramidLength)
+    {
+        // Samples were rewritten. Throw away the buckets that could hold them and fold them in again.
+        double resumeTime = range_pyramid_rewind(&_pyramid, range_store_time_at(&_store, fromIndex));
+        _pyramidLength = range_store_lower_bound(&_store, resumeTime);
+    }
+
+    while(_pyramidLength < _store.length)
+    {
+        if(!range_pyramid_add(&_pyramid,
+                              range_store_time_at(&_store, _pyramidLength),
+                              range_store_temperature_at(&_store, _pyramidLength)))
+        {
+            NSLog(@"RDC - Out of memory.");
+            return NO;
+        }
+        _pyramidLength++;
+    }
+    return YES;
+}
+
+- (BOOL) updateGapsFromIndex: (int) fromIndex
+{
+    if(fromIndex < _gapsLength)
+    {
+        // Rewritten samples can un-hide gaps that were dropped, so start over. Only out of order merges get here.
+        range_gap_index_clear(&_gaps);
+        _gapsLength = 0;
+    }
+    if(fromIndex < _gapSamplesLength)
+    {
+        _gapSamples = nil;
+        _gapSamplesLength = 0;
+    }
+
+    int start = _gapsLength > 0 ? _gapsLength : 1;
+    for(int i = start; i < _store.length; i++)
+    {
+        double gap = range_store_time_at(&_store, i) - range_store_time_at(&_store, i - 1);
+        if(!range_gap_index_add(&_gaps, i, gap))
+        {
+            NSLog(@"RDC - Out of memory.");
+            return NO;
+        }
+        _gapsLength = i + 1;
+    }
+    return YES;
+}
+
+// Everything derived from the samples is brought up to date from fromIndex on.
+- (BOOL) samplesChangedFromIndex: (int) fromIndex
+{
+    [self updateSampleIntervalFromIndex:fromIndex];
+    BOOL pyramidUpdated = [self updatePyramidFromIndex:fromIndex];
+    BOOL gapsUpdated = [self updateGapsFromIndex:fromIndex];
+    return pyramidUpdated && gapsUpdated;
+}
+
+- (int) indexOfLatestGapLongerThan: (double) threshold
+{
+    int index = range_gap_index_latest(&_gaps, threshold);
+    return index < 0 ? kRangeIndexNotFound : index;
+}
+
+- (RangeGapSample*) gapSampleAt: (int) index isGapStart: (BOOL) isGapStart
+{
+    RangeGapSample* output = [[RangeGapSample alloc] init];
+    output.rangeUid = self.rangeUid;
+    output.sampleIndex = index;
+    output.sampleTime = range_store_time_at(&_store, index);
+    output.isGapStart = isGapStart;
+    return output;
+}
+
+// _gaps only keeps the gaps that can still be the latest one over some threshold, so the full list is kept here.
+- (void) calculateGaps
+{
+    int length = _store.length;
+    if(_gapSamples == nil)
+    {
+        _gapSamples = [NSMutableArray array];
+        _gapSamplesLength = 0;
+    }
+    if(length == 0)
+    {
+        return;
+    }
+
+    if(_gapSamplesLength == 0)
+    {
+        [_gapSamples addObject:[self gapSampleAt:0 isGapStart:NO]];
+        _gapSamplesLength = 1;
+    }
+    for(int i = _gapSamplesLength; i < length; i++)
+    {
+        if((range_store_time_at(&_store, i) - range_store_time_at(&_store, i - 1)) > _gapLength)
+        {
+            [_gapSamples addObject:[self gapSampleAt:(i - 1) isGapStart:YES]];
+            [_gapSamples addObject:[self gapSampleAt:i isGapStart:NO]];
+        }
+    }
+    _gapSamplesLength = length;
+}
+
++ (BOOL) enumerateSamplesOfRangeData: (NSArray*) rangeDatas fromStart: (double) startTime toStop: (double) stopTime usingBlock: (RangeSampleEnumerationBlock) block
+{
+    int count = (int)[rangeDatas count];
+    if(count == 0 || block == nil)
+    {
+        return YES;
+    }
+
+    const range_store_t** stores = malloc(sizeof(range_store_t*) * count);
+    if(stores == NULL)
+    {
+        NSLog(@"RDC - Out of memory.");
+        return NO;
+    }
+    for(int i = 0; i < count; i++)
+    {
+        stores[i] = [(RangeData*)rangeDatas[i] store];
+    }
+
+    range_merge_iterator_t iterator;
+    if(!range_merge_iterator_init(&iterator, stores, count, startTime, stopTime))
+    {
+        NSLog(@"RDC - Out of memory.");
+        free(stores);
+        return NO;
+    }
+
+    int source = 0;
+    range_sample_t sample;
+    BOOL stop = NO;
+    while(!stop && range_merge_iterator_next(&iterator, &source, &sample))
+    {
+        block(((RangeData*)rangeDatas[source]).rangeUid, sample, &stop);
+    }
+
+    range_merge_iterator_destroy(&iterator);
+    free(stores);
+    return YES;
+}
+
+- (BOOL) addSample: (range_sample_t) sample
+{
+    if(_isFrozen)
+    {
+        NSLog(@"Trying to add a sample to a frozen RangeData.");
+        return NO;
+    }
+
+    int length = _store.length;
+    if(length == 0 || range_store_time_at(&_store, length - 1) < sample.unix_time)
+    {
+        if(!range_store_append(&_store, sample.unix_time, sample.temperature))
+        {
+            NSLog(@"RDC - Out of memory.");
+            return NO;
+        }
+        return [self samplesChangedFromIndex:length];
+    }
+
+    if(sample.unix_time < _mergeFloorTime)
+    {
+        // A resend of something we already dropped.
+        return YES;
+    }
+
+    int split = range_store_lower_bound(&_store, sample.unix_time);
+    if(!range_store_merge(&_store, &sample.unix_time, &sample.temperature, 1))
+    {
+        NSLog(@"RDC - Out of memory.");
+        return NO;
+    }
+    _generation++;
+    return [self samplesChangedFromIndex:split];
+}
+
+- (BOOL) mergeWithRangeData: (RangeData*) other
+{
+    return [self mergeWithRangeData:other fromIndex:0];
+}
+
+// YES if every sample of otherStore in [startIndex, stopIndex) is already in our store.
+- (BOOL) containsSamplesFromStore: (range_store_t*) otherStore fromIndex: (int) startIndex toIndex: (int) stopIndex
+{
+    int index = range_store_lower_bound(&_store, range_store_time_at(otherStore, startIndex));
+    for(int i = startIndex; i < stopIndex; i++)
+    {
+        double time = range_store_time_at(otherStore, i);
+        while(index < _store.length && range_store_time_at(&_store, index) < time)
+        {
+            index++;
+        }
+        if(index == _store.length || range_store_time_at(&_store, index) != time)
+        {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+- (BOOL) mergeWithRangeData: (RangeData*) other fromIndex: (int) startIndex
+{
+    if(other == nil || other == self)
+    {
+        return YES;
+    }
+
+    if(_isFrozen)
+    {
+        NSLog(@"Trying to merge into a frozen RangeData.");
+        return NO;
+    }
+
+    if(![other.rangeUid isEqualToString:self.rangeUid])
+    {
+        NSLog(@"Trying to merge RangeData %@ into %@.", other.rangeUid, self.rangeUid);
+        return NO;
+    }
+
+    range_store_t* otherStore = [other store];
+    int otherLength = otherStore->length;
+    if(startIndex < 0)
+    {
+        startIndex = 0;
+    }
+    if(startIndex >= otherLength)
+    {
+        return YES;
+    }
+
+    // Everything in other after the high-water mark is new and goes straight on the end.
+    // Whatever comes before it is normally a resend of samples we already have.
+    int firstNewIndex = startIndex;
+    int oldLength = _store.length;
+    if(oldLength > 0)
+    {
+        double highWaterTime = range_store_time_at(&_store, oldLength - 1);
+        int firstAfterHighWater = range_store_upper_bound(otherStore, highWaterTime);
+        if(firstAfterHighWater > firstNewIndex)
+        {
+            firstNewIndex = firstAfterHighWater;
+        }
+    }
+
+    // Resends of samples we already dropped are skipped rather than merged back in.
+    int floorIndex = range_store_lower_bound(otherStore, _mergeFloorTime);
+    if(floorIndex > startIndex)
+    {
+        startIndex = floorIndex < firstNewIndex ? floorIndex : firstNewIndex;
+    }
+
+    BOOL success = YES;
+    int changedFromIndex = oldLength;
+
+    if(firstNewIndex > startIndex &&
+       ![self containsSamplesFromStore:otherStore fromIndex:startIndex toIndex:firstNewIndex])
+    {
+        // Out of order data. This is the only case that rewrites existing samples.
+        int length = otherLength - startIndex;
+        double* times = malloc(sizeof(double) * length);
+        float* temperatures = malloc(sizeof(float) * length);
+        success = (times != NULL && temperatures != NULL);
+        if(success)
+        {
+            for(int i = 0; i < length; i++)
+            {
+                times[i] = range_store_time_at(otherStore, startIndex + i);
+                temperatures[i] = range_store_temperature_at(otherStore, startIndex + i);
+            }
+            changedFromIndex = range_store_lower_bound(&_store, times[0]);
+            success = range_store_merge(&_store, times, temperatures, length);
+        }
+        free(times);
+        free(temperatures);
+        _generation++;
+    } else {
+        // Plain tail append, one chunk of the other store at a time.
+        int index = firstNewIndex;
+        while(success && index < otherLength)
+        {
+            int chunkIndex = index / RANGE_STORE_CHUNK_CAPACITY;
+            range_chunk_t* chunk = otherStore->chunks[chunkIndex];
+            const double* times = range_chunk_times(chunk);
+            const float* temperatures = range_chunk_temperatures(chunk);
+            int offset = index % RANGE_STORE_CHUNK_CAPACITY;
+            int count = range_store_chunk_length(otherStore, chunkIndex) - offset;
+            success = (times != NULL && temperatures != NULL) &&
+                      range_store_append_run(&_store, times + offset, temperatures + offset, count);
+            index += count;
+        }
+    }
+
+    if(!success)
+    {
+        NSLog(@"RDC - Out of memory.");
+    }
+
+    if(![self samplesChangedFromIndex:changedFromIndex])
+    {
+        success = NO;
+    }
+    return success;
+}
+
+#pragma mark - public functions
+
+- (NSNumber *) sampleRateInHz
+{
+    if(_minSampleInterval <= 0.0)
+    {
+        return nil;
+    }
+    return [NSNumber numberWithDouble:(1.0 / _minSampleInterval)];
+}
+
+- (double) compressionRatio
+{
+    size_t rawBytes = 0;
+    size_t storedBytes = 0;
+    range_store_memory_usage(&_store, &rawBytes, &storedBytes);
+    if(storedBytes == 0)
+    {
+        return 1.0;
+    }
+    return (double)rawBytes / (double)storedBytes;
+}
+
+- (size_t) bytesInMemory
+{
+    size_t rawBytes = 0;
+    size_t output = 0;
+    // Includes the range_sample_t views.
+    range_store_memory_usage(&_store, &rawBytes, &output);
+    output += range_pyramid_memory_usage(&_pyramid);
+    output += sizeof(range_gap_t) * _gaps.capacity;
+    return output;
+}
+
+- (const range_sample_t *) sampleAt: (int) index
+{
+    return [self rowAt:index contiguous:NULL];
+}
+
+- (int) length
+{
+    return _store.length;
+}
+
+- (const range_sample_t *) latestSample
+{
+    return [self rowAt:(_store.length - 1) contiguous:NULL];
+}
+
+- (float) interpolateTemperatureAtTime: (double) time outIntervalInterpolated: (double*) intevalInterpolatedOver
+{
+    double interval = -1.0;
+    float output = 0.0f;
+    int length = _store.length;
+
+    if(length > 0)
+    {
+        int index = range_store_lower_bound(&_store, time);
+        if(index == length)
+        {
+            // After the last sample
+            output = range_store_temperature_at(&_store, length - 1);
+        }
+        else if(range_store_time_at(&_store, index) == time)
+        {
+            output = range_store_temperature_at(&_store, index);
+            interval = 0.0;
+        }
+        else if(index == 0)
+        {
+            // Before the first sample
+            output = range_store_temperature_at(&_store, 0);
+        } else {
+            double t0 = range_store_time_at(&_store, index - 1);
+            double t1 = range_store_time_at(&_store, index);
+            float v0 = range_store_temperature_at(&_store, index - 1);
+            float v1 = range_store_temperature_at(&_store, index);
+
+            interval = t1 - t0;
+            output = v0 + (v1 - v0) * (float)((time - t0) / interval);
+        }
+    }
+
+    if(intevalInterpolatedOver != NULL)
+    {
+        *intevalInterpolatedOver = interval;
+    }
+    return output;
+}
+
+- (void) interpolateTemperaturesAtTimes: (const double*) times count: (int) count outTemperatures: (float*) temperaturesOut outIntervalsInterpolated: (double*) intervalsInterpolatedOver
+{
+    if(times == NULL || temperaturesOut == NULL || count <= 0)
+    {
+        return;
+    }
+    range_store_interpolate(&_store, times, count, temperaturesOut, intervalsInterpolatedOver);
+}
+
+- (const range_sample_t *) findClosestSampleAtTime: (double) time
+{
+    int index = [self findClosestSampleIndexAtTime:time];
+    if(index == kRangeIndexNotFound)
+    {
+        return NULL;
+    }
+    return [self rowAt:index contiguous:NULL];
+}
+
+- (int) findClosestSampleIndexAtTime: (double) time
+{
+    int length = _store.length;
+    if(length == 0)
+    {
+        return kRangeIndexNotFound;
+    }
+
+    int index = range_store_lower_bound(&_store, time);
+    if(index == length)
+    {
+        return length - 1;
+    }
+    if(index > 0 &&
+       (time - range_store_time_at(&_store, index - 1)) <= (range_store_time_at(&_store, index) - time))
+    {
+        return index - 1;
+    }
+    return index;
+}
+
+- (const range_sample_t *) findSampleAtTime: (double) time
+{
+    int index = [self findSampleIndexAtTime:time];
+    if(index == kRangeIndexNotFound)
+    {
+        return NULL;
+    }
+    return [self rowAt:index contiguous:NULL];
+}
+
+- (int) findSampleIndexAtTime: (double) time
+{
+    int index = range_store_lower_bound(&_store, time);
+    if(index == _store.length || range_store_time_at(&_store, index) != time)
+    {
+        return kRangeIndexNotFound;
+    }
+    return index;
+}
+
+- (NSArray*) gaps
+{
+    // Frozen copies are shared with other threads and the list is built lazily.
+    @synchronized(self)
+    {
+        [self calculateGaps];
+        NSMutableArray* output = [_gapSamples mutableCopy];
+        int length = _store.length;
+        if(length > 1)
+        {
+            [output addObject:[self gapSampleAt:(length - 1) isGapStart:YES]];
+        }
+        return output;
+    }
+}
+
+- (void) changeGapLength: (double) seconds
+{
+    @synchronized(self)
+    {
+        if(seconds > kRDMinimumGapLength)
+        {
+            _gapLength = seconds;
+        }
+        _gapSamples = nil;
+        _gapSamplesLength = 0;
+        [self calculateGaps];
+    }
+}
+
+- (const range_sample_t *) findSamplesFromStart: (double) startTime toStop: (double) stopTime withOutputLength:(int*) lengthOut
+{
+    int length = 0;
+    int index = [self findSamplesIndexFromStart:startTime toStop:stopTime withOutputLength:&length];
+    const range_sample_t* output = NULL;
+
+    if(index != kRangeIndexNotFound)
+    {
+        int contiguous = 0;
+        output = [self rowAt:index contiguous:&contiguous];
+
+        if(output != NULL && contiguous < length)
+        {
+            // The window crosses into another chunk. Hand back a copy that lives until the pool drains.
+            NSMutableData* window = [NSMutableData dataWithLength:sizeof(range_sample_t) * length];
+            range_sample_t* windowSamples = [window mutableBytes];
+            for(int i = 0; i < length; i++)
+            {
+                windowSamples[i].temperature = range_store_temperature_at(&_store, index + i);
+                windowSamples[i].unix_time = range_store_time_at(&_store, index + i);
+            }
+            output = windowSamples;
+        }
+
+        if(output == NULL)
+        {
+            length = 0;
+        }
+    }
+
+    if(lengthOut != NULL)
+    {
+        *lengthOut = length;
+    }
+    return output;
+}
+
+- (int) summarizeFromStart: (double) startTime toStop: (double) stopTime maxBuckets: (int) maxBuckets output: (range_bucket_t*) bucketsOut
+{
+    if(bucketsOut == NULL)
+    {
+        return 0;
+    }
+    return range_pyramid_query(&_pyramid, startTime, stopTime, maxBuckets, bucketsOut);
+}
+
+// range_writer_sink_t for an NSOutputStream.
+static bool rd_write_to_stream(void* context, const char* data, size_t length)
+{
+    NSOutputStream* stream = (__bridge NSOutputStream*) context;
+    size_t written = 0;
+    while(written < length)
+    {
+        NSInteger result = [stream write:(const uint8_t*) data + written maxLength:length - written];
+        if(result <= 0)
+        {
+            return false;
+        }
+        written += result;
+    }
+    return true;
+}
+
+- (BOOL) exportFromStart: (double) startTime toStop: (double) stopTime as: (RangeDataExportType) exportType
+              withFormat: (RangeTemperaturePrintFormat) formatType toScale: (RangeTemperatureScale) scaleType
+                toStream: (NSOutputStream*) stream
+{
+    range_sample_writer_t writer;
+    int kind = exportType == kRangeDataExportTypeJSON ? RANGE_WRITER_JSON : RANGE_WRITER_CSV;
+    if(!range_sample_writer_init(&writer, kind, (int) scaleType, (int) formatType, rd_write_to_stream, (__bridge void*) stream))
+    {
+        NSLog(@"%s - Not a temperature scale and format that can be printed.", __PRETTY_FUNCTION__);
+        return NO;
+    }
+
+    int length = 0;
+    int index = [self findSamplesIndexFromStart:startTime toStop:stopTime withOutputLength:&length];
+    // A chunk at a time, straight from the chunk's columns. No row views are made.
+    for(int done = 0; index != kRangeIndexNotFound && done < length; )
+    {
+        int chunkIndex = (index + done) / RANGE_STORE_CHUNK_CAPACITY;
+        range_chunk_t* chunk = _store.chunks[chunkIndex];
+        const double* times = range_chunk_times(chunk);
+        const float* temperatures = range_chunk_temperatures(chunk);
+        if(times == NULL || temperatures == NULL)
+        {
+            NSLog(@"RDC - Out of memory.");
+            return NO;
+        }
+        int offset = (index + done) % RANGE_STORE_CHUNK_CAPACITY;
+        int count = MIN(range_store_chunk_length(&_store, chunkIndex) - offset, length - done);
+        if(!range_sample_writer_write_columns(&writer, times + offset, temperatures + offset, count))
+        {
+            NSLog(@"%s - Writing to the stream failed.", __PRETTY_FUNCTION__);
+            return NO;
+        }
+        done += count;
+    }
+
+    if(!range_sample_writer_finish(&writer))
+    {
+        NSLog(@"%s - Writing to the stream failed.", __PRETTY_FUNCTION__);
+        return NO;
+    }
+    return YES;
+}
+
+- (BOOL) copySamplesFromIndex: (int) index length: (int) length toTimes: (double*) times temperatures: (float*) temperatures
+{
+    if(index < 0 || length < 0 || index + length > _store.length)
+    {
+        return NO;
+    }
+
+    for(int done = 0; done < length; )
+    {
+        int chunkIndex = (index + done) / RANGE_STORE_CHUNK_CAPACITY;
+        range_chunk_t* chunk = _store.chunks[chunkIndex];
+        const double* chunkTimes = range_chunk_times(chunk);
+        const float* chunkTemperatures = range_chunk_temperatures(chunk);
+        if(chunkTimes == NULL || chunkTemperatures == NULL)
+        {
+            NSLog(@"RDC - Out of memory.");
+            return NO;
+        }
+        int offset = (index + done) % RANGE_STORE_CHUNK_CAPACITY;
+        int count = MIN(range_store_chunk_length(&_store, chunkIndex) - offset, length - done);
+        memcpy(times + done, chunkTimes + offset, sizeof(double) * count);
+        memcpy(temperatures + done, chunkTemperatures + offset, sizeof(float) * count);
+        done += count;
+    }
+    return YES;
+}
+
+- (int) findSamplesIndexFromStart: (double) startTime toStop: (double) stopTime withOutputLength:(int*) lengthOut
+{
+    int first = range_store_lower_bound(&_store, startTime);
+    int end = range_store_upper_bound(&_store, stopTime);
+    int length = end - first;
+
+    if(length <= 0)
+    {
+        if(lengthOut != NULL)
+        {
+            *lengthOut = 0;
+        }
+        return kRangeIndexNotFound;
+    }
+
+    if(lengthOut != NULL)
+    {
+        *lengthOut = length;
+    }
+    return first;
+}
+
+@end
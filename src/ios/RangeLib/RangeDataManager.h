@@ -19,6 +19,8 @@
 
 #import <Foundation/Foundation.h>
 #import "RangeData.h"
+#import "RangeDataSnapshot.h"
+#import "RangeTrigger.h"
 
 /*!
  This class contains a set of RangeDatas and allows for easy searching of datapoints and datapoint ranges.
@@ -56,6 +58,12 @@
  */
 - (const range_sample_t *) latestSample: (NSString **) outUid;
 
+/*!
+ Get the most recent (latest time) sample of one Range.
+ @return Reference to the latest sample of that Range. NULL if there are no samples for the uid.
+ */
+- (const range_sample_t *) latestSampleFromRange: (NSString *) uid;
+
 /*!
  Get the earliest (by time) sample read. By any Range uid.
  @param outUid returns the uid of the Range with the earliest sample
@@ -63,6 +71,91 @@
  */
 - (const range_sample_t *) earliestSample: (NSString **) outUid;
 
+/*!
+ Goes through the samples of every Range in time order, as if they were one list.
+ Samples with the same time come one after the other in no particular order of uid.
+ Nothing is allocated per sample, and each sample costs O(log n) in the number of Ranges.
+ Must be called on the thread that refreshes the Range (use snapshot for other threads).
+ @param startTime Only samples at or after this time.
+ @param stopTime Only samples at or before this time.
+ @param block Called with the uid and the sample. Set *stop to YES to end early.
+ @return NO if we ran out of memory.
+ */
+- (BOOL) enumerateSamplesFromStart: (double) startTime toStop: (double) stopTime usingBlock: (RangeSampleEnumerationBlock) block;
+
+/*!
+ The snapshot published by the last refresh.
+ This can be called from any thread without locking. Hold on to the result
+ for as long as you are reading from it; it never changes underneath you.
+ @return The latest snapshot. An empty snapshot if nothing has been published yet.
+ */
+- (RangeDataSnapshot*) snapshot;
+
+/*!
+ Keep the data of every Range in a file in directory, so it survives the app being killed or restarted.
+ Data already in directory (from an earlier run) is loaded right away. That only maps the files in,
+ so reopening a long session is quick and only the parts you look at are read from disk.
+ Data already in this RangeDataManager is copied into the files.
+ @param directory Where to keep the files. Created if it doesn't exist.
+ @return NO if directory can't be used. Data that could not be put in a file stays in memory.
+ */
+- (BOOL) persistToDirectory:(NSString*) directory;
+
+/*!
+ Limit how much history is kept in memory (and in the files given to persistToDirectory:).
+ Samples older than rawSeconds (counting back from the latest sample of any Range) are dropped,
+ but their min/max/mean summaries (see RangeData summarizeFromStart:toStop:maxBuckets:output:) are kept
+ until they are older than summarySeconds. Samples go a chunk (4096 samples) at a time,
+ a few chunks every time the Range object is refreshed.
+ Indices and sample pointers of a RangeData change when its old samples are dropped.
+ Summaries of dropped samples are not saved, so they are gone after a restart.
+ @param rawSeconds How long to keep every sample. 0 keeps them all (the default).
+ @param summarySeconds How long to keep the summaries. 0 keeps them all (the default).
+ */
+- (void) retainRawSamplesFor:(double) rawSeconds summariesFor:(double) summarySeconds;
+
+/*!
+ How much memory the data of every Range takes up (see RangeData bytesInMemory).
+ @return Maps the Range uid to an NSNumber with the number of bytes.
+ */
+- (NSDictionary*) bytesHeldByRange;
+
+/*!
+ Start keeping statistics over the last seconds of one Range (for rate of rise, stall detection and the like).
+ The window is filled from the data already there and kept up to date as samples come in,
+ so reading it with rollingWindowOf:forRange:stats: is O(1). Adding the same window twice does nothing.
+ @param seconds Width of the window, counting back from the newest sample of the Range.
+ @param uid The Range. It doesn't need to have any data yet.
+ @return NO if seconds isn't positive or we ran out of memory.
+ */
+- (BOOL) addRollingWindowOf:(double) seconds forRange:(NSString*) uid;
+
+/*!
+ Stop keeping the window added with addRollingWindowOf:forRange:.
+ */
+- (void) removeRollingWindowOf:(double) seconds forRange:(NSString*) uid;
+
+/*!
+ Statistics of a window added with addRollingWindowOf:forRange:, as of the last refresh.
+ Must be called on the thread that refreshes the Range.
+ @param statsOut Gets min, max, mean, standard deviation and slope (degrees per minute) of the samples in the window.
+ @return NO if there is no such window.
+ */
+- (BOOL) rollingWindowOf:(double) seconds forRange:(NSString*) uid stats:(range_window_stats_t*) statsOut;
+
+/*!
+ Estimates how long until the temperature of one Range reaches the temperature of trigger going the trigger's
+ direction, from the least squares line through a window added with addRollingWindowOf:forRange:.
+ The line is kept up to date as samples come in however the trigger itself is checked
+ (on its own or in a RangeTriggerSet), so this is O(1) and cheap to call every refresh.
+ Must be called on the thread that refreshes the Range.
+ @param secondsOut Gets the seconds from the newest sample. 0 if the line is already past the trigger temperature (rising and falling triggers).
+ @param confidenceOut Gets 0 to 1: how well the line fits the samples, less when the estimate reaches further ahead than the window is wide. Can be NULL.
+ @return NO if there is no such window, the temperature isn't heading that way or there isn't enough data.
+ */
+- (BOOL) rollingWindowOf:(double) seconds forRange:(NSString*) uid timeToTrigger:(RangeTrigger*) trigger
+                 seconds:(double*) secondsOut confidence:(float*) confidenceOut;
+
 /*!
  Change the gap length used to get the last gap seen.
  @param thresholdInSeconds Sets the gap size to look for when filtering out data that is unwanted.
@@ -73,6 +166,8 @@
  Get the first sample after the last "long" gap seen.
  This should be used when graphing data when you don't want to show all data but 
  instead the most recent data that the user likely wants to see.
+ Gaps are recorded as samples come in and the answer is kept until the data or the threshold changes,
+ so this is cheap enough to call on every UI update.
  @param outUid returns the uid of the Range with the sample after the latest gap seen. Returns kRDIllegalUid if there is no gap.
  @return Reference to the sample after the latest gap. NULL if there are no gaps seen for this manager.
  */
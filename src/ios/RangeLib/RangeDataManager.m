@@ -0,0 +1,824 @@
+//
+//  RangeDataManager.m
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifdef __APPLE__
+#include "TargetConditionals.h"
+#endif
+
+#import "RangeDataManager_internal.h"
+
+// A minute without data is long enough that the user has most likely started something new.
+const double kRDDefaultGapThreshold = 60.0;
+
+// Number of ring entries copied out per pop. Small enough to live on the stack.
+#define kRDRingDrainBatch 256
+
+// Chunks compressed (or resealed) per refresh, over all uids. Keeps each refresh short.
+#define kRDCompressChunksPerRefresh 4
+
+// Chunks of samples (and blocks of summaries) dropped per refresh, over all uids.
+#define kRDRetentionChunksPerRefresh 8
+
+// Seconds between the log syncs refreshes ask for. Every sync waits on the disk, twice per dirty chunk.
+#define kRDSyncInterval 10.0
+
+static NSString* rdm_uid_string(const range_uid_t* uid)
+{
+    NSMutableString* output = [NSMutableString stringWithCapacity:(uid->length * 2)];
+    for(int i = 0; i < uid->length; i++)
+    {
+        [output appendFormat:@"%02X", uid->bytes[i]];
+    }
+    return output;
+}
+
+static double rdm_first_time(RangeData* rData)
+{
+    return range_store_time_at([rData store], 0);
+}
+
+static double rdm_last_time(RangeData* rData)
+{
+    range_store_t* store = [rData store];
+    return range_store_time_at(store, store->length - 1);
+}
+
+static BOOL rdm_uid_equal(const range_uid_t* a, const range_uid_t* b)
+{
+    return a->length == b->length && memcmp(a->bytes, b->bytes, a->length) == 0;
+}
+
+/*!
+ Remembers how much of the last RangeData merged for a uid was already merged.
+ RangeAudioInput hands over a new RangeData with the whole history on every refresh,
+ so this can't depend on getting the same object again.
+ */
+@interface RangeDataMergeCursor : NSObject
+
+@property (assign, readwrite) double firstMergedTime;
+@property (assign, readwrite) double lastMergedTime;
+@property (assign, readwrite) int sourceLength;
+
+@end
+
+@implementation RangeDataMergeCursor
+@end
+
+
+/*!
+ A rolling window registered for one uid, and how much of its RangeData it has seen.
+ */
+@interface RangeRollingWindowState : NSObject
+{
+    range_window_t _window;
+}
+
+@property (weak, readwrite) RangeData* source;
+@property (assign, readwrite) uint64_t sourceGeneration;
+@property (assign, readwrite) int sourceLength;
+
+- (instancetype) initWithWidth: (double) seconds;
+- (double) width;
+- (BOOL) feedFrom: (RangeData*) rData;
+- (void) stats: (range_window_stats_t*) statsOut;
+- (BOOL) timeTo: (float) temperature direction: (int) direction seconds: (double*) secondsOut confidence: (float*) confidenceOut;
+
+@end
+
+@implementation RangeRollingWindowState
+
+- (instancetype) initWithWidth: (double) seconds
+{
+    if (self = [super init])
+    {
+        range_window_init(&_window, seconds);
+
+        return self;
+    } else {
+        return nil;
+    }
+}
+
+- (void) dealloc
+{
+    range_window_destroy(&_window);
+}
+
+- (double) width
+{
+    return _window.width;
+}
+
+// Adds the samples of rData we haven't seen yet.
+- (BOOL) feedFrom: (RangeData*) rData
+{
+    range_store_t* store = [rData store];
+    int index = self.sourceLength;
+    if(self.source != rData || self.sourceGeneration != [rData generation] || index > store->length)
+    {
+        // Samples were rewritten or dropped. Start over with the ones that are in the window now.
+        range_window_clear(&_window);
+        index = store->length > 0 ? range_store_lower_bound(store, range_store_time_at(store, store->length - 1) - _window.width) : 0;
+    }
+
+    BOOL output = YES;
+    for(; index < store->length; index++)
+    {
+        // A NaN would spoil the running sums for good.
+        float temperature = range_store_temperature_at(store, index);
+        if(isnan(temperature))
+        {
+            continue;
+        }
+        if(!range_window_add(&_window, range_store_time_at(store, index), temperature))
+        {
+            NSLog(@"RDC - Out of memory.");
+            output = NO;
+            break;
+        }
+    }
+
+    self.source = rData;
+    self.sourceGeneration = [rData generation];
+    self.sourceLength = index;
+    return output;
+}
+
+- (void) stats: (range_window_stats_t*) statsOut
+{
+    range_window_stats(&_window, statsOut);
+}
+
+- (BOOL) timeTo: (float) temperature direction: (int) direction seconds: (double*) secondsOut confidence: (float*) confidenceOut
+{
+    return range_window_time_to(&_window, temperature, direction, secondsOut, confidenceOut);
+}
+
+@end
+
+
+@interface RangeDataManager()
+
+@property (assign, readwrite) double gapThresholdValue;
+// How long samples and their summaries are kept. 0 keeps them forever.
+@property (assign, readwrite) double rawRetentionSeconds;
+@property (assign, readwrite) double summaryRetentionSeconds;
+// nil unless persistToDirectory: was called.
+@property (strong, readwrite) NSString* persistenceDirectory;
+// CFAbsoluteTime of the last syncPersistentData, 0 before the first.
+@property (assign, readwrite) double lastSyncTime;
+// maps the Range uid to the RangeDataMergeCursor of the last RangeData merged for it
+@property (strong, readwrite) NSMutableDictionary* mergeCursors;
+// maps the Range uid to an NSMutableArray of the RangeRollingWindowStates registered for it
+@property (strong, readwrite) NSMutableDictionary* rollingWindows;
+// endOfLatestGap: result, kept until the data or the threshold changes.
+@property (assign, readwrite) BOOL latestGapValid;
+@property (strong, readwrite) RangeData* latestGapData;
+@property (assign, readwrite) int latestGapIndex;
+// latestSample: and earliestSample: results. Kept up to date as samples are merged in.
+@property (assign, readwrite) BOOL extremesValid;
+@property (strong, readwrite) RangeData* latestData;
+@property (strong, readwrite) RangeData* earliestData;
+// Set when RangeData objects were swapped out, so publishSnapshot can't reuse the frozen copies it has.
+@property (assign, readwrite) BOOL snapshotNeedsFullCopy;
+// Swapped in whole by publishSnapshot. atomic so readers on other threads always get a complete one.
+@property (atomic, strong, readwrite) RangeDataSnapshot* latestSnapshot;
+
+@end
+
+
+@implementation RangeDataManager
+
+- (instancetype) init
+{
+    if (self = [super init])
+    {
+        self.dataDict = [NSMutableDictionary dictionary];
+        self.mergeCursors = [NSMutableDictionary dictionary];
+        self.rollingWindows = [NSMutableDictionary dictionary];
+        self.latestSnapshot = [[RangeDataSnapshot alloc] init];
+        self.gapThresholdValue = kRDDefaultGapThreshold;
+        self.latestGapValid = NO;
+        self.extremesValid = NO;
+
+        return self;
+    } else {
+        return nil;
+    }
+}
+
+-(NSString*) logPathForUid:(NSString*) uid
+{
+    NSString* fileName = [uid stringByAppendingPathExtension:@RANGE_LOG_FILE_EXTENSION];
+    return [self.persistenceDirectory stringByAppendingPathComponent:fileName];
+}
+
+-(RangeData*) rangeDataCreatedIfNeeded:(NSString*) uid
+{
+    RangeData* output = self.dataDict[uid];
+    if(output == nil)
+    {
+        if(self.persistenceDirectory != nil)
+        {
+            output = [[RangeData alloc] initWithUid:uid logPath:[self logPathForUid:uid]];
+        }
+        if(output == nil)
+        {
+            output = [[RangeData alloc] initWithUid:uid];
+        }
+        self.dataDict[uid] = output;
+    }
+    return output;
+}
+
+- (BOOL) persistToDirectory:(NSString*) directory
+{
+    NSError* error = nil;
+    if(![[NSFileManager defaultManager] createDirectoryAtPath:directory
+                                  withIntermediateDirectories:YES
+                                                   attributes:nil
+                                                        error:&error])
+    {
+        NSLog(@"Unable to create %@: %@", directory, error);
+        return NO;
+    }
+    self.persistenceDirectory = directory;
+
+    NSMutableSet* uids = [NSMutableSet setWithArray:[self.dataDict allKeys]];
+    for(NSString* fileName in [[NSFileManager defaultManager] contentsOfDirectoryAtPath:directory error:NULL])
+    {
+        if([[fileName pathExtension] isEqualToString:@RANGE_LOG_FILE_EXTENSION])
+        {
+            [uids addObject:[fileName stringByDeletingPathExtension]];
+        }
+    }
+
+    BOOL output = YES;
+    for(NSString* uid in uids)
+    {
+        RangeData* inMemory = self.dataDict[uid];
+        RangeData* persisted = [[RangeData alloc] initWithUid:uid logPath:[self logPathForUid:uid]];
+        if(persisted == nil)
+        {
+            output = NO;
+            continue;
+        }
+
+        if(inMemory != nil && ![persisted mergeWithRangeData:inMemory])
+        {
+            output = NO;
+            continue;
+        }
+        self.dataDict[uid] = persisted;
+    }
+
+    self.latestGapValid = NO;
+    self.extremesValid = NO;
+    self.snapshotNeedsFullCopy = YES;
+    [self syncPersistentData];
+    return output;
+}
+
+-(void) compressSealedData
+{
+    int budget = kRDCompressChunksPerRefresh;
+    for(RangeData* rData in [self.dataDict allValues])
+    {
+        if(budget <= 0)
+        {
+            break;
+        }
+        budget -= [rData compressSealedChunks:budget];
+    }
+}
+
+- (void) retainRawSamplesFor:(double) rawSeconds summariesFor:(double) summarySeconds
+{
+    self.rawRetentionSeconds = rawSeconds > 0.0 ? rawSeconds : 0.0;
+    self.summaryRetentionSeconds = summarySeconds > 0.0 ? summarySeconds : 0.0;
+}
+
+-(void) applyRetention
+{
+    if(self.rawRetentionSeconds <= 0.0 && self.summaryRetentionSeconds <= 0.0)
+    {
+        return;
+    }
+
+    // Time is measured by the data, not the clock, so replaying an old session keeps all of it.
+    BOOL haveSamples = NO;
+    double latestTime = 0.0;
+    for(RangeData* rData in [self.dataDict allValues])
+    {
+        range_store_t* store = [rData store];
+        if(store->length > 0)
+        {
+            double time = range_store_time_at(store, store->length - 1);
+            if(!haveSamples || time > latestTime)
+            {
+                latestTime = time;
+                haveSamples = YES;
+            }
+        }
+    }
+    if(!haveSamples)
+    {
+        return;
+    }
+
+    int budget = kRDRetentionChunksPerRefresh;
+    for(RangeData* rData in [self.dataDict allValues])
+    {
+        if(budget > 0 && self.rawRetentionSeconds > 0.0)
+        {
+            int dropped = [rData dropSamplesBefore:(latestTime - self.rawRetentionSeconds) maxChunks:budget];
+            if(dropped > 0)
+            {
+                self.latestGapValid = NO;
+                self.extremesValid = NO;
+            }
+            budget -= dropped;
+        }
+        if(budget > 0 && self.summaryRetentionSeconds > 0.0)
+        {
+            budget -= [rData dropSummariesBefore:(latestTime - self.summaryRetentionSeconds) maxBlocks:budget];
+        }
+    }
+}
+
+- (NSDictionary*) bytesHeldByRange
+{
+    NSMutableDictionary* output = [NSMutableDictionary dictionaryWithCapacity:[self.dataDict count]];
+    for(NSString* uid in self.dataDict)
+    {
+        output[uid] = [NSNumber numberWithUnsignedLongLong:[self.dataDict[uid] bytesInMemory]];
+    }
+    return output;
+}
+
+-(void) syncPersistentDataIfDue
+{
+    double now = CFAbsoluteTimeGetCurrent();
+    if(self.lastSyncTime > 0.0 && now - self.lastSyncTime < kRDSyncInterval)
+    {
+        return;
+    }
+    [self syncPersistentData];
+}
+
+-(void) syncPersistentData
+{
+    if(self.persistenceDirectory == nil)
+    {
+        return;
+    }
+    self.lastSyncTime = CFAbsoluteTimeGetCurrent();
+
+    for(RangeData* rData in [self.dataDict allValues])
+    {
+        if(![rData syncLog])
+        {
+            NSLog(@"Unable to save the samples of %@.", rData.rangeUid);
+        }
+    }
+}
+
+-(BOOL) addRangeData:(RangeData*) rData
+{
+    if(rData == nil || rData.rangeUid == nil)
+    {
+        return NO;
+    }
+
+    RangeData* existing = [self rangeDataCreatedIfNeeded:rData.rangeUid];
+
+    // If rData starts with exactly what the last RangeData for this uid had (same first and last
+    // time, same number of samples up to there), only the samples after that need to be looked at.
+    // That is two lookups, however long the history is.
+    RangeDataMergeCursor* cursor = self.mergeCursors[rData.rangeUid];
+    range_store_t* source = [rData store];
+    int startIndex = 0;
+    if(cursor != nil && source->length > 0 &&
+       range_store_time_at(source, 0) == cursor.firstMergedTime)
+    {
+        int mergedLength = range_store_upper_bound(source, cursor.lastMergedTime);
+        if(mergedLength == cursor.sourceLength &&
+           range_store_time_at(source, mergedLength - 1) == cursor.lastMergedTime)
+        {
+            startIndex = mergedLength;
+        }
+    }
+
+    BOOL output = [existing mergeWithRangeData:rData fromIndex:startIndex];
+    self.latestGapValid = NO;
+    [self samplesAddedTo:existing];
+
+    if(source->length > 0)
+    {
+        if(cursor == nil)
+        {
+            cursor = [[RangeDataMergeCursor alloc] init];
+            self.mergeCursors[rData.rangeUid] = cursor;
+        }
+        cursor.firstMergedTime = range_store_time_at(source, 0);
+        cursor.lastMergedTime = range_store_time_at(source, source->length - 1);
+        cursor.sourceLength = source->length;
+    }
+
+    return output;
+}
+
+-(BOOL) addRangeManager:(RangeDataManager*) rManager
+{
+    if(rManager == nil)
+    {
+        return NO;
+    }
+
+    BOOL output = YES;
+    for(RangeData* rData in [rManager.dataDict allValues])
+    {
+        if(![self addRangeData:rData])
+        {
+            NSLog(@"addRangeData failed!");
+            output = NO;
+        }
+    }
+    return output;
+}
+
+-(BOOL) addSamplesFromRing:(range_ring_t*) ring
+{
+    if(ring == NULL)
+    {
+        return NO;
+    }
+
+    BOOL output = YES;
+    range_ring_entry_t entries[kRDRingDrainBatch];
+    range_uid_t currentUid;
+    RangeData* currentData = nil;
+
+    self.latestGapValid = NO;
+
+    // Only take what is there now (at most one ring's worth) so a busy producer can't keep us here.
+    size_t remaining = range_ring_capacity(ring);
+    while(remaining > 0)
+    {
+        size_t count = range_ring_pop(ring, entries, MIN(remaining, (size_t)kRDRingDrainBatch));
+        if(count == 0)
+        {
+            break;
+        }
+        remaining -= count;
+
+        for(size_t i = 0; i < count; i++)
+        {
+            // Samples almost always come from the same Range as the one before.
+            if(currentData == nil || !rdm_uid_equal(&currentUid, &entries[i].uid))
+            {
+                [self samplesAddedTo:currentData];
+                currentUid = entries[i].uid;
+                currentData = [self rangeDataCreatedIfNeeded:rdm_uid_string(&currentUid)];
+            }
+
+            if(![currentData addSample:entries[i].sample])
+            {
+                output = NO;
+            }
+        }
+    }
+    [self samplesAddedTo:currentData];
+
+    return output;
+}
+
+-(void) publishSnapshot
+{
+    RangeDataSnapshot* previous = self.latestSnapshot;
+    NSMutableDictionary* frozenData = [NSMutableDictionary dictionaryWithCapacity:[self.dataDict count]];
+    BOOL changed = [[previous rangeIdsWithData] count] != [self.dataDict count] || self.snapshotNeedsFullCopy;
+
+    for(NSString* uid in self.dataDict)
+    {
+        RangeData* rData = self.dataDict[uid];
+        RangeData* previousData = [previous getDataByRange:uid];
+
+        // Reuse the frozen copy from the last snapshot if nothing happened to this uid.
+        if(previousData != nil &&
+           !self.snapshotNeedsFullCopy &&
+           [previousData generation] == [rData generation] &&
+           [previousData chunkLayoutVersion] == [rData chunkLayoutVersion] &&
+           [previousData length] == [rData length])
+        {
+            frozenData[uid] = previousData;
+            continue;
+        }
+
+        RangeData* frozen = [rData frozenCopy];
+        if(frozen == nil)
+        {
+            // Out of memory. Keep showing the old data rather than nothing.
+            if(previousData != nil)
+            {
+                frozenData[uid] = previousData;
+            }
+            continue;
+        }
+        frozenData[uid] = frozen;
+        changed = YES;
+    }
+
+    if(changed)
+    {
+        self.latestSnapshot = [[RangeDataSnapshot alloc] initWithFrozenData:frozenData
+                                                                    version:(previous.version + 1)];
+    }
+    self.snapshotNeedsFullCopy = NO;
+}
+
+- (RangeDataSnapshot*) snapshot
+{
+    return self.latestSnapshot;
+}
+
+-(NSArray*) rangeIdsWithData
+{
+    return [self.dataDict allKeys];
+}
+
+-(RangeData*) getDataByRange:(NSString*) uid
+{
+    if(uid == nil)
+    {
+        return nil;
+    }
+    return self.dataDict[uid];
+}
+
+-(int) totalLength
+{
+    int output = 0;
+    for(RangeData* rData in [self.dataDict allValues])
+    {
+        output += [rData length];
+    }
+    return output;
+}
+
+// Everything kept up to date as samples come in.
+- (void) samplesAddedTo:(RangeData*) rData
+{
+    if(rData == nil)
+    {
+        return;
+    }
+    [self noteSamplesAddedTo:rData];
+    for(RangeRollingWindowState* state in self.rollingWindows[rData.rangeUid])
+    {
+        [state feedFrom:rData];
+    }
+}
+
+// Works out latestData and earliestData from scratch. O(n) in the number of uids.
+- (void) updateExtremes
+{
+    self.latestData = nil;
+    self.earliestData = nil;
+    self.extremesValid = YES;
+    for(RangeData* rData in [self.dataDict allValues])
+    {
+        [self noteSamplesAddedTo:rData];
+    }
+}
+
+// Samples were merged into rData. Merging only ever adds samples, so rData either takes over or nothing changes.
+- (void) noteSamplesAddedTo:(RangeData*) rData
+{
+    if(!self.extremesValid || [rData length] == 0)
+    {
+        return;
+    }
+
+    if(self.latestData == nil || rdm_last_time(rData) > rdm_last_time(self.latestData))
+    {
+        self.latestData = rData;
+    }
+    if(self.earliestData == nil || rdm_first_time(rData) < rdm_first_time(self.earliestData))
+    {
+        self.earliestData = rData;
+    }
+}
+
+- (const range_sample_t *) latestSample: (NSString **) outUid
+{
+    if(!self.extremesValid)
+    {
+        [self updateExtremes];
+    }
+
+    if(outUid != NULL)
+    {
+        *outUid = self.latestData != nil ? self.latestData.rangeUid : kRDIllegalUid;
+    }
+    return [self.latestData latestSample];
+}
+
+- (const range_sample_t *) latestSampleFromRange: (NSString *) uid
+{
+    return [[self getDataByRange:uid] latestSample];
+}
+
+- (const range_sample_t *) earliestSample: (NSString **) outUid
+{
+    if(!self.extremesValid)
+    {
+        [self updateExtremes];
+    }
+
+    if(outUid != NULL)
+    {
+        *outUid = self.earliestData != nil ? self.earliestData.rangeUid : kRDIllegalUid;
+    }
+    return [self.earliestData sampleAt:0];
+}
+
+- (BOOL) enumerateSamplesFromStart: (double) startTime toStop: (double) stopTime usingBlock: (RangeSampleEnumerationBlock) block
+{
+    return [RangeData enumerateSamplesOfRangeData:[self.dataDict allValues] fromStart:startTime toStop:stopTime usingBlock:block];
+}
+
+- (RangeRollingWindowState*) rollingWindowStateOf:(double) seconds forRange:(NSString*) uid
+{
+    for(RangeRollingWindowState* state in self.rollingWindows[uid])
+    {
+        if([state width] == seconds)
+        {
+            return state;
+        }
+    }
+    return nil;
+}
+
+- (BOOL) addRollingWindowOf:(double) seconds forRange:(NSString*) uid
+{
+    if(uid == nil || !(seconds > 0.0))
+    {
+        return NO;
+    }
+    if([self rollingWindowStateOf:seconds forRange:uid] != nil)
+    {
+        return YES;
+    }
+
+    RangeRollingWindowState* state = [[RangeRollingWindowState alloc] initWithWidth:seconds];
+    RangeData* rData = self.dataDict[uid];
+    if(rData != nil && ![state feedFrom:rData])
+    {
+        return NO;
+    }
+
+    NSMutableArray* windows = self.rollingWindows[uid];
+    if(windows == nil)
+    {
+        windows = [NSMutableArray array];
+        self.rollingWindows[uid] = windows;
+    }
+    [windows addObject:state];
+    return YES;
+}
+
+- (void) removeRollingWindowOf:(double) seconds forRange:(NSString*) uid
+{
+    RangeRollingWindowState* state = [self rollingWindowStateOf:seconds forRange:uid];
+    if(state != nil)
+    {
+        [self.rollingWindows[uid] removeObject:state];
+    }
+}
+
+// The window added with addRollingWindowOf:forRange:, caught up on drops and swaps that didn't come with new samples.
+- (RangeRollingWindowState*) currentRollingWindowStateOf:(double) seconds forRange:(NSString*) uid
+{
+    RangeRollingWindowState* state = [self rollingWindowStateOf:seconds forRange:uid];
+    RangeData* rData = self.dataDict[uid];
+    if(state != nil && rData != nil && (state.source != rData || state.sourceGeneration != [rData generation]))
+    {
+        [state feedFrom:rData];
+    }
+    return state;
+}
+
+- (BOOL) rollingWindowOf:(double) seconds forRange:(NSString*) uid stats:(range_window_stats_t*) statsOut
+{
+    RangeRollingWindowState* state = [self currentRollingWindowStateOf:seconds forRange:uid];
+    if(state == nil || statsOut == NULL)
+    {
+        return NO;
+    }
+    [state stats:statsOut];
+    return YES;
+}
+
+- (BOOL) rollingWindowOf:(double) seconds forRange:(NSString*) uid timeToTrigger:(RangeTrigger*) trigger
+                 seconds:(double*) secondsOut confidence:(float*) confidenceOut
+{
+    int direction;
+    switch(trigger.direction)
+    {
+        case kRangeTriggerDirectionRising:
+            direction = 1;
+            break;
+        case kRangeTriggerDirectionFalling:
+            direction = -1;
+            break;
+        case kRangeTriggerDirectionBidirectional:
+            direction = 0;
+            break;
+        default:
+            return NO;
+    }
+
+    RangeRollingWindowState* state = [self currentRollingWindowStateOf:seconds forRange:uid];
+    if(state == nil || secondsOut == NULL)
+    {
+        return NO;
+    }
+    return [state timeTo:trigger.triggerTemperature direction:direction seconds:secondsOut confidence:confidenceOut];
+}
+
+- (void) gapThreshold:(double) thresholdInSeconds
+{
+    self.gapThresholdValue = thresholdInSeconds;
+    self.latestGapValid = NO;
+}
+
+// Looks through the recorded gaps of every RangeData. Only runs when something changed.
+- (void) updateLatestGap
+{
+    RangeData* latestData = nil;
+    int latestIndex = kRangeIndexNotFound;
+    double latestTime = 0.0;
+    double threshold = self.gapThresholdValue;
+
+    for(RangeData* rData in [self.dataDict allValues])
+    {
+        int index = [rData indexOfLatestGapLongerThan:threshold];
+        if(index == kRangeIndexNotFound)
+        {
+            continue;
+        }
+
+        double sampleTime = range_store_time_at([rData store], index);
+        if(latestData == nil || sampleTime > latestTime)
+        {
+            latestData = rData;
+            latestIndex = index;
+            latestTime = sampleTime;
+        }
+    }
+
+    self.latestGapData = latestData;
+    self.latestGapIndex = latestIndex;
+    self.latestGapValid = YES;
+}
+
+- (const range_sample_t *)  endOfLatestGap: (NSString **) outUid
+{
+    if(!self.latestGapValid)
+    {
+        [self updateLatestGap];
+    }
+
+    const range_sample_t* output = NULL;
+    NSString* uid = kRDIllegalUid;
+    if(self.latestGapData != nil)
+    {
+        output = [self.latestGapData sampleAt:self.latestGapIndex];
+        uid = self.latestGapData.rangeUid;
+    }
+
+    if(outUid != NULL)
+    {
+        *outUid = uid;
+    }
+    return output;
+}
+
+@end
@@ -0,0 +1,76 @@
+//
+//  RangeDataManager_internal.h
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "RangeDataManager.h"
+#import "RangeData_internal.h"
+#import "RangeSampleRing.h"
+#import "RangeRollingWindow.h"
+#import "RangeDataSnapshot_internal.h"
+
+/*!
+ It is unnecessary for the SDK end-user to directly use anything in this file.
+ */
+@interface RangeDataManager()
+
+// maps the Range uid to its RangeData
+@property (strong, readwrite) NSMutableDictionary* dataDict;
+
+/*!
+ Merge a single RangeData into the RangeData with the same uid (creating it if needed).
+ @return YES if everything was added correctly.
+ */
+-(BOOL) addRangeData:(RangeData*) rData;
+
+/*!
+ Moves the samples currently waiting in the ring into this RangeDataManager.
+ Must only be called from the ring's consumer thread.
+ @return YES if everything was added correctly.
+ */
+-(BOOL) addSamplesFromRing:(range_ring_t*) ring;
+
+/*!
+ Publishes a new snapshot if any RangeData changed since the last one.
+ Must be called on the thread that merges into this RangeDataManager.
+ */
+-(void) publishSnapshot;
+
+/*!
+ Compresses a few chunks of older samples. Called on every refresh, so the work is spread out.
+ */
+-(void) compressSealedData;
+
+/*!
+ Drops a few chunks of samples and blocks of summaries that are older than retainRawSamplesFor:summariesFor: allows.
+ Called on every refresh, so the work is spread out.
+ */
+-(void) applyRetention;
+
+/*!
+ Makes sure everything added so far is recorded in the files given to persistToDirectory:.
+ Does nothing if persistToDirectory: was never called. Waits on the disk, so don't call it on every refresh.
+ */
+-(void) syncPersistentData;
+
+/*!
+ Calls syncPersistentData if it hasn't run in the last few seconds. What refreshes call.
+ Anything added since the last sync can be lost if the app dies, until the next one.
+ */
+-(void) syncPersistentDataIfDue;
+
+@end
@@ -0,0 +1,83 @@
+//
+//  RangeDataSnapshot.h
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+#import "RangeData.h"
+
+/*!
+ An immutable view of all the data in a RangeDataManager as of one refresh.
+ 
+ Every refreshRangeDataManager publishes a new snapshot. Readers (graphing, exporting, triggers)
+ can hold on to a snapshot and read it from any thread without @synchronized(range),
+ while the Range object keeps refreshing. A snapshot is freed once nobody holds it anymore.
+ 
+ The RangeData objects in a snapshot never change, and range_sample_t pointers into them
+ stay valid for as long as you hold the snapshot.
+ */
+@interface RangeDataSnapshot : NSObject
+
+/*!
+ Goes up by one each time a snapshot with new data is published.
+ */
+@property (nonatomic, readonly) uint64_t version;
+
+/*!
+ Get the uids of all Ranges that are in this snapshot.
+ @return An array of NSString* that are all the uids
+ */
+-(NSArray*) rangeIdsWithData;
+
+/*!
+ Get a reference to the data contained for a certain uid
+ @return The pointer to the RangeData. nil if there is no data for the provided uid.
+ */
+-(RangeData*) getDataByRange:(NSString*) uid;
+
+/*!
+ Sums up the number of data points in all of the contained RangeDatas
+ @return The number of all data points in this snapshot
+ */
+-(int) totalLength;
+
+/*!
+ Get the most recent (latest time) sample in this snapshot. By any Range uid.
+ @param outUid returns the uid of the Range with the latest sample
+ @return Reference to the sample with the greatest time that was read. NULL if there are no samples.
+ */
+- (const range_sample_t *) latestSample: (NSString **) outUid;
+
+/*!
+ Get the earliest (by time) sample in this snapshot. By any Range uid.
+ @param outUid returns the uid of the Range with the earliest sample
+ @return Reference to the sample with the earliest time that was read. NULL if there are no samples.
+ */
+- (const range_sample_t *) earliestSample: (NSString **) outUid;
+
+/*!
+ Goes through the samples of every Range in time order, as if they were one list.
+ Samples with the same time come one after the other in no particular order of uid.
+ Nothing is allocated per sample, and each sample costs O(log n) in the number of Ranges.
+ @param startTime Only samples at or after this time.
+ @param stopTime Only samples at or before this time.
+ @param block Called with the uid and the sample. Set *stop to YES to end early.
+ @return NO if we ran out of memory.
+ */
+- (BOOL) enumerateSamplesFromStart: (double) startTime toStop: (double) stopTime usingBlock: (RangeSampleEnumerationBlock) block;
+
+@end
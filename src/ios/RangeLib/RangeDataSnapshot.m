@@ -0,0 +1,121 @@
+//
+//  RangeDataSnapshot.m
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "RangeDataSnapshot_internal.h"
+#import "RangeData_internal.h"
+
+@interface RangeDataSnapshot()
+
+@property (nonatomic, readwrite) uint64_t version;
+// maps the Range uid to its frozen RangeData
+@property (nonatomic, strong) NSDictionary* dataDict;
+// The RangeData with the latest and earliest sample. Worked out once, as the data never changes.
+@property (nonatomic, strong) RangeData* latestData;
+@property (nonatomic, strong) RangeData* earliestData;
+
+@end
+
+
+@implementation RangeDataSnapshot
+
+- (instancetype) init
+{
+    return [self initWithFrozenData:[NSDictionary dictionary] version:0];
+}
+
+- (instancetype) initWithFrozenData: (NSDictionary*) frozenData version: (uint64_t) version
+{
+    if (self = [super init])
+    {
+        self.dataDict = [frozenData copy];
+        self.version = version;
+
+        for(RangeData* rData in [self.dataDict allValues])
+        {
+            range_store_t* store = [rData store];
+            if(store->length == 0)
+            {
+                continue;
+            }
+            if(self.latestData == nil ||
+               range_store_time_at(store, store->length - 1) > range_store_time_at([self.latestData store], [self.latestData length] - 1))
+            {
+                self.latestData = rData;
+            }
+            if(self.earliestData == nil ||
+               range_store_time_at(store, 0) < range_store_time_at([self.earliestData store], 0))
+            {
+                self.earliestData = rData;
+            }
+        }
+
+        return self;
+    } else {
+        return nil;
+    }
+}
+
+-(NSArray*) rangeIdsWithData
+{
+    return [self.dataDict allKeys];
+}
+
+-(RangeData*) getDataByRange:(NSString*) uid
+{
+    if(uid == nil)
+    {
+        return nil;
+    }
+    return self.dataDict[uid];
+}
+
+-(int) totalLength
+{
+    int output = 0;
+    for(RangeData* rData in [self.dataDict allValues])
+    {
+        output += [rData length];
+    }
+    return output;
+}
+
+- (const range_sample_t *) latestSample: (NSString **) outUid
+{
+    if(outUid != NULL)
+    {
+        *outUid = self.latestData != nil ? self.latestData.rangeUid : kRDIllegalUid;
+    }
+    return [self.latestData latestSample];
+}
+
+- (const range_sample_t *) earliestSample: (NSString **) outUid
+{
+    if(outUid != NULL)
+    {
+        *outUid = self.earliestData != nil ? self.earliestData.rangeUid : kRDIllegalUid;
+    }
+    return [self.earliestData sampleAt:0];
+}
+
+- (BOOL) enumerateSamplesFromStart: (double) startTime toStop: (double) stopTime usingBlock: (RangeSampleEnumerationBlock) block
+{
+    return [RangeData enumerateSamplesOfRangeData:[self.dataDict allValues] fromStart:startTime toStop:stopTime usingBlock:block];
+}
+
+@end
@@ -0,0 +1,144 @@
+//
+//  RangeData_internal.h
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "RangeData.h"
+#import "RangeSampleStore.h"
+#import "RangeSamplePyramid.h"
+#import "RangeGapIndex.h"
+#import "RangeSampleLog.h"
+#import "RangeMergeIterator.h"
+
+/*!
+ It is unnecessary for the SDK end-user to directly use anything in this file.
+ */
+@interface RangeData()
+
+/*!
+ Creates an empty RangeData for a single Range.
+ */
+- (instancetype) initWithUid: (NSString*) uid;
+
+/*!
+ Creates a RangeData whose samples live in the segment file at logPath (see RangeSampleLog).
+ Samples already in the file are mapped in, not read. New samples are written to the file as they are added.
+ @return nil if the file can't be opened or isn't a segment for uid.
+ */
+- (instancetype) initWithUid: (NSString*) uid logPath: (NSString*) logPath;
+
+/*!
+ Records the samples added since the last call in the segment file so they survive the app being killed.
+ Does nothing for RangeData objects without a file.
+ @return NO if the file could not be updated.
+ */
+- (BOOL) syncLog;
+
+/*!
+ Adds one sample to the end of the data.
+ Samples that are not later than the latest sample are merged into place instead.
+ @return NO if we ran out of memory.
+ */
+- (BOOL) addSample: (range_sample_t) sample;
+
+/*!
+ Merges all the samples of another RangeData (with the same uid) into this one.
+ @return NO if the uids don't match or we ran out of memory.
+ */
+- (BOOL) mergeWithRangeData: (RangeData*) other;
+
+/*!
+ Merges the samples of another RangeData starting at startIndex.
+ Samples later than our latest sample (the high-water mark) are appended directly.
+ Only samples that land before the high-water mark and that we don't already have cause a real merge.
+ @return NO if the uids don't match or we ran out of memory.
+ */
+- (BOOL) mergeWithRangeData: (RangeData*) other fromIndex: (int) startIndex;
+
+/*!
+ Bumped every time samples that were already stored get rewritten (out of order merges) or dropped.
+ Plain appends leave it alone, so a reader that remembers (generation, length) knows
+ that only the samples after length are new while the generation is unchanged.
+ */
+- (uint64_t) generation;
+
+/*!
+ Compresses up to maxChunks full chunks of samples that are kept in memory (see range_store_compress_sealed).
+ Samples in a segment file are left alone. Does nothing for frozen copies.
+ @return The number of chunks that were swapped out.
+ */
+- (int) compressSealedChunks: (int) maxChunks;
+
+/*!
+ Bumped by compressSealedChunks: whenever it swaps chunks. Frozen copies keep the value they were made with.
+ */
+- (uint64_t) chunkLayoutVersion;
+
+/*!
+ A read only RangeData that shares this one's samples as they are right now.
+ It can be read from any thread without locking while this one keeps being merged into.
+ Must be called on the thread that merges into this RangeData.
+ @return nil if we ran out of memory.
+ */
+- (RangeData*) frozenCopy;
+
+/*!
+ Drops up to maxChunks of the oldest chunks of samples, as long as every sample in them is earlier than time.
+ The chunk being appended to is never dropped. The remaining samples move down to index 0 and the generation is bumped.
+ Their summaries are kept (see dropSummariesBefore:maxBlocks:), and resends of dropped samples are ignored from now on.
+ Summaries of dropped samples are not in the segment file, so they are gone after a restart.
+ @return The number of chunks dropped.
+ */
+- (int) dropSamplesBefore: (double) time maxChunks: (int) maxChunks;
+
+/*!
+ Drops up to maxBlocks blocks of summaries that end at or before time (see range_pyramid_drop_before).
+ @return The number of blocks dropped.
+ */
+- (int) dropSummariesBefore: (double) time maxBlocks: (int) maxBlocks;
+
+/*!
+ YES for the RangeData objects returned by frozenCopy.
+ */
+- (BOOL) isFrozen;
+
+/*!
+ Index of the sample right after the latest gap between samples longer than threshold.
+ Works off the recorded gaps, so it doesn't look at the samples. O(log) in the number of recorded gaps.
+ @return kRangeIndexNotFound if there is no gap that long.
+ */
+- (int) indexOfLatestGapLongerThan: (double) threshold;
+
+/*!
+ Brings the list returned by gaps up to date with the samples added since the last call.
+ */
+- (void) calculateGaps;
+
+/*!
+ Calls block for every sample with startTime <= time <= stopTime in any of rangeDatas, in ascending time order
+ (see RangeMergeIterator). Samples with the same time come in the order of rangeDatas.
+ Nothing is allocated per sample. The RangeData objects must not change while this runs.
+ @return NO if we ran out of memory (block is never called then).
+ */
++ (BOOL) enumerateSamplesOfRangeData: (NSArray*) rangeDatas fromStart: (double) startTime toStop: (double) stopTime usingBlock: (RangeSampleEnumerationBlock) block;
+
+/*!
+ Direct access to the backing store for code inside the library.
+ */
+- (range_store_t *) store;
+
+@end
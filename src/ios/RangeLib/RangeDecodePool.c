@@ -0,0 +1,263 @@
+//
+//  RangeDecodePool.c
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// pthread_cond_timedwait and gettimeofday, for strict C builds.
+#define _POSIX_C_SOURCE 200809L
+
+#include "RangeDecodePool.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+typedef struct {
+    range_replay_stream_t*  stream;
+    // Set by the worker that has the stream.
+    atomic_bool             claimed;
+    atomic_bool             finished;
+} rdp_slot_t;
+
+struct range_decode_pool {
+    rdp_slot_t*         slots;
+    int                 slot_count;
+    pthread_t*          workers;
+    int                 worker_count;
+
+    // Limit on decoded audio, in microseconds. Negative for none.
+    _Atomic long long   limit_us;
+    atomic_int          finished_count;
+    atomic_bool         failed;
+    // Spreads the workers over the streams.
+    atomic_int          next_start;
+
+    pthread_mutex_t     lock;
+    // Workers wait on this for the consumer (room, a new limit, or stopping).
+    pthread_cond_t      work_ready;
+    uint64_t            work_generation;
+    // The consumer waits on this for the workers.
+    pthread_cond_t      output_ready;
+    uint64_t            output_generation;
+    uint64_t            output_seen;
+    bool                stopping;
+};
+
+// Takes a stream that can be stepped now, or returns -1. start spreads the workers over the streams.
+static int rdp_claim(range_decode_pool_t* pool, int start)
+{
+    long long limit_us = atomic_load_explicit(&pool->limit_us, memory_order_acquire);
+    for(int i = 0; i < pool->slot_count; i++)
+    {
+        rdp_slot_t* slot = &pool->slots[(start + i) % pool->slot_count];
+        if(atomic_load_explicit(&slot->finished, memory_order_acquire) ||
+           atomic_load_explicit(&slot->claimed, memory_order_relaxed))
+        {
+            continue;
+        }
+
+        bool expected = false;
+        if(!atomic_compare_exchange_strong_explicit(&slot->claimed, &expected, true,
+                                                    memory_order_acquire, memory_order_relaxed))
+        {
+            continue;
+        }
+        range_replay_stream_t* stream = slot->stream;
+        bool behind = limit_us < 0 || range_replay_stream_seconds(stream) * 1e6 < (double)limit_us;
+        if(behind && range_replay_stream_has_room(stream))
+        {
+            return (start + i) % pool->slot_count;
+        }
+        atomic_store_explicit(&slot->claimed, false, memory_order_release);
+    }
+    return -1;
+}
+
+static void* rdp_worker(void* context)
+{
+    range_decode_pool_t* pool = context;
+    int start = atomic_fetch_add(&pool->next_start, 1);
+
+    for(;;)
+    {
+        pthread_mutex_lock(&pool->lock);
+        uint64_t generation = pool->work_generation;
+        bool stopping = pool->stopping;
+        pthread_mutex_unlock(&pool->lock);
+        if(stopping || atomic_load(&pool->finished_count) == pool->slot_count)
+        {
+            break;
+        }
+
+        int index = rdp_claim(pool, start);
+        if(index < 0)
+        {
+            // Nothing to do until the consumer drains, moves the limit, or stops us.
+            pthread_mutex_lock(&pool->lock);
+            while(pool->work_generation == generation && !pool->stopping)
+            {
+                pthread_cond_wait(&pool->work_ready, &pool->lock);
+            }
+            pthread_mutex_unlock(&pool->lock);
+            continue;
+        }
+
+        rdp_slot_t* slot = &pool->slots[index];
+        int count = range_replay_stream_step(slot->stream);
+        if(count <= 0)
+        {
+            if(count < 0)
+            {
+                atomic_store(&pool->failed, true);
+            }
+            atomic_store_explicit(&slot->finished, true, memory_order_release);
+            atomic_fetch_add(&pool->finished_count, 1);
+        }
+        atomic_store_explicit(&slot->claimed, false, memory_order_release);
+        start = index + 1;
+
+        pthread_mutex_lock(&pool->lock);
+        pool->output_generation++;
+        pthread_cond_signal(&pool->output_ready);
+        if(count <= 0)
+        {
+            // Waiting workers may be waiting on nothing now.
+            pool->work_generation++;
+            pthread_cond_broadcast(&pool->work_ready);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return NULL;
+}
+
+range_decode_pool_t* range_decode_pool_create(range_replay_stream_t* const* streams, int stream_count, int worker_count)
+{
+    if(stream_count < 1 || worker_count < 1)
+    {
+        return NULL;
+    }
+    range_decode_pool_t* pool = calloc(1, sizeof(range_decode_pool_t));
+    if(pool == NULL)
+    {
+        return NULL;
+    }
+    pool->slots = calloc((size_t)stream_count, sizeof(rdp_slot_t));
+    pool->workers = calloc((size_t)worker_count, sizeof(pthread_t));
+    if(pool->slots == NULL || pool->workers == NULL)
+    {
+        free(pool->slots);
+        free(pool->workers);
+        free(pool);
+        return NULL;
+    }
+
+    pool->slot_count = stream_count;
+    for(int i = 0; i < stream_count; i++)
+    {
+        pool->slots[i].stream = streams[i];
+        atomic_init(&pool->slots[i].claimed, false);
+        atomic_init(&pool->slots[i].finished, false);
+    }
+    atomic_init(&pool->limit_us, -1);
+    atomic_init(&pool->finished_count, 0);
+    atomic_init(&pool->failed, false);
+    atomic_init(&pool->next_start, 0);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->output_ready, NULL);
+
+    for(int i = 0; i < worker_count; i++)
+    {
+        if(pthread_create(&pool->workers[i], NULL, rdp_worker, pool) != 0)
+        {
+            break;
+        }
+        pool->worker_count++;
+    }
+    if(pool->worker_count == 0)
+    {
+        range_decode_pool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void range_decode_pool_destroy(range_decode_pool_t* pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+    for(int i = 0; i < pool->worker_count; i++)
+    {
+        pthread_join(pool->workers[i], NULL);
+    }
+
+    pthread_cond_destroy(&pool->output_ready);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->workers);
+    free(pool->slots);
+    free(pool);
+}
+
+void range_decode_pool_drained(range_decode_pool_t* pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->work_generation++;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+bool range_decode_pool_wait(range_decode_pool_t* pool, double timeout)
+{
+    struct timespec deadline;
+    if(timeout >= 0.0)
+    {
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        double seconds = (double)now.tv_sec + (double)now.tv_usec / 1e6 + timeout;
+        deadline.tv_sec = (time_t)seconds;
+        deadline.tv_nsec = (long)((seconds - (double)deadline.tv_sec) * 1e9);
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    while(pool->output_generation == pool->output_seen && atomic_load(&pool->finished_count) < pool->slot_count)
+    {
+        if(timeout < 0.0)
+        {
+            pthread_cond_wait(&pool->output_ready, &pool->lock);
+        } else if(pthread_cond_timedwait(&pool->output_ready, &pool->lock, &deadline) != 0) {
+            break;
+        }
+    }
+    pool->output_seen = pool->output_generation;
+    bool running = atomic_load(&pool->finished_count) < pool->slot_count;
+    pthread_mutex_unlock(&pool->lock);
+    return running;
+}
+
+void range_decode_pool_set_limit(range_decode_pool_t* pool, double seconds)
+{
+    atomic_store_explicit(&pool->limit_us, seconds < 0.0 ? -1 : (long long)(seconds * 1e6), memory_order_release);
+    range_decode_pool_drained(pool);
+}
+
+bool range_decode_pool_failed(range_decode_pool_t* pool)
+{
+    return atomic_load(&pool->failed);
+}
@@ -0,0 +1,76 @@
+//
+//  RangeDecodePool.h
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RangeDecodePool_h
+#define RangeDecodePool_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "RangeReplayStream.h"
+
+/*
+ Decodes several independent streams (channels of one capture, separate captures, several devices)
+ at once on a fixed number of worker threads.
+
+ Each worker picks a stream nobody else is working on that has room in its ring, steps it,
+ and moves on, so any number of streams share the workers. A stream's ring keeps a single producer
+ because only one worker has the stream at a time.
+ The samples are taken out of the rings by one consumer thread (normally into a single RangeDataManager).
+ It calls range_decode_pool_drained after draining so workers waiting on a full ring carry on.
+
+ range_decode_pool_set_limit keeps every stream from getting more than some amount of audio ahead,
+ for replaying at a multiple of real time.
+ */
+
+typedef struct range_decode_pool range_decode_pool_t;
+
+/*
+ Starts worker_count threads decoding streams (stream_count of them, already initialized).
+ The streams must outlive the pool; the array of pointers is copied. Returns NULL if the threads or memory couldn't be had.
+ */
+range_decode_pool_t* range_decode_pool_create(range_replay_stream_t* const* streams, int stream_count, int worker_count);
+
+/*
+ Stops the workers (finishing the step they are on) and waits for them.
+ */
+void range_decode_pool_destroy(range_decode_pool_t* pool);
+
+/*
+ Consumer side: the rings have been drained, workers waiting for room can go on.
+ */
+void range_decode_pool_drained(range_decode_pool_t* pool);
+
+/*
+ Consumer side: waits until a worker has decoded something since the last call, every stream is finished,
+ or timeout seconds went by (negative waits as long as it takes).
+ Returns false once every stream is finished. Drain once more after that.
+ */
+bool range_decode_pool_wait(range_decode_pool_t* pool, double timeout);
+
+/*
+ Only decode streams up to seconds of audio. Negative for no limit (the default). Safe to call from any thread.
+ */
+void range_decode_pool_set_limit(range_decode_pool_t* pool, double seconds);
+
+/*
+ True if reading any of the streams failed.
+ */
+bool range_decode_pool_failed(range_decode_pool_t* pool);
+
+#endif /* RangeDecodePool_h */
@@ -0,0 +1,119 @@
+//
+//  RangeGapIndex.c
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "RangeGapIndex.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+void range_gap_index_init(range_gap_index_t* index)
+{
+    memset(index, 0, sizeof(range_gap_index_t));
+}
+
+void range_gap_index_destroy(range_gap_index_t* index)
+{
+    free(index->gaps);
+    memset(index, 0, sizeof(range_gap_index_t));
+}
+
+bool range_gap_index_init_copy(range_gap_index_t* copy, const range_gap_index_t* source)
+{
+    range_gap_index_init(copy);
+    if(source->count == 0)
+    {
+        return true;
+    }
+
+    copy->gaps = malloc(sizeof(range_gap_t) * source->count);
+    if(copy->gaps == NULL)
+    {
+        return false;
+    }
+    memcpy(copy->gaps, source->gaps, sizeof(range_gap_t) * source->count);
+    copy->count = source->count;
+    copy->capacity = source->count;
+    return true;
+}
+
+void range_gap_index_clear(range_gap_index_t* index)
+{
+    index->count = 0;
+}
+
+bool range_gap_index_add(range_gap_index_t* index, int sample_index, double length)
+{
+    // Earlier gaps that aren't longer than this one can never be the answer again.
+    while(index->count > 0 && index->gaps[index->count - 1].length <= length)
+    {
+        index->count--;
+    }
+
+    if(index->count == index->capacity)
+    {
+        int new_capacity = index->capacity ? index->capacity * 2 : 16;
+        range_gap_t* new_gaps = realloc(index->gaps, sizeof(range_gap_t) * new_capacity);
+        if(new_gaps == NULL)
+        {
+            return false;
+        }
+        index->gaps = new_gaps;
+        index->capacity = new_capacity;
+    }
+
+    index->gaps[index->count].sample_index = sample_index;
+    index->gaps[index->count].length = length;
+    index->count++;
+    return true;
+}
+
+void range_gap_index_drop_front(range_gap_index_t* index, int count)
+{
+    // Dropping the front of the list keeps it sorted both ways.
+    int first = 0;
+    while(first < index->count && index->gaps[first].sample_index <= count)
+    {
+        first++;
+    }
+
+    index->count -= first;
+    memmove(index->gaps, index->gaps + first, sizeof(range_gap_t) * index->count);
+    for(int i = 0; i < index->count; i++)
+    {
+        index->gaps[i].sample_index -= count;
+    }
+}
+
+int range_gap_index_latest(const range_gap_index_t* index, double threshold)
+{
+    // The gaps longer than threshold are the first few entries. We want the last of those.
+    int low = 0;
+    int high = index->count;
+    while(low < high)
+    {
+        int mid = low + (high - low) / 2;
+        if(index->gaps[mid].length > threshold)
+        {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low > 0 ? index->gaps[low - 1].sample_index : -1;
+}
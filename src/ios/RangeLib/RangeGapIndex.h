@@ -0,0 +1,81 @@
+//
+//  RangeGapIndex.h
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RangeGapIndex_h
+#define RangeGapIndex_h
+
+#include <stdbool.h>
+
+/*
+ Remembers the gaps between neighbouring samples of a RangeData so the latest gap
+ longer than any threshold can be found without looking at the samples.
+
+ Only gaps that are longer than every gap after them are kept. A shorter gap that
+ comes before a longer one can never be the latest gap over a threshold, since the
+ longer (later) one would be over it too. The kept gaps are in ascending order by
+ sample index and strictly descending order by length, so a lookup is a binary search
+ over a handful of entries, and adding a gap is amortized O(1).
+ */
+
+typedef struct {
+    // Index of the first sample after the gap.
+    int     sample_index;
+    // Time between that sample and the one before it.
+    double  length;
+} range_gap_t;
+
+typedef struct {
+    range_gap_t*    gaps;
+    int             count;
+    int             capacity;
+} range_gap_index_t;
+
+void range_gap_index_init(range_gap_index_t* index);
+void range_gap_index_destroy(range_gap_index_t* index);
+
+/*
+ Makes copy an independent copy of source.
+ Returns false if we ran out of memory.
+ */
+bool range_gap_index_init_copy(range_gap_index_t* copy, const range_gap_index_t* source);
+
+/*
+ Forgets all gaps.
+ */
+void range_gap_index_clear(range_gap_index_t* index);
+
+/*
+ Records the gap in front of sample_index. Gaps must be added in ascending order of sample_index.
+ Returns false if we ran out of memory.
+ */
+bool range_gap_index_add(range_gap_index_t* index, int sample_index, double length);
+
+/*
+ The first count samples are gone and the rest moved down to index 0.
+ Forgets the gaps in front of samples that are gone (or have nothing in front of them now) and renumbers the rest.
+ */
+void range_gap_index_drop_front(range_gap_index_t* index, int count);
+
+/*
+ The sample right after the latest gap longer than threshold.
+ Returns -1 if there is no such gap.
+ */
+int range_gap_index_latest(const range_gap_index_t* index, double threshold);
+
+#endif /* RangeGapIndex_h */
@@ -0,0 +1,55 @@
+//
+//  RangeGapSample.h
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#import <Foundation/Foundation.h>
+
+/*!
+ One end of a gap in the samples of a RangeData (see -[RangeData gaps]).
+ The class itself is built into libRangeLib.
+ */
+@interface RangeGapSample : NSObject
+
+/*!
+ The Range the sample came from.
+ */
+@property (nonatomic, strong) NSString* rangeUid;
+
+/*!
+ Index of the sample in its RangeData.
+ */
+@property (nonatomic) int sampleIndex;
+
+/*!
+ Time of the sample.
+ */
+@property (nonatomic) double sampleTime;
+
+/*!
+ YES if the sample is the last one before a gap, NO if it is the first one after a gap
+ (or the first sample there is).
+ */
+@property (nonatomic) BOOL isGapStart;
+
+/*!
+ Orders gap samples by time.
+ */
+- (NSComparisonResult) gapCompare: (RangeGapSample*) other;
+
+@end
@@ -0,0 +1,136 @@
+//
+//  RangeMergeIterator.c
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "RangeMergeIterator.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static bool rm_entry_before(const range_merge_entry_t* a, const range_merge_entry_t* b)
+{
+    return a->time < b->time || (a->time == b->time && a->source < b->source);
+}
+
+static void rm_sift_down(range_merge_iterator_t* iterator, int position)
+{
+    range_merge_entry_t* heap = iterator->heap;
+    range_merge_entry_t entry = heap[position];
+    int count = iterator->heap_count;
+
+    while(true)
+    {
+        int child = position * 2 + 1;
+        if(child >= count)
+        {
+            break;
+        }
+        if(child + 1 < count && rm_entry_before(&heap[child + 1], &heap[child]))
+        {
+            child++;
+        }
+        if(!rm_entry_before(&heap[child], &entry))
+        {
+            break;
+        }
+        heap[position] = heap[child];
+        position = child;
+    }
+    heap[position] = entry;
+}
+
+bool range_merge_iterator_init(range_merge_iterator_t* iterator, const range_store_t* const* stores, int store_count,
+                               double start_time, double stop_time)
+{
+    memset(iterator, 0, sizeof(range_merge_iterator_t));
+    if(store_count <= 0)
+    {
+        return true;
+    }
+
+    iterator->stores = stores;
+    iterator->next_indices = malloc(sizeof(int) * store_count);
+    iterator->stop_indices = malloc(sizeof(int) * store_count);
+    iterator->heap = malloc(sizeof(range_merge_entry_t) * store_count);
+    if(iterator->next_indices == NULL || iterator->stop_indices == NULL || iterator->heap == NULL)
+    {
+        range_merge_iterator_destroy(iterator);
+        return false;
+    }
+
+    for(int i = 0; i < store_count; i++)
+    {
+        int first = range_store_lower_bound(stores[i], start_time);
+        int stop = range_store_upper_bound(stores[i], stop_time);
+        iterator->next_indices[i] = first;
+        iterator->stop_indices[i] = stop;
+        if(first < stop)
+        {
+            range_merge_entry_t* entry = &(iterator->heap[iterator->heap_count++]);
+            entry->time = range_store_time_at(stores[i], first);
+            entry->source = i;
+        }
+    }
+
+    for(int i = iterator->heap_count / 2 - 1; i >= 0; i--)
+    {
+        rm_sift_down(iterator, i);
+    }
+    return true;
+}
+
+void range_merge_iterator_destroy(range_merge_iterator_t* iterator)
+{
+    free(iterator->next_indices);
+    free(iterator->stop_indices);
+    free(iterator->heap);
+    memset(iterator, 0, sizeof(range_merge_iterator_t));
+}
+
+bool range_merge_iterator_next(range_merge_iterator_t* iterator, int* source_out, range_sample_t* sample_out)
+{
+    if(iterator->heap_count == 0)
+    {
+        return false;
+    }
+
+    range_merge_entry_t* top = &(iterator->heap[0]);
+    int source = top->source;
+    const range_store_t* store = iterator->stores[source];
+    int index = iterator->next_indices[source]++;
+
+    if(source_out != NULL)
+    {
+        *source_out = source;
+    }
+    if(sample_out != NULL)
+    {
+        sample_out->unix_time = top->time;
+        sample_out->temperature = range_store_temperature_at(store, index);
+    }
+
+    // Replace the top with the next sample of the same store, or with the last entry if it has run out.
+    if(index + 1 < iterator->stop_indices[source])
+    {
+        top->time = range_store_time_at(store, index + 1);
+    } else {
+        *top = iterator->heap[--iterator->heap_count];
+    }
+    rm_sift_down(iterator, 0);
+    return true;
+}
@@ -0,0 +1,65 @@
+//
+//  RangeMergeIterator.h
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RangeMergeIterator_h
+#define RangeMergeIterator_h
+
+#include <stdbool.h>
+#include "RangeSampleStore.h"
+
+/*
+ Walks the samples of several stores (one per Range) in a time window as one list, ascending by time.
+
+ A binary heap holds the next sample of every store that still has samples in the window,
+ so each step is O(log stores). Samples with the same time come out in the order the stores were given.
+ All memory is allocated by range_merge_iterator_init; stepping never allocates.
+
+ The stores must not change while the iterator is in use. Frozen copies are fine to use from any thread.
+ */
+
+typedef struct {
+    double      time;
+    int         source;
+} range_merge_entry_t;
+
+typedef struct {
+    const range_store_t* const* stores;
+    // Per store: the next sample to hand out and the first one past the window.
+    int*                next_indices;
+    int*                stop_indices;
+    range_merge_entry_t* heap;
+    int                 heap_count;
+} range_merge_iterator_t;
+
+/*
+ Sets up the iterator for the samples with start_time <= time <= stop_time in store_count stores.
+ stores has to stay around until the iterator is destroyed.
+ Returns false if we ran out of memory.
+ */
+bool range_merge_iterator_init(range_merge_iterator_t* iterator, const range_store_t* const* stores, int store_count,
+                               double start_time, double stop_time);
+void range_merge_iterator_destroy(range_merge_iterator_t* iterator);
+
+/*
+ The next sample by time. source_out gets the index (into stores) of the store it came from.
+ Returns false once every sample in the window was handed out.
+ */
+bool range_merge_iterator_next(range_merge_iterator_t* iterator, int* source_out, range_sample_t* sample_out);
+
+#endif /* RangeMergeIterator_h */
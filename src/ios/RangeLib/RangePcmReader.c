@@ -0,0 +1,356 @@
+//
+//  RangePcmReader.c
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "RangePcmReader.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Frames converted per fread.
+#define RP_BUFFER_FRAMES 4096
+
+#define RP_WAVE_FORMAT_PCM          0x0001
+#define RP_WAVE_FORMAT_IEEE_FLOAT   0x0003
+#define RP_WAVE_FORMAT_EXTENSIBLE   0xFFFE
+
+static uint32_t rp_le16(const uint8_t* bytes)
+{
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8);
+}
+
+static uint32_t rp_le32(const uint8_t* bytes)
+{
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+static void rp_put_le16(uint8_t* bytes, uint32_t value)
+{
+    bytes[0] = (uint8_t)value;
+    bytes[1] = (uint8_t)(value >> 8);
+}
+
+static void rp_put_le32(uint8_t* bytes, uint32_t value)
+{
+    rp_put_le16(bytes, value);
+    rp_put_le16(bytes + 2, value >> 16);
+}
+
+static int rp_bytes_per_sample(range_pcm_format_t format)
+{
+    switch(format)
+    {
+        case RANGE_PCM_UINT8:   return 1;
+        case RANGE_PCM_INT16:   return 2;
+        case RANGE_PCM_INT24:   return 3;
+        case RANGE_PCM_INT32:   return 4;
+        case RANGE_PCM_FLOAT32: return 4;
+    }
+    return 0;
+}
+
+static bool rp_setup(range_pcm_reader_t* reader, FILE* file, range_pcm_format_t format,
+                     int channels, double sample_rate, long long frames)
+{
+    memset(reader, 0, sizeof(*reader));
+    if(channels < 1 || !(sample_rate > 0.0) || rp_bytes_per_sample(format) == 0)
+    {
+        return false;
+    }
+    reader->file = file;
+    reader->format = format;
+    reader->channels = channels;
+    reader->sample_rate = sample_rate;
+    reader->bytes_per_frame = channels * rp_bytes_per_sample(format);
+    reader->frames_left = frames;
+    reader->buffer_frames = RP_BUFFER_FRAMES;
+    reader->buffer = malloc((size_t)reader->buffer_frames * (size_t)reader->bytes_per_frame);
+    return reader->buffer != NULL;
+}
+
+bool range_pcm_open_raw(range_pcm_reader_t* reader, const char* path, range_pcm_format_t format,
+                        int channels, double sample_rate)
+{
+    FILE* file = fopen(path, "rb");
+    if(file == NULL)
+    {
+        memset(reader, 0, sizeof(*reader));
+        return false;
+    }
+    if(!rp_setup(reader, file, format, channels, sample_rate, -1))
+    {
+        fclose(file);
+        range_pcm_close(reader);
+        return false;
+    }
+    return true;
+}
+
+bool range_pcm_open_wav(range_pcm_reader_t* reader, const char* path)
+{
+    memset(reader, 0, sizeof(*reader));
+    FILE* file = fopen(path, "rb");
+    if(file == NULL)
+    {
+        return false;
+    }
+
+    uint8_t header[12];
+    if(fread(header, 1, sizeof(header), file) != sizeof(header) ||
+       memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0)
+    {
+        fclose(file);
+        return false;
+    }
+
+    // Walk the chunks until we have seen "fmt " and reached "data".
+    bool have_format = false;
+    range_pcm_format_t format = RANGE_PCM_INT16;
+    int channels = 0;
+    double sample_rate = 0.0;
+    int block_align = 0;
+    uint32_t data_size = 0;
+    for(;;)
+    {
+        uint8_t chunk[8];
+        if(fread(chunk, 1, sizeof(chunk), file) != sizeof(chunk))
+        {
+            fclose(file);
+            return false;
+        }
+        uint32_t chunk_size = rp_le32(chunk + 4);
+
+        if(memcmp(chunk, "fmt ", 4) == 0)
+        {
+            uint8_t fmt[40];
+            if(chunk_size < 16 || chunk_size > sizeof(fmt) || fread(fmt, 1, chunk_size, file) != chunk_size)
+            {
+                fclose(file);
+                return false;
+            }
+            uint32_t tag = rp_le16(fmt);
+            channels = (int)rp_le16(fmt + 2);
+            sample_rate = (double)rp_le32(fmt + 4);
+            block_align = (int)rp_le16(fmt + 12);
+            uint32_t bits = rp_le16(fmt + 14);
+            if(tag == RP_WAVE_FORMAT_EXTENSIBLE && chunk_size >= 26)
+            {
+                // The real format tag is the start of the sub format GUID.
+                tag = rp_le16(fmt + 24);
+            }
+
+            if(tag == RP_WAVE_FORMAT_IEEE_FLOAT && bits == 32)
+            {
+                format = RANGE_PCM_FLOAT32;
+            } else if(tag == RP_WAVE_FORMAT_PCM && bits == 8) {
+                format = RANGE_PCM_UINT8;
+            } else if(tag == RP_WAVE_FORMAT_PCM && bits == 16) {
+                format = RANGE_PCM_INT16;
+            } else if(tag == RP_WAVE_FORMAT_PCM && bits == 24) {
+                format = RANGE_PCM_INT24;
+            } else if(tag == RP_WAVE_FORMAT_PCM && bits == 32) {
+                format = RANGE_PCM_INT32;
+            } else {
+                fclose(file);
+                return false;
+            }
+            have_format = true;
+            if(chunk_size & 1)
+            {
+                fseek(file, 1, SEEK_CUR);
+            }
+        } else if(memcmp(chunk, "data", 4) == 0) {
+            data_size = chunk_size;
+            break;
+        } else {
+            // Chunks are padded to an even size.
+            if(fseek(file, (long)chunk_size + (chunk_size & 1), SEEK_CUR) != 0)
+            {
+                fclose(file);
+                return false;
+            }
+        }
+    }
+
+    if(!have_format)
+    {
+        fclose(file);
+        return false;
+    }
+    if(!rp_setup(reader, file, format, channels, sample_rate, 0))
+    {
+        fclose(file);
+        range_pcm_close(reader);
+        return false;
+    }
+    if(block_align != reader->bytes_per_frame)
+    {
+        range_pcm_close(reader);
+        return false;
+    }
+    // Recorders that are killed leave 0 (or garbage) here; trust the end of the file instead.
+    reader->frames_left = (data_size == 0 || data_size == 0xFFFFFFFF) ? -1 : (long long)(data_size / (uint32_t)block_align);
+    return true;
+}
+
+void range_pcm_close(range_pcm_reader_t* reader)
+{
+    if(reader->file != NULL)
+    {
+        fclose(reader->file);
+    }
+    free(reader->buffer);
+    memset(reader, 0, sizeof(*reader));
+}
+
+int range_pcm_read(range_pcm_reader_t* reader, float* out, int max_frames)
+{
+    if(reader->file == NULL || max_frames <= 0)
+    {
+        return reader->file == NULL ? -1 : 0;
+    }
+
+    int total = 0;
+    const int stride = reader->bytes_per_frame;
+    const int offset = reader->channel * rp_bytes_per_sample(reader->format);
+    while(total < max_frames)
+    {
+        int want = max_frames - total;
+        if(want > reader->buffer_frames)
+        {
+            want = reader->buffer_frames;
+        }
+        if(reader->frames_left >= 0 && want > reader->frames_left)
+        {
+            want = (int)reader->frames_left;
+        }
+        if(want == 0)
+        {
+            break;
+        }
+
+        size_t got = fread(reader->buffer, (size_t)stride, (size_t)want, reader->file);
+        if(got == 0)
+        {
+            if(ferror(reader->file))
+            {
+                return -1;
+            }
+            break;
+        }
+
+        const uint8_t* in = reader->buffer + offset;
+        float* dest = out + total;
+        switch(reader->format)
+        {
+            case RANGE_PCM_UINT8:
+                for(size_t i = 0; i < got; i++)
+                {
+                    dest[i] = ((float)in[i * stride] - 128.0f) * (1.0f / 128.0f);
+                }
+                break;
+            case RANGE_PCM_INT16:
+                for(size_t i = 0; i < got; i++)
+                {
+                    dest[i] = (float)(int16_t)rp_le16(in + i * stride) * (1.0f / 32768.0f);
+                }
+                break;
+            case RANGE_PCM_INT24:
+                for(size_t i = 0; i < got; i++)
+                {
+                    const uint8_t* bytes = in + i * stride;
+                    // Put the 24 bits at the top of an int32 so the sign comes along.
+                    int32_t value = (int32_t)(((uint32_t)bytes[0] << 8) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 24));
+                    dest[i] = (float)value * (1.0f / 2147483648.0f);
+                }
+                break;
+            case RANGE_PCM_INT32:
+                for(size_t i = 0; i < got; i++)
+                {
+                    dest[i] = (float)(int32_t)rp_le32(in + i * stride) * (1.0f / 2147483648.0f);
+                }
+                break;
+            case RANGE_PCM_FLOAT32:
+                for(size_t i = 0; i < got; i++)
+                {
+                    uint32_t bits = rp_le32(in + i * stride);
+                    memcpy(&dest[i], &bits, sizeof(bits));
+                }
+                break;
+        }
+
+        total += (int)got;
+        if(reader->frames_left >= 0)
+        {
+            reader->frames_left -= (long long)got;
+        }
+        if((int)got < want)
+        {
+            break;
+        }
+    }
+    return total;
+}
+
+bool range_pcm_write_wav(const char* path, const float* pcm, long long count, double sample_rate)
+{
+    if(count < 0 || count > 0x7FFFFFFFLL / 2 - 64)
+    {
+        return false;
+    }
+    FILE* file = fopen(path, "wb");
+    if(file == NULL)
+    {
+        return false;
+    }
+
+    uint32_t data_size = (uint32_t)(count * 2);
+    uint8_t header[44];
+    memcpy(header, "RIFF", 4);
+    rp_put_le32(header + 4, 36 + data_size);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    rp_put_le32(header + 16, 16);
+    rp_put_le16(header + 20, RP_WAVE_FORMAT_PCM);
+    rp_put_le16(header + 22, 1);
+    rp_put_le32(header + 24, (uint32_t)lround(sample_rate));
+    rp_put_le32(header + 28, (uint32_t)lround(sample_rate) * 2);
+    rp_put_le16(header + 32, 2);
+    rp_put_le16(header + 34, 16);
+    memcpy(header + 36, "data", 4);
+    rp_put_le32(header + 40, data_size);
+    bool ok = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+
+    uint8_t block[2 * RP_BUFFER_FRAMES];
+    for(long long start = 0; ok && start < count; start += RP_BUFFER_FRAMES)
+    {
+        int frames = (int)((count - start) < RP_BUFFER_FRAMES ? (count - start) : RP_BUFFER_FRAMES);
+        for(int i = 0; i < frames; i++)
+        {
+            float value = pcm[start + i];
+            value = value > 1.0f ? 1.0f : (value < -1.0f ? -1.0f : value);
+            rp_put_le16(block + 2 * i, (uint32_t)(uint16_t)(int16_t)lrintf(value * 32767.0f));
+        }
+        ok = fwrite(block, 2, (size_t)frames, file) == (size_t)frames;
+    }
+
+    if(fclose(file) != 0)
+    {
+        ok = false;
+    }
+    return ok;
+}
@@ -0,0 +1,85 @@
+//
+//  RangePcmReader.h
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RangePcmReader_h
+#define RangePcmReader_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ Reads recorded audio (a WAV file or headerless PCM) back as float samples in [-1, 1],
+ a block at a time, for feeding RangeSignalDecoder without a microphone.
+ Only one channel is read; captures of a Range are mono, and for anything else pick the channel.
+ Multi byte samples are little endian, as WAV files always are.
+ */
+
+typedef enum {
+    RANGE_PCM_UINT8,
+    RANGE_PCM_INT16,
+    RANGE_PCM_INT24,
+    RANGE_PCM_INT32,
+    RANGE_PCM_FLOAT32,
+} range_pcm_format_t;
+
+typedef struct {
+    FILE*               file;
+    range_pcm_format_t  format;
+    int                 channels;
+    // The channel handed back by range_pcm_read.
+    int                 channel;
+    double              sample_rate;
+    int                 bytes_per_frame;
+    // Frames left in the file. -1 for headerless PCM, which is read to the end of the file.
+    long long           frames_left;
+    // File bytes of one block, converted from on every read.
+    uint8_t*            buffer;
+    int                 buffer_frames;
+} range_pcm_reader_t;
+
+/*
+ Opens a WAV file. 8 bit unsigned, 16, 24 and 32 bit integer, and 32 bit float samples are understood,
+ with or without WAVE_FORMAT_EXTENSIBLE. Reads channel 0 (change reader->channel to read another).
+ Returns false if the file can't be read or isn't a WAV file we understand.
+ */
+bool range_pcm_open_wav(range_pcm_reader_t* reader, const char* path);
+
+/*
+ Opens a file of headerless interleaved PCM in the given format.
+ Returns false if the file can't be read or the description makes no sense.
+ */
+bool range_pcm_open_raw(range_pcm_reader_t* reader, const char* path, range_pcm_format_t format,
+                        int channels, double sample_rate);
+
+void range_pcm_close(range_pcm_reader_t* reader);
+
+/*
+ Reads up to max_frames samples of the reader's channel into out.
+ Returns the number read, 0 at the end of the file, or -1 if reading failed.
+ */
+int range_pcm_read(range_pcm_reader_t* reader, float* out, int max_frames);
+
+/*
+ Writes count mono samples as a 16 bit WAV file. For making captures to replay.
+ Returns false if the file can't be written.
+ */
+bool range_pcm_write_wav(const char* path, const float* pcm, long long count, double sample_rate);
+
+#endif /* RangePcmReader_h */
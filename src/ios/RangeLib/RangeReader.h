@@ -0,0 +1,65 @@
+//
+//  RangeReader.h
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+#import <Cordova/CDVPlugin.h>
+
+/*!
+ The Cordova side of the SDK (the RangeReader feature in plugin.xml, www/cdv-plugin-range-reader.js).
+ 
+ Every command answers from the last published RangeDataSnapshot, off the main thread, and never refreshes.
+ The plugin refreshes the Range data (Range refreshRangeDataManager) 8 times a second on a serial queue of its own,
+ so that is the one thread writing to it. Native code in the same app must not refresh as well.
+ The answer is a JSON string:
+ 
+   {"cursor":{"<uid>":<time of the newest sample>,...},
+    "ranges":{"<uid>":[{"time":<seconds since 1970>,"temperature":<raw, degrees F>},...],...}}
+ 
+ Temperatures are rounded to the tenth like RangeTemperatureTranslator's raw data format.
+ 
+ readBinarySince: answers with an ArrayBuffer instead, which the JS side looks at through typed arrays
+ without making an object per sample. Everything is little endian and every array starts on a multiple of 8:
+ 
+   header   "RNGB", uint16 version (1), uint16 number of ranges, 8 bytes of 0
+   then for every range with new samples:
+            uint32 sample count n, uint32 uid length in bytes, float64 time of the newest sample (the cursor)
+            uid in UTF-8, padded with 0 to a multiple of 8
+            float64 times[n]
+            float32 temperatures[n] (raw, degrees F, not rounded), padded with 0 to a multiple of 8
+ */
+@interface RangeReader : CDVPlugin
+
+/*!
+ Every sample of every Range.
+ */
+- (void) allRangeData: (CDVInvokedUrlCommand*) command;
+
+/*!
+ Only the samples newer than a cursor, so polling costs as much as the new data and not the whole session.
+ The first argument is the cursor from the last answer (an object of uid to time, or null for everything).
+ Ranges with nothing new are left out of "ranges" but stay in "cursor".
+ */
+- (void) readSince: (CDVInvokedUrlCommand*) command;
+
+/*!
+ readSince: with the samples packed as binary (see above). Takes the same cursor.
+ */
+- (void) readBinarySince: (CDVInvokedUrlCommand*) command;
+
+@end
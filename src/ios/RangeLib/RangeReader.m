@@ -0,0 +1,277 @@
+//
+//  RangeReader.m
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "RangeReader.h"
+#import "Range.h"
+#include <math.h>
+
+#define kRReaderBinaryVersion 1
+#define kRReaderBinaryHeaderLength 16
+// Same rate the demo app refreshes at.
+#define kRReaderRefreshInterval (1.0 / 8.0)
+
+// Zeros up to the next multiple of 8.
+static void rrd_pad(NSMutableData* data)
+{
+    NSUInteger padding = (8 - [data length] % 8) % 8;
+    [data increaseLengthBy:padding];
+}
+
+@interface RangeReader()
+
+@property (strong, readwrite) dispatch_queue_t refreshQueue;
+@property (strong, readwrite) dispatch_source_t refreshTimer;
+
+@end
+
+@implementation RangeReader
+
+// A Cordova app has no native code of its own to refresh the Range data, so the plugin does,
+// on one serial queue. Nothing else in the plugin refreshes.
+- (void) pluginInitialize
+{
+    self.refreshQueue = dispatch_queue_create("com.supermechanical.range.refresh", DISPATCH_QUEUE_SERIAL);
+    self.refreshTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, self.refreshQueue);
+    dispatch_source_set_timer(self.refreshTimer, DISPATCH_TIME_NOW, (uint64_t)(kRReaderRefreshInterval * NSEC_PER_SEC),
+                              (uint64_t)(kRReaderRefreshInterval * NSEC_PER_SEC / 10));
+    dispatch_source_set_event_handler(self.refreshTimer, ^{
+        Range* range = [Range sharedInstance];
+        @synchronized(range)
+        {
+            [range refreshRangeDataManager];
+        }
+    });
+    dispatch_resume(self.refreshTimer);
+}
+
+- (void) dispose
+{
+    if(self.refreshTimer != nil)
+    {
+        dispatch_source_cancel(self.refreshTimer);
+        self.refreshTimer = nil;
+    }
+}
+
+// Appends string as a JSON string.
+- (void) appendString: (NSString*) string toJson: (NSMutableData*) json
+{
+    NSMutableString* escaped = [NSMutableString stringWithString:@"\""];
+    for(NSUInteger i = 0; i < [string length]; i++)
+    {
+        unichar c = [string characterAtIndex:i];
+        if(c == '"' || c == '\\')
+        {
+            [escaped appendFormat:@"\\%C", c];
+        } else if(c < 0x20) {
+            [escaped appendFormat:@"\\u%04x", c];
+        } else {
+            [escaped appendFormat:@"%C", c];
+        }
+    }
+    [escaped appendString:@"\""];
+    [json appendData:[escaped dataUsingEncoding:NSUTF8StringEncoding]];
+}
+
+- (void) appendUTF8: (const char*) text toJson: (NSMutableData*) json
+{
+    [json appendBytes:text length:strlen(text)];
+}
+
+// The answer for the samples after cursor (uid to NSNumber time). nil if something went wrong.
+- (NSString*) readSnapshot: (RangeDataSnapshot*) snapshot since: (NSDictionary*) cursor
+{
+    NSMutableData* json = [NSMutableData data];
+    NSMutableDictionary* nextCursor = [NSMutableDictionary dictionaryWithDictionary:cursor];
+    [self appendUTF8:"{\"ranges\":{" toJson:json];
+
+    BOOL first = YES;
+    for(NSString* uid in [snapshot rangeIdsWithData])
+    {
+        RangeData* rData = [snapshot getDataByRange:uid];
+        const range_sample_t* latest = [rData latestSample];
+        if(latest == NULL)
+        {
+            continue;
+        }
+        double start = -INFINITY;
+        NSNumber* seen = cursor[uid];
+        if([seen isKindOfClass:[NSNumber class]])
+        {
+            start = nextafter([seen doubleValue], INFINITY);
+        }
+        if(latest->unix_time < start)
+        {
+            continue;
+        }
+
+        if(!first)
+        {
+            [self appendUTF8:"," toJson:json];
+        }
+        first = NO;
+        [self appendString:uid toJson:json];
+        [self appendUTF8:":" toJson:json];
+
+        NSOutputStream* stream = [NSOutputStream outputStreamToMemory];
+        [stream open];
+        BOOL written = [rData exportFromStart:start toStop:INFINITY as:kRangeDataExportTypeJSON
+                                   withFormat:kRangeTemperaturePrintFormatRawData toScale:kRangeTemperatureScaleFahrenheit
+                                     toStream:stream];
+        NSData* samples = [stream propertyForKey:NSStreamDataWrittenToMemoryStreamKey];
+        [stream close];
+        if(!written || samples == nil)
+        {
+            return nil;
+        }
+        [json appendData:samples];
+        nextCursor[uid] = @(latest->unix_time);
+    }
+
+    [self appendUTF8:"},\"cursor\":{" toJson:json];
+    first = YES;
+    char number[32];
+    for(NSString* uid in nextCursor)
+    {
+        if(![nextCursor[uid] isKindOfClass:[NSNumber class]])
+        {
+            continue;
+        }
+        if(!first)
+        {
+            [self appendUTF8:"," toJson:json];
+        }
+        first = NO;
+        [self appendString:uid toJson:json];
+        // All the digits, so the next read starts exactly after this sample.
+        snprintf(number, sizeof(number), ":%.17g", [nextCursor[uid] doubleValue]);
+        [self appendUTF8:number toJson:json];
+    }
+    [self appendUTF8:"}}" toJson:json];
+    return [[NSString alloc] initWithData:json encoding:NSUTF8StringEncoding];
+}
+
+// The binary answer for the samples after cursor (see RangeReader.h).
+- (NSData*) packSnapshot: (RangeDataSnapshot*) snapshot since: (NSDictionary*) cursor
+{
+    NSMutableData* data = [NSMutableData dataWithLength:kRReaderBinaryHeaderLength];
+    uint16_t rangeCount = 0;
+
+    for(NSString* uid in [snapshot rangeIdsWithData])
+    {
+        @autoreleasepool
+        {
+            RangeData* rData = [snapshot getDataByRange:uid];
+            double start = -INFINITY;
+            NSNumber* seen = cursor[uid];
+            if([seen isKindOfClass:[NSNumber class]])
+            {
+                start = nextafter([seen doubleValue], INFINITY);
+            }
+            int length = 0;
+            int index = [rData findSamplesIndexFromStart:start toStop:INFINITY withOutputLength:&length];
+            if(index == kRangeIndexNotFound || length <= 0 || rangeCount == UINT16_MAX)
+            {
+                continue;
+            }
+
+            NSUInteger rangeOffset = [data length];
+            NSData* uidBytes = [uid dataUsingEncoding:NSUTF8StringEncoding];
+            uint32_t counts[2] = { (uint32_t) length, (uint32_t) [uidBytes length] };
+            NSUInteger cursorOffset = rangeOffset + sizeof(counts);
+            [data appendBytes:counts length:sizeof(counts)];
+            [data increaseLengthBy:sizeof(double)];
+            [data appendData:uidBytes];
+            rrd_pad(data);
+
+            // The chunk columns are copied straight into the two arrays.
+            NSUInteger timesOffset = [data length];
+            [data increaseLengthBy:sizeof(double) * length];
+            NSUInteger temperaturesOffset = [data length];
+            [data increaseLengthBy:sizeof(float) * length];
+            double* times = (double*)((uint8_t*)[data mutableBytes] + timesOffset);
+            float* temperatures = (float*)((uint8_t*)[data mutableBytes] + temperaturesOffset);
+            if(![rData copySamplesFromIndex:index length:length toTimes:times temperatures:temperatures])
+            {
+                [data setLength:rangeOffset];
+                continue;
+            }
+            memcpy((uint8_t*)[data mutableBytes] + cursorOffset, &times[length - 1], sizeof(double));
+            rrd_pad(data);
+            rangeCount++;
+        }
+    }
+
+    uint8_t* header = [data mutableBytes];
+    memcpy(header, "RNGB", 4);
+    uint16_t version = kRReaderBinaryVersion;
+    memcpy(header + 4, &version, sizeof(version));
+    memcpy(header + 6, &rangeCount, sizeof(rangeCount));
+    return data;
+}
+
+- (void) read: (CDVInvokedUrlCommand*) command since: (NSDictionary*) cursor binary: (BOOL) binary
+{
+    [self.commandDelegate runInBackground:^{
+        // Only reads the published snapshot. Refreshing is left to refreshQueue,
+        // so the RangeDataManager keeps a single writer.
+        Range* range = [Range sharedInstance];
+        CDVPluginResult* result = nil;
+        if(binary)
+        {
+            NSData* answer = [self packSnapshot:[range snapshot] since:cursor];
+            result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsArrayBuffer:answer];
+        } else {
+            NSString* answer = [self readSnapshot:[range snapshot] since:cursor];
+            if(answer != nil)
+            {
+                result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsString:answer];
+            }
+        }
+        if(result == nil)
+        {
+            result = [CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR messageAsString:@"Couldn't read the Range data."];
+        }
+        [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
+    }];
+}
+
+// The cursor passed in as the first argument.
+- (NSDictionary*) cursorOf: (CDVInvokedUrlCommand*) command
+{
+    id cursor = [command.arguments count] > 0 ? command.arguments[0] : nil;
+    return [cursor isKindOfClass:[NSDictionary class]] ? cursor : @{};
+}
+
+- (void) allRangeData: (CDVInvokedUrlCommand*) command
+{
+    [self read:command since:@{} binary:NO];
+}
+
+- (void) readSince: (CDVInvokedUrlCommand*) command
+{
+    [self read:command since:[self cursorOf:command] binary:NO];
+}
+
+- (void) readBinarySince: (CDVInvokedUrlCommand*) command
+{
+    [self read:command since:[self cursorOf:command] binary:YES];
+}
+
+@end
@@ -0,0 +1,149 @@
+//
+//  RangeReplay.h
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+#import "RangeDataManager.h"
+#import "RangeTrigger.h"
+#import "RangePcmReader.h"
+
+/*!
+ Called for every sample that sets off a trigger added with addTrigger:forRange:.
+ */
+typedef void (^RangeReplayTriggerBlock)(RangeTrigger* trigger, NSString* uid, const range_sample_t* sample);
+
+/*!
+ Plays captures (WAV files or headerless PCM) through RangeSignalDecoder, the sample ring,
+ a RangeDataManager and RangeTriggers. No hardware or audio session is needed, so it also works in the Simulator.
+
+ Only for synthetic signals in RangeSignalDecoder's placeholder protocol (see range_signal_encode_frame).
+ Shipping Ranges send something else, and live audio from them is decoded by libRangeLib, so recordings
+ of real hardware decode to nothing here. Development tooling, not part of the plugin.
+ 
+ By default it runs as fast as the CPU allows; a 6 hour cook decodes in seconds.
+ Set speed to play it back at a multiple of real time instead.
+ 
+ Several captures (or several channels of one capture) can be played at once, as if from several devices.
+ They all go into the one RangeDataManager. Set workerCount to decode them in parallel.
+ */
+@interface RangeReplay : NSObject
+
+/*!
+ Where the decoded samples go. A new RangeDataManager unless one was passed to init.
+ If you pass in the RangeDataManager of the Range object, do the replay inside @synchronized(range).
+ */
+@property (strong, readonly) RangeDataManager* dataManager;
+
+/*!
+ Multiple of real time to play at. 0 (the default) plays as fast as possible.
+ */
+@property (assign, readwrite) double speed;
+
+/*!
+ Threads to decode on. 0 (the default) decodes on the thread that calls run, one capture after another
+ a block at a time. More than one only helps with more than one capture.
+ */
+@property (assign, readwrite) int workerCount;
+
+/*!
+ How much audio has been decoded, in seconds, added up over all captures.
+ */
+@property (assign, readonly) double audioSeconds;
+
+/*!
+ How long run has been (or was) running, in seconds.
+ */
+@property (assign, readonly) double wallSeconds;
+
+/*!
+ Samples decoded so far.
+ */
+@property (assign, readonly) unsigned long long samplesDecoded;
+
+/*!
+ Frames that looked like a frame but failed their check.
+ */
+@property (assign, readonly) unsigned long long framesRejected;
+
+/*!
+ A replay with no captures yet. Add them with addWavFile:channel:startTime:.
+ 
+ @param dataManager
+ Where to put the samples. nil for a new RangeDataManager.
+ */
+- (instancetype) initWithDataManager: (RangeDataManager*) dataManager;
+
+/*!
+ A replay of a single WAV file.
+ 
+ @param path
+ The WAV file. 8, 16, 24 and 32 bit integer and 32 bit float samples can be read. Only the first channel is used.
+ 
+ @param startTime
+ Time (since 1970) of the start of the capture. Every sample is timed from it.
+ 
+ @param dataManager
+ Where to put the samples. nil for a new RangeDataManager.
+ 
+ @return nil if the file can't be read.
+ */
+- (instancetype) initWithWavFile: (NSString*) path startTime: (double) startTime dataManager: (RangeDataManager*) dataManager;
+
+/*!
+ A replay of a single file of headerless PCM. The channels are interleaved and only the first one is used.
+ @return nil if the file can't be read.
+ */
+- (instancetype) initWithRawFile: (NSString*) path format: (range_pcm_format_t) format channels: (int) channels
+                      sampleRate: (double) sampleRate startTime: (double) startTime dataManager: (RangeDataManager*) dataManager;
+
+/*!
+ Adds one channel of a WAV file to the captures to play. Call before run.
+ @return NO if the file can't be read or doesn't have that channel.
+ */
+- (BOOL) addWavFile: (NSString*) path channel: (int) channel startTime: (double) startTime;
+
+/*!
+ Adds one channel of a file of headerless PCM to the captures to play. Call before run.
+ @return NO if the file can't be read or the description makes no sense.
+ */
+- (BOOL) addRawFile: (NSString*) path format: (range_pcm_format_t) format channels: (int) channels channel: (int) channel
+         sampleRate: (double) sampleRate startTime: (double) startTime;
+
+/*!
+ Checks every sample of a Range against trigger as it is decoded, in time order.
+ A sample that turns up earlier than one already checked (from another stream) is not checked.
+ Add the triggers before calling run.
+ */
+- (void) addTrigger: (RangeTrigger*) trigger forRange: (NSString*) uid;
+
+/*!
+ Plays all the captures on the calling thread (and the workers). Returns once they are done or cancel is called.
+ 
+ @param triggerBlock
+ Called (on the calling thread) every time one of the triggers goes off. Can be nil.
+ 
+ @return NO if a capture couldn't be read to the end or the samples couldn't be added.
+ */
+- (BOOL) runWithTriggerBlock: (RangeReplayTriggerBlock) triggerBlock;
+
+/*!
+ Makes runWithTriggerBlock: return soon. Can be called from any thread.
+ */
+- (void) cancel;
+
+@end
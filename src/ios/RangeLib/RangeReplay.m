@@ -0,0 +1,382 @@
+//
+//  RangeReplay.m
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "RangeReplay.h"
+#import "RangeDataManager_internal.h"
+#import "RangeReplayStream.h"
+#import "RangeDecodePool.h"
+#include <stdatomic.h>
+
+// About 93ms of audio at 44.1kHz, a few frames per block.
+#define kRReplayBlockFrames 4096
+// Audio time between the bookkeeping Range refreshRangeDataManager does (retention, compression, snapshot).
+#define kRReplayRefreshSeconds 1.0
+// How often to let the workers go further when playing at a set speed.
+#define kRReplayPaceInterval 0.01
+
+/*!
+ A trigger and the Range it watches.
+ */
+@interface RangeReplayTrigger : NSObject
+
+@property (strong, readwrite) RangeTrigger* trigger;
+@property (strong, readwrite) NSString* uid;
+// Time of the last sample of the Range checked. Indexes move when retention drops samples
+// or late samples are merged in; times don't.
+@property (assign, readwrite) double lastCheckedTime;
+
+@end
+
+@implementation RangeReplayTrigger
+@end
+
+
+@interface RangeReplay()
+{
+    // Each stream is allocated on its own; the decoder holds on to its address.
+    range_replay_stream_t** _streams;
+    int _streamCount;
+    atomic_bool _cancelled;
+}
+
+@property (strong, readwrite) RangeDataManager* dataManager;
+@property (strong, readwrite) NSMutableArray* triggers;
+@property (assign, readwrite) double audioSeconds;
+@property (assign, readwrite) double wallSeconds;
+@property (assign, readwrite) unsigned long long samplesDecoded;
+@property (assign, readwrite) unsigned long long framesRejected;
+
+@end
+
+
+@implementation RangeReplay
+
+- (instancetype) initWithDataManager: (RangeDataManager*) dataManager
+{
+    if (self = [super init])
+    {
+        atomic_init(&_cancelled, false);
+        self.dataManager = dataManager != nil ? dataManager : [[RangeDataManager alloc] init];
+        self.triggers = [[NSMutableArray alloc] init];
+        return self;
+    } else {
+        return nil;
+    }
+}
+
+- (instancetype) initWithWavFile: (NSString*) path startTime: (double) startTime dataManager: (RangeDataManager*) dataManager
+{
+    self = [self initWithDataManager:dataManager];
+    if(self == nil || ![self addWavFile:path channel:0 startTime:startTime])
+    {
+        return nil;
+    }
+    return self;
+}
+
+- (instancetype) initWithRawFile: (NSString*) path format: (range_pcm_format_t) format channels: (int) channels
+                      sampleRate: (double) sampleRate startTime: (double) startTime dataManager: (RangeDataManager*) dataManager
+{
+    self = [self initWithDataManager:dataManager];
+    if(self == nil || ![self addRawFile:path format:format channels:channels channel:0 sampleRate:sampleRate startTime:startTime])
+    {
+        return nil;
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    for(int i = 0; i < _streamCount; i++)
+    {
+        range_replay_stream_destroy(_streams[i]);
+        free(_streams[i]);
+    }
+    free(_streams);
+}
+
+// Takes over reader.
+- (BOOL) addReader: (range_pcm_reader_t*) reader channel: (int) channel startTime: (double) startTime
+{
+    if(channel < 0 || channel >= reader->channels)
+    {
+        NSLog(@"%s - The capture has no channel %d.", __PRETTY_FUNCTION__, channel);
+        range_pcm_close(reader);
+        return NO;
+    }
+    reader->channel = channel;
+
+    range_replay_stream_t** streams = realloc(_streams, sizeof(range_replay_stream_t*) * (_streamCount + 1));
+    range_replay_stream_t* stream = malloc(sizeof(range_replay_stream_t));
+    if(streams == NULL || stream == NULL)
+    {
+        NSLog(@"RDC - Out of memory.");
+        if(streams != NULL)
+        {
+            _streams = streams;
+        }
+        free(stream);
+        range_pcm_close(reader);
+        return NO;
+    }
+    _streams = streams;
+    if(!range_replay_stream_init(stream, reader, startTime, kRReplayBlockFrames))
+    {
+        NSLog(@"%s - The capture can't be decoded.", __PRETTY_FUNCTION__);
+        free(stream);
+        return NO;
+    }
+    _streams[_streamCount++] = stream;
+    return YES;
+}
+
+- (BOOL) addWavFile: (NSString*) path channel: (int) channel startTime: (double) startTime
+{
+    range_pcm_reader_t reader;
+    if(!range_pcm_open_wav(&reader, [path fileSystemRepresentation]))
+    {
+        NSLog(@"%s - Can't read %@ as a WAV file.", __PRETTY_FUNCTION__, path);
+        return NO;
+    }
+    return [self addReader:&reader channel:channel startTime:startTime];
+}
+
+- (BOOL) addRawFile: (NSString*) path format: (range_pcm_format_t) format channels: (int) channels channel: (int) channel
+         sampleRate: (double) sampleRate startTime: (double) startTime
+{
+    range_pcm_reader_t reader;
+    if(!range_pcm_open_raw(&reader, [path fileSystemRepresentation], format, channels, sampleRate))
+    {
+        NSLog(@"%s - Can't read %@.", __PRETTY_FUNCTION__, path);
+        return NO;
+    }
+    return [self addReader:&reader channel:channel startTime:startTime];
+}
+
+- (void) addTrigger: (RangeTrigger*) trigger forRange: (NSString*) uid
+{
+    RangeReplayTrigger* entry = [[RangeReplayTrigger alloc] init];
+    entry.trigger = trigger;
+    entry.uid = uid;
+    const range_sample_t* latest = [[self.dataManager getDataByRange:uid] latestSample];
+    entry.lastCheckedTime = latest != NULL ? latest->unix_time : -INFINITY;
+    [self.triggers addObject:entry];
+}
+
+- (void) cancel
+{
+    atomic_store(&_cancelled, true);
+}
+
+// Runs the triggers over the samples added since the last time.
+- (void) checkTriggers: (RangeReplayTriggerBlock) triggerBlock
+{
+    for(RangeReplayTrigger* entry in self.triggers)
+    {
+        // The run is copied when it crosses a chunk, and this is called for every block of audio.
+        @autoreleasepool
+        {
+            RangeData* rData = [self.dataManager getDataByRange:entry.uid];
+            int length = 0;
+            const range_sample_t* samples = [rData findSamplesFromStart:nextafter(entry.lastCheckedTime, INFINITY) toStop:INFINITY
+                                                       withOutputLength:&length];
+            if(samples == NULL || length <= 0)
+            {
+                continue;
+            }
+            NSIndexSet* fired = [entry.trigger triggerIndexesForRawData:samples length:length];
+            if(triggerBlock != nil)
+            {
+                [fired enumerateIndexesUsingBlock:^(NSUInteger i, BOOL* stop) {
+                    triggerBlock(entry.trigger, entry.uid, &samples[i]);
+                }];
+            }
+            entry.lastCheckedTime = samples[length - 1].unix_time;
+        }
+    }
+}
+
+- (void) refresh
+{
+    [self.dataManager applyRetention];
+    [self.dataManager syncPersistentDataIfDue];
+    [self.dataManager compressSealedData];
+    [self.dataManager publishSnapshot];
+}
+
+// Moves what the decoders produced into the RangeDataManager, then checks the triggers.
+- (BOOL) drainStreams: (RangeReplayTriggerBlock) triggerBlock
+{
+    BOOL output = YES;
+    for(int i = 0; i < _streamCount; i++)
+    {
+        if(![self.dataManager addSamplesFromRing:&_streams[i]->ring])
+        {
+            output = NO;
+        }
+    }
+    [self checkTriggers:triggerBlock];
+    return output;
+}
+
+// Updates the counters. Returns the audio time of the stream that is furthest behind.
+// The decoder counters are only safe to read when no worker is decoding.
+- (double) updateProgress: (NSDate*) wallStart withDecoderCounts: (BOOL) withDecoderCounts
+{
+    double total = 0.0;
+    double slowest = INFINITY;
+    unsigned long long samples = 0;
+    unsigned long long rejected = 0;
+    for(int i = 0; i < _streamCount; i++)
+    {
+        double seconds = range_replay_stream_seconds(_streams[i]);
+        total += seconds;
+        if(!_streams[i]->finished && seconds < slowest)
+        {
+            slowest = seconds;
+        }
+        if(withDecoderCounts)
+        {
+            samples += _streams[i]->decoder.frames_decoded;
+            rejected += _streams[i]->decoder.frames_rejected;
+        }
+    }
+    self.audioSeconds = total;
+    if(withDecoderCounts)
+    {
+        self.samplesDecoded = samples;
+        self.framesRejected = rejected;
+    }
+    self.wallSeconds = -[wallStart timeIntervalSinceNow];
+    return slowest;
+}
+
+// Decodes on this thread, a block of every capture in turn.
+- (BOOL) runSerially: (RangeReplayTriggerBlock) triggerBlock wallStart: (NSDate*) wallStart
+{
+    BOOL output = YES;
+    double nextRefresh = kRReplayRefreshSeconds;
+    BOOL running = YES;
+    while(running && !atomic_load(&_cancelled))
+    {
+        running = NO;
+        for(int i = 0; i < _streamCount; i++)
+        {
+            int count = range_replay_stream_step(_streams[i]);
+            if(count < 0)
+            {
+                NSLog(@"%s - Reading a capture failed.", __PRETTY_FUNCTION__);
+                output = NO;
+            }
+            running = running || count > 0;
+        }
+        if(![self drainStreams:triggerBlock])
+        {
+            output = NO;
+        }
+
+        double slowest = [self updateProgress:wallStart withDecoderCounts:YES];
+        if(slowest >= nextRefresh && running)
+        {
+            [self refresh];
+            nextRefresh = slowest + kRReplayRefreshSeconds;
+        }
+
+        double speed = self.speed;
+        if(speed > 0.0 && running)
+        {
+            double ahead = slowest / speed - self.wallSeconds;
+            if(ahead > 0.0)
+            {
+                [NSThread sleepForTimeInterval:ahead];
+            }
+        }
+    }
+    return output;
+}
+
+// Decodes on a RangeDecodePool while this thread drains.
+- (BOOL) runOnWorkers: (RangeReplayTriggerBlock) triggerBlock wallStart: (NSDate*) wallStart
+{
+    range_decode_pool_t* pool = range_decode_pool_create(_streams, _streamCount, self.workerCount);
+    if(pool == NULL)
+    {
+        NSLog(@"%s - Couldn't start the workers.", __PRETTY_FUNCTION__);
+        return NO;
+    }
+
+    BOOL output = YES;
+    double nextRefresh = kRReplayRefreshSeconds;
+    BOOL running = YES;
+    while(running && !atomic_load(&_cancelled))
+    {
+        double speed = self.speed;
+        if(speed > 0.0)
+        {
+            // Let every capture get one block past where real time (times speed) is.
+            range_decode_pool_set_limit(pool, -[wallStart timeIntervalSinceNow] * speed);
+        }
+        running = range_decode_pool_wait(pool, speed > 0.0 ? kRReplayPaceInterval : -1.0);
+
+        if(![self drainStreams:triggerBlock])
+        {
+            output = NO;
+        }
+        range_decode_pool_drained(pool);
+
+        double slowest = [self updateProgress:wallStart withDecoderCounts:NO];
+        if(slowest >= nextRefresh && running)
+        {
+            [self refresh];
+            nextRefresh = slowest + kRReplayRefreshSeconds;
+        }
+    }
+
+    if(range_decode_pool_failed(pool))
+    {
+        NSLog(@"%s - Reading a capture failed.", __PRETTY_FUNCTION__);
+        output = NO;
+    }
+    range_decode_pool_destroy(pool);
+    // Whatever the workers finished after the last drain.
+    if(![self drainStreams:triggerBlock])
+    {
+        output = NO;
+    }
+    return output;
+}
+
+- (BOOL) runWithTriggerBlock: (RangeReplayTriggerBlock) triggerBlock
+{
+    NSDate* wallStart = [NSDate date];
+    BOOL output;
+    if(self.workerCount > 0)
+    {
+        output = [self runOnWorkers:triggerBlock wallStart:wallStart];
+    } else {
+        output = [self runSerially:triggerBlock wallStart:wallStart];
+    }
+
+    [self refresh];
+    [self.dataManager syncPersistentData];
+    [self updateProgress:wallStart withDecoderCounts:YES];
+    return output;
+}
+
+@end
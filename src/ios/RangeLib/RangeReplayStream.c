@@ -0,0 +1,120 @@
+//
+//  RangeReplayStream.c
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "RangeReplayStream.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Room for a good many steps, so a stream decoded on another thread (RangeDecodePool) rarely waits on the drain.
+#define RRS_RING_CAPACITY 1024
+
+static void rrs_sample_decoded(void* context, const range_uid_t* uid, range_sample_t sample)
+{
+    range_replay_stream_t* stream = context;
+    range_ring_entry_t entry;
+    entry.sample = sample;
+    entry.uid = *uid;
+    range_ring_push(&stream->ring, &entry);
+}
+
+bool range_replay_stream_init(range_replay_stream_t* stream, range_pcm_reader_t* reader,
+                              double start_time, int block_frames)
+{
+    memset(stream, 0, sizeof(*stream));
+    atomic_init(&stream->frames_decoded, 0);
+    atomic_init(&stream->finished, false);
+    stream->reader = *reader;
+    memset(reader, 0, sizeof(*reader));
+    stream->start_time = start_time;
+    stream->block_frames = block_frames;
+    if(block_frames < 1 || block_frames > RANGE_REPLAY_MAX_BLOCK)
+    {
+        range_pcm_close(&stream->reader);
+        return false;
+    }
+
+    range_signal_config_t config;
+    range_signal_default_config(&config);
+    config.sample_rate = stream->reader.sample_rate;
+
+    stream->block = malloc(sizeof(float) * (size_t)block_frames);
+    bool ring_ready = range_ring_init(&stream->ring, RRS_RING_CAPACITY);
+    bool decoder_ready = range_signal_decoder_init(&stream->decoder, &config, rrs_sample_decoded, stream);
+    if(stream->block == NULL || !ring_ready || !decoder_ready)
+    {
+        free(stream->block);
+        if(ring_ready)
+        {
+            range_ring_destroy(&stream->ring);
+        }
+        if(decoder_ready)
+        {
+            range_signal_decoder_destroy(&stream->decoder);
+        }
+        range_pcm_close(&stream->reader);
+        memset(stream, 0, sizeof(*stream));
+        return false;
+    }
+    return true;
+}
+
+void range_replay_stream_destroy(range_replay_stream_t* stream)
+{
+    if(stream->block == NULL)
+    {
+        return;
+    }
+    free(stream->block);
+    range_ring_destroy(&stream->ring);
+    range_signal_decoder_destroy(&stream->decoder);
+    range_pcm_close(&stream->reader);
+    memset(stream, 0, sizeof(*stream));
+}
+
+int range_replay_stream_step(range_replay_stream_t* stream)
+{
+    if(atomic_load_explicit(&stream->finished, memory_order_relaxed))
+    {
+        return 0;
+    }
+    int count = range_pcm_read(&stream->reader, stream->block, stream->block_frames);
+    if(count <= 0)
+    {
+        atomic_store_explicit(&stream->finished, true, memory_order_relaxed);
+        return count;
+    }
+    // Only the first block needs a time, the decoder counts samples from there.
+    long long decoded = atomic_load_explicit(&stream->frames_decoded, memory_order_relaxed);
+    double first_time = decoded == 0 ? stream->start_time : NAN;
+    range_signal_decoder_push(&stream->decoder, stream->block, count, first_time);
+    atomic_store_explicit(&stream->frames_decoded, decoded + count, memory_order_relaxed);
+    return count;
+}
+
+bool range_replay_stream_has_room(range_replay_stream_t* stream)
+{
+    return range_ring_capacity(&stream->ring) - range_ring_count(&stream->ring) >= RANGE_REPLAY_STEP_SAMPLES;
+}
+
+double range_replay_stream_seconds(const range_replay_stream_t* stream)
+{
+    long long decoded = atomic_load_explicit(&((range_replay_stream_t*)stream)->frames_decoded, memory_order_relaxed);
+    return stream->reader.sample_rate > 0.0 ? (double)decoded / stream->reader.sample_rate : 0.0;
+}
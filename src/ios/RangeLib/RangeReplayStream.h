@@ -0,0 +1,80 @@
+//
+//  RangeReplayStream.h
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RangeReplayStream_h
+#define RangeReplayStream_h
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include "RangePcmReader.h"
+#include "RangeSampleRing.h"
+#include "RangeSignalDecoder.h"
+
+/*
+ One recorded capture being decoded: a range_pcm_reader_t feeding a range_signal_decoder_t,
+ whose samples land in a range_ring_t just as they do from the microphone.
+ Each step decodes one block, as fast as the CPU goes; pacing is up to the caller (see RangeReplay).
+ Drain the ring (RangeDataManager addSamplesFromRing:) often. Don't step unless range_replay_stream_has_room,
+ or samples may be dropped.
+ */
+
+// Largest block a step may decode.
+#define RANGE_REPLAY_MAX_BLOCK 65536
+// Most samples one step can push. A frame is at least 6 bytes (60 bits, over 2000 audio frames at the default rates).
+#define RANGE_REPLAY_STEP_SAMPLES 32
+
+typedef struct {
+    range_pcm_reader_t      reader;
+    range_signal_decoder_t  decoder;
+    range_ring_t            ring;
+    float*                  block;
+    int                     block_frames;
+    // Time (since 1970) given to the first frame of the capture.
+    double                  start_time;
+    // Atomic so other threads can follow along while a RangeDecodePool worker steps the stream.
+    _Atomic long long       frames_decoded;
+    atomic_bool             finished;
+} range_replay_stream_t;
+
+/*
+ Takes over reader (an open range_pcm_reader_t), even when this fails.
+ The capture is decoded as if it was recorded from start_time on, block_frames at a time.
+ Returns false if the reader's sample rate doesn't suit the decoder or we ran out of memory.
+ */
+bool range_replay_stream_init(range_replay_stream_t* stream, range_pcm_reader_t* reader,
+                              double start_time, int block_frames);
+void range_replay_stream_destroy(range_replay_stream_t* stream);
+
+/*
+ Reads and decodes the next block.
+ Returns the number of frames decoded, 0 once the capture is finished, or -1 if reading failed.
+ */
+int range_replay_stream_step(range_replay_stream_t* stream);
+
+/*
+ True if the ring has room for everything the next step might push.
+ */
+bool range_replay_stream_has_room(range_replay_stream_t* stream);
+
+/*
+ How much audio has been decoded so far, in seconds.
+ */
+double range_replay_stream_seconds(const range_replay_stream_t* stream);
+
+#endif /* RangeReplayStream_h */
@@ -0,0 +1,263 @@
+//
+//  RangeRollingWindow.c
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "RangeRollingWindow.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RW_INITIAL_CAPACITY 64
+
+static uint64_t rw_slot(const range_window_t* window, uint64_t number)
+{
+    return number & (window->capacity - 1);
+}
+
+static void rw_copy_deque(uint64_t* to, uint64_t to_capacity, const uint64_t* from, uint64_t from_capacity,
+                          uint64_t first, uint64_t end)
+{
+    for(uint64_t i = first; i < end; i++)
+    {
+        to[i & (to_capacity - 1)] = from[i & (from_capacity - 1)];
+    }
+}
+
+// Doubles the capacity. Everything keeps its sample number.
+static bool rw_grow(range_window_t* window)
+{
+    uint64_t capacity = window->capacity ? window->capacity * 2 : RW_INITIAL_CAPACITY;
+    double* times = malloc(sizeof(double) * capacity);
+    float* temperatures = malloc(sizeof(float) * capacity);
+    uint64_t* min_deque = malloc(sizeof(uint64_t) * capacity);
+    uint64_t* max_deque = malloc(sizeof(uint64_t) * capacity);
+    if(times == NULL || temperatures == NULL || min_deque == NULL || max_deque == NULL)
+    {
+        free(times);
+        free(temperatures);
+        free(min_deque);
+        free(max_deque);
+        return false;
+    }
+
+    for(uint64_t i = window->first; i < window->end; i++)
+    {
+        times[i & (capacity - 1)] = window->times[rw_slot(window, i)];
+        temperatures[i & (capacity - 1)] = window->temperatures[rw_slot(window, i)];
+    }
+    rw_copy_deque(min_deque, capacity, window->min_deque, window->capacity, window->min_first, window->min_end);
+    rw_copy_deque(max_deque, capacity, window->max_deque, window->capacity, window->max_first, window->max_end);
+
+    free(window->times);
+    free(window->temperatures);
+    free(window->min_deque);
+    free(window->max_deque);
+    window->times = times;
+    window->temperatures = temperatures;
+    window->min_deque = min_deque;
+    window->max_deque = max_deque;
+    window->capacity = capacity;
+    return true;
+}
+
+static void rw_add_to_sums(range_window_t* window, double time, float temperature, double sign)
+{
+    double t = time - window->reference_time;
+    double v = temperature;
+    window->sum_t += sign * t;
+    window->sum_tt += sign * t * t;
+    window->sum_v += sign * v;
+    window->sum_vv += sign * v * v;
+    window->sum_tv += sign * t * v;
+}
+
+// Adds the sums up again from the samples, relative to the oldest one.
+static void rw_resum(range_window_t* window)
+{
+    window->reference_time = window->first < window->end ? window->times[rw_slot(window, window->first)] : 0.0;
+    window->sum_t = 0.0;
+    window->sum_tt = 0.0;
+    window->sum_v = 0.0;
+    window->sum_vv = 0.0;
+    window->sum_tv = 0.0;
+    for(uint64_t i = window->first; i < window->end; i++)
+    {
+        rw_add_to_sums(window, window->times[rw_slot(window, i)], window->temperatures[rw_slot(window, i)], 1.0);
+    }
+    window->evicted = 0;
+}
+
+void range_window_init(range_window_t* window, double width)
+{
+    memset(window, 0, sizeof(range_window_t));
+    window->width = width;
+}
+
+void range_window_destroy(range_window_t* window)
+{
+    free(window->times);
+    free(window->temperatures);
+    free(window->min_deque);
+    free(window->max_deque);
+    range_window_init(window, window->width);
+}
+
+void range_window_clear(range_window_t* window)
+{
+    window->first = window->end;
+    window->min_first = window->min_end;
+    window->max_first = window->max_end;
+    rw_resum(window);
+}
+
+bool range_window_add(range_window_t* window, double time, float temperature)
+{
+    if(window->end - window->first == window->capacity && !rw_grow(window))
+    {
+        return false;
+    }
+
+    if(window->first == window->end)
+    {
+        window->reference_time = time;
+    }
+
+    uint64_t number = window->end++;
+    window->times[rw_slot(window, number)] = time;
+    window->temperatures[rw_slot(window, number)] = temperature;
+    rw_add_to_sums(window, time, temperature, 1.0);
+
+    // Anything that isn't smaller (larger) than the new sample can never be the min (max) again.
+    while(window->min_end > window->min_first &&
+          window->temperatures[rw_slot(window, window->min_deque[rw_slot(window, window->min_end - 1)])] >= temperature)
+    {
+        window->min_end--;
+    }
+    window->min_deque[rw_slot(window, window->min_end++)] = number;
+    while(window->max_end > window->max_first &&
+          window->temperatures[rw_slot(window, window->max_deque[rw_slot(window, window->max_end - 1)])] <= temperature)
+    {
+        window->max_end--;
+    }
+    window->max_deque[rw_slot(window, window->max_end++)] = number;
+
+    // Drop what fell out of the window.
+    double oldest_allowed = time - window->width;
+    while(window->times[rw_slot(window, window->first)] < oldest_allowed)
+    {
+        uint64_t oldest = window->first++;
+        rw_add_to_sums(window, window->times[rw_slot(window, oldest)], window->temperatures[rw_slot(window, oldest)], -1.0);
+        if(window->min_deque[rw_slot(window, window->min_first)] == oldest)
+        {
+            window->min_first++;
+        }
+        if(window->max_deque[rw_slot(window, window->max_first)] == oldest)
+        {
+            window->max_first++;
+        }
+        window->evicted++;
+    }
+
+    if(window->evicted >= window->end - window->first)
+    {
+        rw_resum(window);
+    }
+    return true;
+}
+
+void range_window_stats(const range_window_t* window, range_window_stats_t* stats_out)
+{
+    memset(stats_out, 0, sizeof(range_window_stats_t));
+    uint64_t count = window->end - window->first;
+    if(count == 0)
+    {
+        return;
+    }
+
+    double n = (double)count;
+    double mean = window->sum_v / n;
+    double variance = window->sum_vv / n - mean * mean;
+
+    stats_out->count = (int)count;
+    stats_out->start_time = window->times[rw_slot(window, window->first)];
+    stats_out->stop_time = window->times[rw_slot(window, window->end - 1)];
+    stats_out->min_temperature = window->temperatures[rw_slot(window, window->min_deque[rw_slot(window, window->min_first)])];
+    stats_out->max_temperature = window->temperatures[rw_slot(window, window->max_deque[rw_slot(window, window->max_first)])];
+    stats_out->mean_temperature = (float)mean;
+    stats_out->stddev_temperature = variance > 0.0 ? (float)sqrt(variance) : 0.0f;
+
+    double denominator = n * window->sum_tt - window->sum_t * window->sum_t;
+    if(count > 1 && denominator > 0.0)
+    {
+        stats_out->slope_per_minute = (float)(60.0 * (n * window->sum_tv - window->sum_t * window->sum_v) / denominator);
+    }
+}
+
+bool range_window_time_to(const range_window_t* window, float temperature, int direction,
+                          double* seconds_out, float* confidence_out)
+{
+    uint64_t count = window->end - window->first;
+    if(count < 2)
+    {
+        return false;
+    }
+
+    double n = (double)count;
+    double spread_t = n * window->sum_tt - window->sum_t * window->sum_t;
+    double spread_v = n * window->sum_vv - window->sum_v * window->sum_v;
+    double covariance = n * window->sum_tv - window->sum_t * window->sum_v;
+    if(spread_t <= 0.0)
+    {
+        return false;
+    }
+    double slope = covariance / spread_t;
+    double intercept = (window->sum_v - slope * window->sum_t) / n;
+
+    // Where the line is at the newest sample, relative to the target.
+    double newest = window->times[rw_slot(window, window->end - 1)] - window->reference_time;
+    double distance = (double)temperature - (intercept + slope * newest);
+    if(slope == 0.0 || (direction > 0 && slope < 0.0) || (direction < 0 && slope > 0.0))
+    {
+        return false;
+    }
+    if(distance * slope < 0.0)
+    {
+        // The line is past temperature and heading away. With a direction that means it got there already,
+        // without one it means it isn't going to.
+        if(direction == 0)
+        {
+            return false;
+        }
+        distance = 0.0;
+    }
+    double seconds = distance / slope;
+
+    double fit = spread_v > 0.0 ? covariance * covariance / (spread_t * spread_v) : 0.0;
+    double span = window->times[rw_slot(window, window->end - 1)] - window->times[rw_slot(window, window->first)];
+    if(seconds > span)
+    {
+        fit *= span / seconds;
+    }
+    *seconds_out = seconds;
+    if(confidence_out != NULL)
+    {
+        *confidence_out = (float)fmin(fit, 1.0);
+    }
+    return true;
+}
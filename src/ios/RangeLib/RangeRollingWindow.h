@@ -0,0 +1,97 @@
+//
+//  RangeRollingWindow.h
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RangeRollingWindow_h
+#define RangeRollingWindow_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "RangeTypes.h"
+
+/*
+ Statistics over the last width seconds of samples, kept up to date one sample at a time.
+
+ The samples in the window sit in a ring buffer. Min and max come from two monotonic deques
+ (the front of each is the answer), the rest from running sums. Adding a sample and reading
+ the statistics are both amortized O(1), however long the window is.
+
+ The running sums are relative to a reference time, and are added up again from the samples
+ every time the whole window has been replaced, so rounding errors don't build up.
+
+ None of these functions lock.
+ */
+
+typedef struct {
+    double      width;
+    // Samples in the window. Sample number n lives at n & (capacity - 1).
+    double*     times;
+    float*      temperatures;
+    uint64_t    first;
+    uint64_t    end;
+    // Sample numbers with ascending (min) / descending (max) temperatures.
+    uint64_t*   min_deque;
+    uint64_t    min_first;
+    uint64_t    min_end;
+    uint64_t*   max_deque;
+    uint64_t    max_first;
+    uint64_t    max_end;
+    // Always a power of two.
+    uint64_t    capacity;
+    double      reference_time;
+    double      sum_t;
+    double      sum_tt;
+    double      sum_v;
+    double      sum_vv;
+    double      sum_tv;
+    // Samples dropped since the sums were last added up from scratch.
+    uint64_t    evicted;
+} range_window_t;
+
+/*
+ width is how many seconds back from the newest sample the window reaches.
+ */
+void range_window_init(range_window_t* window, double width);
+void range_window_destroy(range_window_t* window);
+
+/*
+ Empties the window.
+ */
+void range_window_clear(range_window_t* window);
+
+/*
+ Adds a sample and drops the ones that are now more than width older than it.
+ time must not be earlier than the last sample added (clear the window first otherwise).
+ Returns false if we ran out of memory.
+ */
+bool range_window_add(range_window_t* window, double time, float temperature);
+
+void range_window_stats(const range_window_t* window, range_window_stats_t* stats_out);
+
+/*
+ Extends the least squares line through the window to see when it reaches temperature.
+ direction is 1 if only rising to it counts, -1 if only falling and 0 for either way.
+ seconds_out gets the time from the newest sample, 0 if the line is already past temperature.
+ confidence_out (0 to 1) is the r squared of the fit, scaled down when the answer is further
+ in the future than the window is wide. confidence_out can be NULL.
+ Returns false if the line doesn't head that way (or there are fewer than two samples).
+ */
+bool range_window_time_to(const range_window_t* window, float temperature, int direction,
+                          double* seconds_out, float* confidence_out);
+
+#endif /* RangeRollingWindow_h */
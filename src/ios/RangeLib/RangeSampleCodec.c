@@ -0,0 +1,348 @@
+//
+//  RangeSampleCodec.c
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "RangeSampleCodec.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Worst case for one sample: 5 + 64 bits of time, 2 + 5 + 5 + 32 bits of temperature.
+#define RC_MAX_BITS_PER_SAMPLE 113
+
+typedef struct {
+    uint8_t*    data;
+    size_t      bit_position;
+} rc_writer_t;
+
+#pragma mark - bits
+
+static void rc_write_bits(rc_writer_t* writer, uint64_t value, int bit_count)
+{
+    // Most significant bit first.
+    for(int i = bit_count - 1; i >= 0; i--)
+    {
+        if((value >> i) & 1)
+        {
+            writer->data[writer->bit_position >> 3] |= (uint8_t)(0x80 >> (writer->bit_position & 7));
+        }
+        writer->bit_position++;
+    }
+}
+
+static bool rc_read_bits(range_codec_iterator_t* iterator, int bit_count, uint64_t* value_out)
+{
+    if(iterator->bit_position + (size_t)bit_count > iterator->size * 8)
+    {
+        return false;
+    }
+
+    uint64_t value = 0;
+    for(int i = 0; i < bit_count; i++)
+    {
+        size_t position = iterator->bit_position++;
+        value = (value << 1) | ((iterator->data[position >> 3] >> (7 - (position & 7))) & 1);
+    }
+    *value_out = value;
+    return true;
+}
+
+static int64_t rc_double_bits(double value)
+{
+    int64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static uint32_t rc_float_bits(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static int rc_leading_zeros(uint32_t value)
+{
+    int count = 0;
+    for(uint32_t mask = 0x80000000u; mask != 0 && (value & mask) == 0; mask >>= 1)
+    {
+        count++;
+    }
+    return count;
+}
+
+static int rc_trailing_zeros(uint32_t value)
+{
+    int count = 0;
+    for(uint32_t mask = 1; mask != 0 && (value & mask) == 0; mask <<= 1)
+    {
+        count++;
+    }
+    return count;
+}
+
+#pragma mark - timestamps
+
+// Control bits and payload sizes for the delta of delta, smallest first.
+// The last one holds anything.
+static const int rc_dod_payload_bits[] = { 7, 12, 20, 32, 64 };
+#define RC_DOD_BUCKETS 5
+
+static void rc_write_dod(rc_writer_t* writer, int64_t dod)
+{
+    if(dod == 0)
+    {
+        rc_write_bits(writer, 0, 1);
+        return;
+    }
+
+    for(int bucket = 0; bucket < RC_DOD_BUCKETS; bucket++)
+    {
+        int bits = rc_dod_payload_bits[bucket];
+        int64_t limit = bits == 64 ? INT64_MAX : ((int64_t)1 << (bits - 1));
+        if(bits == 64 || (dod >= -limit && dod < limit))
+        {
+            // bucket + 1 ones, then a zero (left out for the last bucket).
+            int control_bits = bucket + 2 > RC_DOD_BUCKETS ? RC_DOD_BUCKETS : bucket + 2;
+            uint64_t control = ((1u << (bucket + 1)) - 1) << (control_bits - bucket - 1);
+            rc_write_bits(writer, control, control_bits);
+            rc_write_bits(writer, (uint64_t)dod, bits);
+            return;
+        }
+    }
+}
+
+static bool rc_read_dod(range_codec_iterator_t* iterator, int64_t* dod_out)
+{
+    int bucket = -1;
+    uint64_t bit = 1;
+    while(bit == 1 && bucket < RC_DOD_BUCKETS - 1)
+    {
+        if(!rc_read_bits(iterator, 1, &bit))
+        {
+            return false;
+        }
+        if(bit == 1)
+        {
+            bucket++;
+        }
+    }
+
+    if(bucket < 0)
+    {
+        *dod_out = 0;
+        return true;
+    }
+
+    int bits = rc_dod_payload_bits[bucket];
+    uint64_t payload;
+    if(!rc_read_bits(iterator, bits, &payload))
+    {
+        return false;
+    }
+
+    // Sign extend.
+    if(bits < 64 && (payload & ((uint64_t)1 << (bits - 1))))
+    {
+        payload |= ~(((uint64_t)1 << bits) - 1);
+    }
+    *dod_out = (int64_t)payload;
+    return true;
+}
+
+#pragma mark - temperatures
+
+static void rc_write_temperature(rc_writer_t* writer, uint32_t xor_bits, int* leading, int* trailing)
+{
+    if(xor_bits == 0)
+    {
+        rc_write_bits(writer, 0, 1);
+        return;
+    }
+
+    int leading_zeros = rc_leading_zeros(xor_bits);
+    int trailing_zeros = rc_trailing_zeros(xor_bits);
+    if(leading_zeros > 31)
+    {
+        leading_zeros = 31;
+    }
+
+    if(*leading >= 0 && leading_zeros >= *leading && trailing_zeros >= *trailing)
+    {
+        // Fits in the same window as the one before.
+        rc_write_bits(writer, 2, 2);
+        rc_write_bits(writer, xor_bits >> *trailing, 32 - *leading - *trailing);
+        return;
+    }
+
+    int meaningful = 32 - leading_zeros - trailing_zeros;
+    rc_write_bits(writer, 3, 2);
+    rc_write_bits(writer, (uint64_t)leading_zeros, 5);
+    rc_write_bits(writer, (uint64_t)(meaningful - 1), 5);
+    rc_write_bits(writer, xor_bits >> trailing_zeros, meaningful);
+    *leading = leading_zeros;
+    *trailing = trailing_zeros;
+}
+
+static bool rc_read_temperature(range_codec_iterator_t* iterator, uint32_t* xor_out)
+{
+    uint64_t bit;
+    if(!rc_read_bits(iterator, 1, &bit))
+    {
+        return false;
+    }
+    if(bit == 0)
+    {
+        *xor_out = 0;
+        return true;
+    }
+
+    if(!rc_read_bits(iterator, 1, &bit))
+    {
+        return false;
+    }
+    if(bit == 1)
+    {
+        uint64_t leading_zeros;
+        uint64_t meaningful;
+        if(!rc_read_bits(iterator, 5, &leading_zeros) || !rc_read_bits(iterator, 5, &meaningful))
+        {
+            return false;
+        }
+        iterator->leading_zeros = (int)leading_zeros;
+        iterator->trailing_zeros = 32 - (int)leading_zeros - ((int)meaningful + 1);
+    }
+    else if(iterator->leading_zeros < 0)
+    {
+        return false;
+    }
+
+    uint64_t value;
+    if(!rc_read_bits(iterator, 32 - iterator->leading_zeros - iterator->trailing_zeros, &value))
+    {
+        return false;
+    }
+    *xor_out = (uint32_t)(value << iterator->trailing_zeros);
+    return true;
+}
+
+#pragma mark - public
+
+bool range_codec_encode(const double* times, const float* temperatures, int count,
+                        uint8_t** data_out, size_t* size_out)
+{
+    size_t capacity = ((size_t)count * RC_MAX_BITS_PER_SAMPLE + 96 + 7) / 8;
+    rc_writer_t writer;
+    writer.data = calloc(capacity > 0 ? capacity : 1, 1);
+    writer.bit_position = 0;
+    if(writer.data == NULL)
+    {
+        return false;
+    }
+
+    int64_t previous_time_bits = 0;
+    int64_t previous_delta = 0;
+    uint32_t previous_temperature_bits = 0;
+    int leading = -1;
+    int trailing = 0;
+
+    for(int i = 0; i < count; i++)
+    {
+        int64_t time_bits = rc_double_bits(times[i]);
+        uint32_t temperature_bits = rc_float_bits(temperatures[i]);
+
+        if(i == 0)
+        {
+            rc_write_bits(&writer, (uint64_t)time_bits, 64);
+            rc_write_bits(&writer, temperature_bits, 32);
+        } else {
+            int64_t delta = (int64_t)((uint64_t)time_bits - (uint64_t)previous_time_bits);
+            rc_write_dod(&writer, (int64_t)((uint64_t)delta - (uint64_t)previous_delta));
+            rc_write_temperature(&writer, temperature_bits ^ previous_temperature_bits, &leading, &trailing);
+            previous_delta = delta;
+        }
+
+        previous_time_bits = time_bits;
+        previous_temperature_bits = temperature_bits;
+    }
+
+    size_t size = (writer.bit_position + 7) / 8;
+    uint8_t* shrunk = realloc(writer.data, size > 0 ? size : 1);
+    *data_out = shrunk != NULL ? shrunk : writer.data;
+    *size_out = size;
+    return true;
+}
+
+void range_codec_iterator_init(range_codec_iterator_t* iterator, const uint8_t* data, size_t size, int count)
+{
+    memset(iterator, 0, sizeof(range_codec_iterator_t));
+    iterator->data = data;
+    iterator->size = size;
+    iterator->remaining = count;
+    iterator->leading_zeros = -1;
+}
+
+bool range_codec_iterator_next(range_codec_iterator_t* iterator, double* time_out, float* temperature_out)
+{
+    if(iterator->remaining <= 0)
+    {
+        return false;
+    }
+
+    uint64_t bits;
+    if(!iterator->started)
+    {
+        uint64_t temperature_bits;
+        if(!rc_read_bits(iterator, 64, &bits) || !rc_read_bits(iterator, 32, &temperature_bits))
+        {
+            return false;
+        }
+        iterator->previous_time_bits = (int64_t)bits;
+        iterator->previous_temperature_bits = (uint32_t)temperature_bits;
+        iterator->started = true;
+    } else {
+        int64_t dod;
+        uint32_t xor_bits;
+        if(!rc_read_dod(iterator, &dod) || !rc_read_temperature(iterator, &xor_bits))
+        {
+            return false;
+        }
+        iterator->previous_delta = (int64_t)((uint64_t)iterator->previous_delta + (uint64_t)dod);
+        iterator->previous_time_bits = (int64_t)((uint64_t)iterator->previous_time_bits + (uint64_t)iterator->previous_delta);
+        iterator->previous_temperature_bits ^= xor_bits;
+    }
+
+    memcpy(time_out, &iterator->previous_time_bits, sizeof(double));
+    memcpy(temperature_out, &iterator->previous_temperature_bits, sizeof(float));
+    iterator->remaining--;
+    return true;
+}
+
+bool range_codec_decode(const uint8_t* data, size_t size, int count, double* times_out, float* temperatures_out)
+{
+    range_codec_iterator_t iterator;
+    range_codec_iterator_init(&iterator, data, size, count);
+    for(int i = 0; i < count; i++)
+    {
+        if(!range_codec_iterator_next(&iterator, &times_out[i], &temperatures_out[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
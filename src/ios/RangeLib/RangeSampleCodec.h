@@ -0,0 +1,75 @@
+//
+//  RangeSampleCodec.h
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RangeSampleCodec_h
+#define RangeSampleCodec_h
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ Lossless compression for runs of samples, in the style of Facebook's Gorilla.
+
+ Timestamps are stored as the difference between consecutive differences ("delta of delta").
+ A Range samples at a steady rate, so that is usually zero or close to it. The differences are
+ taken between the bit patterns of the doubles, not their values: for timestamps that share an
+ exponent (any two times within a few years of each other) the bit pattern grows linearly with
+ the value, so this is exact and still gives small numbers.
+
+ Temperatures are XORed with the one before. Equal temperatures cost a single bit and
+ close ones only store the bits in the middle that changed.
+ */
+
+/*
+ Compresses count samples. *data_out is malloced and owned by the caller.
+ Returns false if we ran out of memory.
+ */
+bool range_codec_encode(const double* times, const float* temperatures, int count,
+                        uint8_t** data_out, size_t* size_out);
+
+typedef struct {
+    const uint8_t*  data;
+    size_t          size;
+    size_t          bit_position;
+    int             remaining;
+    bool            started;
+    int64_t         previous_time_bits;
+    int64_t         previous_delta;
+    uint32_t        previous_temperature_bits;
+    int             leading_zeros;
+    int             trailing_zeros;
+} range_codec_iterator_t;
+
+/*
+ Starts decoding count samples from data.
+ */
+void range_codec_iterator_init(range_codec_iterator_t* iterator, const uint8_t* data, size_t size, int count);
+
+/*
+ Decodes the next sample. Returns false when there are no more (or the data is cut short).
+ */
+bool range_codec_iterator_next(range_codec_iterator_t* iterator, double* time_out, float* temperature_out);
+
+/*
+ Decodes count samples straight into two arrays. Returns false if the data is cut short.
+ */
+bool range_codec_decode(const uint8_t* data, size_t size, int count, double* times_out, float* temperatures_out);
+
+#endif /* RangeSampleCodec_h */
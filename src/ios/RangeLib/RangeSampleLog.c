@@ -0,0 +1,756 @@
+//
+//  RangeSampleLog.c
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// ftruncate, pread and pwrite, for strict C builds.
+#define _POSIX_C_SOURCE 200809L
+
+#include "RangeSampleLog.h"
+
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define RL_FILE_MAGIC           0x474F4C52u   // "RLOG"
+#define RL_BLOCK_MAGIC          0x4B4C4252u   // "RBLK"
+#define RL_FILE_VERSION         1
+#define RL_UID_MAX_LENGTH       64
+
+// Everything is aligned to 16K so the blocks can be mapped on their own with any iOS page size.
+#define RL_ALIGNMENT            16384
+#define RL_HEADER_SIZE          RL_ALIGNMENT
+#define RL_TIMES_SIZE           (sizeof(double) * RANGE_STORE_CHUNK_CAPACITY)
+#define RL_TEMPERATURES_SIZE    (sizeof(float) * RANGE_STORE_CHUNK_CAPACITY)
+#define RL_FOOTER_OFFSET        (RL_TIMES_SIZE + RL_TEMPERATURES_SIZE)
+#define RL_BLOCK_SIZE           (RL_FOOTER_OFFSET + RL_ALIGNMENT)
+
+typedef struct {
+    uint32_t    magic;
+    uint32_t    version;
+    uint32_t    chunk_capacity;
+    uint32_t    block_size;
+    char        uid[RL_UID_MAX_LENGTH];
+    // Chunks with a lower index were dropped (see range_log_drop_front). Store chunk 0 is this one.
+    uint32_t    first_chunk;
+    // CRC32 of everything above.
+    uint32_t    crc;
+} rl_header_t;
+
+typedef struct {
+    uint32_t    magic;
+    // Which chunk the block holds, counting the dropped ones.
+    uint32_t    chunk_index;
+    // Higher wins when several blocks hold the same chunk.
+    uint64_t    sequence;
+    uint32_t    count;
+    // CRC32 of the first count timestamps followed by the first count temperatures.
+    uint32_t    crc;
+} rl_footer_t;
+
+struct range_log {
+    int         fd;
+    char        uid[RL_UID_MAX_LENGTH];
+    // Number of blocks in the file.
+    int         block_count;
+    uint64_t    next_sequence;
+    uint32_t    first_chunk;
+    // The header on disk may still name an older first_chunk. Blocks of the chunks in between
+    // must not be written over until it doesn't (see rl_sync_header).
+    bool        header_pending;
+    // Blocks that hold nothing we need. Reused before the file is made any bigger.
+    int*        free_blocks;
+    int         free_block_count;
+    int         free_blocks_size;
+    // Chunks the store gave up on. Their blocks become free once no frozen copy has them mapped.
+    range_chunk_t** retired;
+    int         retired_count;
+    int         retired_size;
+    // Block number in the file of every store chunk handed out. Used to find the footers.
+    int*        chunk_blocks;
+    int         chunk_blocks_size;
+    // Footers of the blocks in chunk_blocks, mapped for as long as the log is open.
+    rl_footer_t** footers;
+};
+
+#pragma mark - crc
+
+static uint32_t rl_crc_table[256];
+// Logs of different Ranges can be opened on different threads.
+static pthread_once_t rl_crc_table_once = PTHREAD_ONCE_INIT;
+
+static void rl_crc_fill_table(void)
+{
+    for(uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t c = i;
+        for(int k = 0; k < 8; k++)
+        {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        rl_crc_table[i] = c;
+    }
+}
+
+static void rl_crc_init_table(void)
+{
+    pthread_once(&rl_crc_table_once, rl_crc_fill_table);
+}
+
+static uint32_t rl_crc32(uint32_t crc, const void* data, size_t length)
+{
+    const unsigned char* bytes = data;
+    crc = ~crc;
+    for(size_t i = 0; i < length; i++)
+    {
+        crc = rl_crc_table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static uint32_t rl_block_crc(const unsigned char* block, uint32_t count)
+{
+    uint32_t crc = rl_crc32(0, block, sizeof(double) * count);
+    return rl_crc32(crc, block + RL_TIMES_SIZE, sizeof(float) * count);
+}
+
+#pragma mark - blocks
+
+static off_t rl_block_offset(int block_number)
+{
+    return (off_t)RL_HEADER_SIZE + (off_t)block_number * (off_t)RL_BLOCK_SIZE;
+}
+
+static unsigned char* rl_map_block(range_log_t* log, int block_number)
+{
+    void* mapping = mmap(NULL, RL_BLOCK_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, log->fd, rl_block_offset(block_number));
+    return mapping == MAP_FAILED ? NULL : mapping;
+}
+
+static rl_footer_t* rl_map_footer(range_log_t* log, int block_number)
+{
+    void* mapping = mmap(NULL, RL_ALIGNMENT, PROT_READ | PROT_WRITE, MAP_SHARED, log->fd,
+                         rl_block_offset(block_number) + (off_t)RL_FOOTER_OFFSET);
+    return mapping == MAP_FAILED ? NULL : mapping;
+}
+
+static bool rl_remember_chunk(range_log_t* log, int chunk_index, int block_number)
+{
+    if(chunk_index >= log->chunk_blocks_size)
+    {
+        int new_size = log->chunk_blocks_size ? log->chunk_blocks_size * 2 : 16;
+        while(new_size <= chunk_index)
+        {
+            new_size *= 2;
+        }
+        int* new_blocks = realloc(log->chunk_blocks, sizeof(int) * new_size);
+        if(new_blocks == NULL)
+        {
+            return false;
+        }
+        log->chunk_blocks = new_blocks;
+
+        rl_footer_t** new_footers = realloc(log->footers, sizeof(rl_footer_t*) * new_size);
+        if(new_footers == NULL)
+        {
+            return false;
+        }
+        memset(new_footers + log->chunk_blocks_size, 0, sizeof(rl_footer_t*) * (new_size - log->chunk_blocks_size));
+        log->footers = new_footers;
+        log->chunk_blocks_size = new_size;
+    }
+
+    rl_footer_t* footer = rl_map_footer(log, block_number);
+    if(footer == NULL)
+    {
+        return false;
+    }
+    if(log->footers[chunk_index] != NULL)
+    {
+        munmap(log->footers[chunk_index], RL_ALIGNMENT);
+    }
+    log->footers[chunk_index] = footer;
+    log->chunk_blocks[chunk_index] = block_number;
+    return true;
+}
+
+static range_chunk_t* rl_wrap_block(unsigned char* block, int block_number)
+{
+    range_chunk_t* chunk = range_store_wrap_chunk((double*)block, (float*)(block + RL_TIMES_SIZE), block, RL_BLOCK_SIZE);
+    if(chunk == NULL)
+    {
+        munmap(block, RL_BLOCK_SIZE);
+        return NULL;
+    }
+    chunk->mapping_offset = (long long)rl_block_offset(block_number);
+    return chunk;
+}
+
+static int rl_block_number(const range_chunk_t* chunk)
+{
+    return (int)((chunk->mapping_offset - RL_HEADER_SIZE) / (long long)RL_BLOCK_SIZE);
+}
+
+static bool rl_free_block(range_log_t* log, int block_number)
+{
+    if(log->free_block_count == log->free_blocks_size)
+    {
+        int new_size = log->free_blocks_size ? log->free_blocks_size * 2 : 16;
+        int* new_blocks = realloc(log->free_blocks, sizeof(int) * new_size);
+        if(new_blocks == NULL)
+        {
+            // The block is just never reused.
+            return false;
+        }
+        log->free_blocks = new_blocks;
+        log->free_blocks_size = new_size;
+    }
+    log->free_blocks[log->free_block_count++] = block_number;
+    return true;
+}
+
+// range_chunk_allocator_t retire_chunk for stores backed by a log.
+static void rl_retire_chunk(void* context, range_chunk_t* chunk)
+{
+    range_log_t* log = context;
+    if(log->retired_count == log->retired_size)
+    {
+        int new_size = log->retired_size ? log->retired_size * 2 : 16;
+        range_chunk_t** new_retired = realloc(log->retired, sizeof(range_chunk_t*) * new_size);
+        if(new_retired == NULL)
+        {
+            range_store_release_chunk(chunk);
+            return;
+        }
+        log->retired = new_retired;
+        log->retired_size = new_size;
+    }
+    log->retired[log->retired_count++] = chunk;
+}
+
+// Frees the blocks of retired chunks that only we hold on to now.
+static void rl_reap_retired(range_log_t* log)
+{
+    int kept = 0;
+    for(int i = 0; i < log->retired_count; i++)
+    {
+        range_chunk_t* chunk = log->retired[i];
+        if(atomic_load_explicit(&chunk->ref_count, memory_order_acquire) == 1)
+        {
+            int block_number = rl_block_number(chunk);
+            range_store_release_chunk(chunk);
+            rl_free_block(log, block_number);
+        } else {
+            log->retired[kept++] = chunk;
+        }
+    }
+    log->retired_count = kept;
+}
+
+// range_chunk_allocator_t for stores backed by a log. Every chunk is a new block at the end of the file.
+static range_chunk_t* rl_create_chunk(void* context, int chunk_index)
+{
+    range_log_t* log = context;
+    bool reused = log->free_block_count > 0;
+    int block_number = reused ? log->free_blocks[log->free_block_count - 1] : log->block_count;
+
+    if(!reused && ftruncate(log->fd, rl_block_offset(block_number + 1)) != 0)
+    {
+        return NULL;
+    }
+
+    unsigned char* block = rl_map_block(log, block_number);
+    if(block == NULL)
+    {
+        return NULL;
+    }
+    if(reused)
+    {
+        log->free_block_count--;
+    } else {
+        log->block_count++;
+    }
+
+    rl_footer_t* footer = (rl_footer_t*)(block + RL_FOOTER_OFFSET);
+    footer->magic = RL_BLOCK_MAGIC;
+    footer->chunk_index = log->first_chunk + (uint32_t)chunk_index;
+    footer->sequence = log->next_sequence++;
+    footer->count = 0;
+    footer->crc = rl_block_crc(block, 0);
+
+    if(!rl_remember_chunk(log, chunk_index, block_number))
+    {
+        munmap(block, RL_BLOCK_SIZE);
+        return NULL;
+    }
+    return rl_wrap_block(block, block_number);
+}
+
+#pragma mark - opening
+
+static bool rl_header_valid(const rl_header_t* header, const char* uid)
+{
+    return header->magic == RL_FILE_MAGIC &&
+           header->version == RL_FILE_VERSION &&
+           header->chunk_capacity == RANGE_STORE_CHUNK_CAPACITY &&
+           header->block_size == RL_BLOCK_SIZE &&
+           strncmp(header->uid, uid, RL_UID_MAX_LENGTH) == 0 &&
+           header->crc == rl_crc32(0, header, offsetof(rl_header_t, crc));
+}
+
+static bool rl_write_header(int fd, const char* uid, uint32_t first_chunk)
+{
+    rl_header_t header;
+    memset(&header, 0, sizeof(header));
+    header.magic = RL_FILE_MAGIC;
+    header.version = RL_FILE_VERSION;
+    header.chunk_capacity = RANGE_STORE_CHUNK_CAPACITY;
+    header.block_size = RL_BLOCK_SIZE;
+    strncpy(header.uid, uid, RL_UID_MAX_LENGTH - 1);
+    header.first_chunk = first_chunk;
+    header.crc = rl_crc32(0, &header, offsetof(rl_header_t, crc));
+
+    return pwrite(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header);
+}
+
+// Gets first_chunk onto the disk. Returns false if the header there may still be older.
+static bool rl_sync_header(range_log_t* log)
+{
+    if(log->header_pending && rl_write_header(log->fd, log->uid, log->first_chunk) && fsync(log->fd) == 0)
+    {
+        log->header_pending = false;
+    }
+    return !log->header_pending;
+}
+
+static int rl_compare_uint32(const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Which chunk to load first. Normally the header's first_chunk. Files written before drops were
+// synced can have a header that names chunks whose blocks have since been reused. Then every
+// chunk from the header's first one is gone or out of order, so start at the last unbroken run.
+static uint32_t rl_find_first_chunk(range_log_t* log)
+{
+    uint32_t* indexes = malloc(sizeof(uint32_t) * (log->block_count + 1));
+    if(indexes == NULL)
+    {
+        return log->first_chunk;
+    }
+
+    int count = 0;
+    for(int i = 0; i < log->block_count; i++)
+    {
+        rl_footer_t footer;
+        if(pread(log->fd, &footer, sizeof(footer), rl_block_offset(i) + (off_t)RL_FOOTER_OFFSET) == (ssize_t)sizeof(footer) &&
+           footer.magic == RL_BLOCK_MAGIC && footer.chunk_index >= log->first_chunk && footer.count <= RANGE_STORE_CHUNK_CAPACITY)
+        {
+            indexes[count++] = footer.chunk_index;
+        }
+    }
+    qsort(indexes, count, sizeof(uint32_t), rl_compare_uint32);
+
+    uint32_t first_chunk = log->first_chunk;
+    if(count > 0 && indexes[0] != log->first_chunk)
+    {
+        int start = count - 1;
+        while(start > 0 && indexes[start - 1] + 1 >= indexes[start])
+        {
+            start--;
+        }
+        first_chunk = indexes[start];
+    }
+    free(indexes);
+    return first_chunk;
+}
+
+// For the tail block whose footer doesn't check out (the app died in the middle of a sync):
+// keep the samples the footer counted, as far as they still follow on from each other.
+static uint32_t rl_recover_tail(const unsigned char* block, const rl_footer_t* footer, double previous_time)
+{
+    const double* times = (const double*)block;
+    uint32_t count = 0;
+    while(count < footer->count && count < RANGE_STORE_CHUNK_CAPACITY && times[count] > previous_time)
+    {
+        previous_time = times[count];
+        count++;
+    }
+    return count;
+}
+
+// Which of two blocks holding the same chunk wins. A merge never takes samples away, so a copy
+// with fewer samples is one whose footer was never synced (the app died before it was). Among
+// copies with the same count the newest wins.
+static bool rl_block_beats(uint32_t count, uint64_t sequence, uint32_t other_count, uint64_t other_sequence)
+{
+    return count > other_count || (count == other_count && sequence > other_sequence);
+}
+
+// A block that replaced an older one didn't check out (or doesn't follow on from the chunk before it).
+// Find the best older copy of the chunk (that loses to below_count, below_sequence) that does.
+static unsigned char* rl_map_fallback(range_log_t* log, int chunk_index, uint32_t below_count, uint64_t below_sequence,
+                                      double previous_time, int* block_number_out, uint32_t* count_out)
+{
+    for(;;)
+    {
+        int best = -1;
+        uint32_t best_count = 0;
+        uint64_t best_sequence = 0;
+        for(int i = 0; i < log->block_count; i++)
+        {
+            rl_footer_t footer;
+            if(pread(log->fd, &footer, sizeof(footer), rl_block_offset(i) + (off_t)RL_FOOTER_OFFSET) == (ssize_t)sizeof(footer) &&
+               footer.magic == RL_BLOCK_MAGIC &&
+               footer.chunk_index == log->first_chunk + (uint32_t)chunk_index &&
+               footer.count > 0 && footer.count <= RANGE_STORE_CHUNK_CAPACITY &&
+               rl_block_beats(below_count, below_sequence, footer.count, footer.sequence) &&
+               (best < 0 || rl_block_beats(footer.count, footer.sequence, best_count, best_sequence)))
+            {
+                best = i;
+                best_count = footer.count;
+                best_sequence = footer.sequence;
+            }
+        }
+        if(best < 0)
+        {
+            return NULL;
+        }
+
+        unsigned char* block = rl_map_block(log, best);
+        if(block == NULL)
+        {
+            return NULL;
+        }
+        rl_footer_t* footer = (rl_footer_t*)(block + RL_FOOTER_OFFSET);
+        if(((const double*)block)[0] > previous_time && footer->crc == rl_block_crc(block, footer->count))
+        {
+            *block_number_out = best;
+            *count_out = footer->count;
+            return block;
+        }
+        munmap(block, RL_BLOCK_SIZE);
+        below_count = best_count;
+        below_sequence = best_sequence;
+    }
+}
+
+range_log_t* range_log_open(const char* path, const char* uid, range_store_t* store)
+{
+    if(strlen(uid) >= RL_UID_MAX_LENGTH || store->length != 0 || (RL_ALIGNMENT % sysconf(_SC_PAGESIZE)) != 0)
+    {
+        return NULL;
+    }
+    rl_crc_init_table();
+
+    range_log_t* log = calloc(1, sizeof(range_log_t));
+    if(log == NULL)
+    {
+        return NULL;
+    }
+
+    log->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if(log->fd < 0)
+    {
+        free(log);
+        return NULL;
+    }
+
+    struct stat fileStat;
+    rl_header_t header;
+    bool valid = fstat(log->fd, &fileStat) == 0;
+    if(valid && fileStat.st_size < RL_HEADER_SIZE)
+    {
+        // New (or never finished) file.
+        valid = ftruncate(log->fd, RL_HEADER_SIZE) == 0 && rl_write_header(log->fd, uid, 0) && fsync(log->fd) == 0;
+        fileStat.st_size = RL_HEADER_SIZE;
+    }
+    else if(valid)
+    {
+        valid = pread(log->fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) && rl_header_valid(&header, uid);
+        log->first_chunk = valid ? header.first_chunk : 0;
+    }
+    strncpy(log->uid, uid, RL_UID_MAX_LENGTH - 1);
+    if(!valid)
+    {
+        close(log->fd);
+        free(log);
+        return NULL;
+    }
+
+    // A block that was being added when the app died may be cut short. It has nothing we trust.
+    log->block_count = (int)((fileStat.st_size - RL_HEADER_SIZE) / RL_BLOCK_SIZE);
+
+    uint32_t first_chunk = rl_find_first_chunk(log);
+    log->header_pending = first_chunk != log->first_chunk;
+    log->first_chunk = first_chunk;
+
+    // Pick the best block of every chunk (see rl_block_beats), and remember whether there was more than one.
+    int chunk_count = 0;
+    int* winners = malloc(sizeof(int) * (log->block_count + 1));
+    uint32_t* counts = malloc(sizeof(uint32_t) * (log->block_count + 1));
+    uint64_t* sequences = malloc(sizeof(uint64_t) * (log->block_count + 1));
+    bool* replaced = calloc(log->block_count + 1, sizeof(bool));
+    valid = winners != NULL && counts != NULL && sequences != NULL && replaced != NULL;
+
+    for(int i = 0; valid && i < log->block_count; i++)
+    {
+        rl_footer_t footer;
+        if(pread(log->fd, &footer, sizeof(footer), rl_block_offset(i) + (off_t)RL_FOOTER_OFFSET) != (ssize_t)sizeof(footer) ||
+           footer.magic != RL_BLOCK_MAGIC)
+        {
+            continue;
+        }
+        if(footer.sequence >= log->next_sequence)
+        {
+            log->next_sequence = footer.sequence + 1;
+        }
+        if(footer.chunk_index < log->first_chunk ||
+           footer.chunk_index - log->first_chunk >= (uint32_t)log->block_count ||
+           footer.count > RANGE_STORE_CHUNK_CAPACITY)
+        {
+            // Dropped, or not something we wrote.
+            continue;
+        }
+
+        int chunk_index = (int)(footer.chunk_index - log->first_chunk);
+        while(chunk_count <= chunk_index)
+        {
+            winners[chunk_count++] = -1;
+        }
+        if(winners[chunk_index] >= 0)
+        {
+            replaced[chunk_index] = true;
+        }
+        if(winners[chunk_index] < 0 || rl_block_beats(footer.count, footer.sequence, counts[chunk_index], sequences[chunk_index]))
+        {
+            winners[chunk_index] = i;
+            counts[chunk_index] = footer.count;
+            sequences[chunk_index] = footer.sequence;
+        }
+    }
+
+    // Hand the winning blocks to the store. Stop at the first chunk we can't vouch for.
+    double previous_time = -INFINITY;
+    for(int chunk_index = 0; valid && chunk_index < chunk_count; chunk_index++)
+    {
+        if(winners[chunk_index] < 0)
+        {
+            break;
+        }
+
+        int block_number = winners[chunk_index];
+        unsigned char* block = rl_map_block(log, block_number);
+        if(block == NULL)
+        {
+            break;
+        }
+
+        rl_footer_t* footer = (rl_footer_t*)(block + RL_FOOTER_OFFSET);
+        bool is_tail = (chunk_index == chunk_count - 1) || footer->count < RANGE_STORE_CHUNK_CAPACITY;
+        bool follows_on = footer->count == 0 || ((const double*)block)[0] > previous_time;
+        bool crc_valid = !(is_tail || replaced[chunk_index]) || footer->crc == rl_block_crc(block, footer->count);
+        uint32_t count = footer->count;
+
+        if(!follows_on || !crc_valid)
+        {
+            unsigned char* fallback = replaced[chunk_index] ?
+                rl_map_fallback(log, chunk_index, counts[chunk_index], sequences[chunk_index], previous_time,
+                                &block_number, &count) : NULL;
+            if(fallback != NULL)
+            {
+                munmap(block, RL_BLOCK_SIZE);
+                block = fallback;
+            }
+            else if(is_tail && follows_on)
+            {
+                // The app died during a sync. Record what we kept so we don't have to do this again.
+                count = rl_recover_tail(block, footer, previous_time);
+                footer->count = count;
+                footer->crc = rl_block_crc(block, count);
+            } else {
+                count = 0;
+            }
+        }
+
+        range_chunk_t* chunk = count > 0 ? rl_wrap_block(block, block_number) : NULL;
+        if(chunk == NULL)
+        {
+            if(count == 0)
+            {
+                munmap(block, RL_BLOCK_SIZE);
+            }
+            break;
+        }
+        chunk->synced_count = (int)count;
+        if(!range_store_adopt_chunk(store, chunk, (int)count) || !rl_remember_chunk(log, chunk_index, block_number))
+        {
+            valid = false;
+            break;
+        }
+        previous_time = ((const double*)block)[count - 1];
+
+        if(count < RANGE_STORE_CHUNK_CAPACITY)
+        {
+            // Anything after a partial chunk can't be trusted to follow on from it.
+            break;
+        }
+    }
+
+    // Every block the store didn't take can be written over, once the header no longer names any of them.
+    bool* in_use = valid && rl_sync_header(log) ? calloc(log->block_count + 1, sizeof(bool)) : NULL;
+    if(in_use != NULL)
+    {
+        for(int i = 0; i < store->chunk_count; i++)
+        {
+            in_use[log->chunk_blocks[i]] = true;
+        }
+        for(int i = log->block_count - 1; i >= 0; i--)
+        {
+            if(!in_use[i])
+            {
+                rl_free_block(log, i);
+            }
+        }
+    }
+
+    free(in_use);
+    free(winners);
+    free(counts);
+    free(sequences);
+    free(replaced);
+
+    if(!valid)
+    {
+        range_store_destroy(store);
+        range_log_close(log);
+        return NULL;
+    }
+
+    range_store_clear_dirty(store);
+    store->allocator.create_chunk = rl_create_chunk;
+    store->allocator.retire_chunk = rl_retire_chunk;
+    store->allocator.context = log;
+    return log;
+}
+
+void range_log_close(range_log_t* log)
+{
+    if(log == NULL)
+    {
+        return;
+    }
+
+    for(int i = 0; i < log->chunk_blocks_size; i++)
+    {
+        if(log->footers[i] != NULL)
+        {
+            msync(log->footers[i], RL_ALIGNMENT, MS_ASYNC);
+            munmap(log->footers[i], RL_ALIGNMENT);
+        }
+    }
+    for(int i = 0; i < log->retired_count; i++)
+    {
+        range_store_release_chunk(log->retired[i]);
+    }
+    free(log->retired);
+    free(log->free_blocks);
+    free(log->footers);
+    free(log->chunk_blocks);
+    close(log->fd);
+    free(log);
+}
+
+bool range_log_sync(range_log_t* log, range_store_t* store)
+{
+    bool success = true;
+    for(int chunk_index = store->dirty_from / RANGE_STORE_CHUNK_CAPACITY; chunk_index < store->chunk_count; chunk_index++)
+    {
+        range_chunk_t* chunk = store->chunks[chunk_index];
+        if(chunk->mapping == NULL || chunk_index >= log->chunk_blocks_size || log->footers[chunk_index] == NULL)
+        {
+            success = false;
+            continue;
+        }
+
+        uint32_t count = (uint32_t)range_store_chunk_length(store, chunk_index);
+        rl_footer_t* footer = log->footers[chunk_index];
+
+        // Samples first, then the footer that vouches for them. MS_ASYNC would let the OS write
+        // them in either order. The footer has to be on disk too before rl_reap_retired lets the
+        // block it replaced be written over.
+        if(msync(chunk->mapping, RL_FOOTER_OFFSET, MS_SYNC) != 0)
+        {
+            success = false;
+            continue;
+        }
+        footer->crc = rl_block_crc(chunk->mapping, count);
+        footer->count = count;
+        if(msync(footer, RL_ALIGNMENT, MS_SYNC) != 0)
+        {
+            success = false;
+            continue;
+        }
+        chunk->synced_count = (int)count;
+    }
+
+    // Try again next time rather than let a block the file may still need be written over.
+    success = rl_sync_header(log) && success;
+    if(success)
+    {
+        range_store_clear_dirty(store);
+        rl_reap_retired(log);
+    }
+    return success;
+}
+
+int range_log_drop_front(range_log_t* log, range_store_t* store, int chunk_count)
+{
+    int dropped = range_store_drop_front(store, chunk_count);
+    if(dropped <= 0)
+    {
+        return 0;
+    }
+
+    for(int i = 0; i < dropped; i++)
+    {
+        if(log->footers[i] != NULL)
+        {
+            munmap(log->footers[i], RL_ALIGNMENT);
+        }
+    }
+    int remaining = log->chunk_blocks_size - dropped;
+    memmove(log->chunk_blocks, log->chunk_blocks + dropped, sizeof(int) * remaining);
+    memmove(log->footers, log->footers + dropped, sizeof(rl_footer_t*) * remaining);
+    memset(log->footers + remaining, 0, sizeof(rl_footer_t*) * dropped);
+
+    // The dropped chunks are retired. Their blocks are only reused after a sync that got this header
+    // onto the disk (see range_log_sync). Until then a reopen just loads them again.
+    log->first_chunk += (uint32_t)dropped;
+    log->header_pending = true;
+    rl_sync_header(log);
+    return dropped;
+}
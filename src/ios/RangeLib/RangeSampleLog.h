@@ -0,0 +1,89 @@
+//
+//  RangeSampleLog.h
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RangeSampleLog_h
+#define RangeSampleLog_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "RangeSampleStore.h"
+
+/*
+ Append only on-disk segment holding the samples of one Range uid.
+
+ The file starts with a header block, followed by sample blocks. A sample block is laid out
+ exactly like a store chunk (RANGE_STORE_CHUNK_CAPACITY timestamps, then as many temperatures)
+ followed by a footer page, and every block is page aligned. Each block is memory mapped on
+ its own and handed to the store as a chunk, so the store reads and writes the file directly.
+ Opening a file only reads the footers; sample pages are read in by the OS as they are touched.
+
+ Blocks are never rewritten in place once a frozen copy may be reading them, or once a sync has
+ vouched for the samples being rewritten; samples can only be added after those.
+ Blocks that are no longer needed (dropped or replaced) are reused once nobody has them mapped,
+ so a store that drops old chunks as fast as it adds new ones keeps the file the same size.
+ When the store rewrites an older chunk (an out of order merge) the log hands out a brand new
+ block at the end of the file for the same chunk, with a higher sequence number. When the file is
+ opened again the block with the most samples wins for every chunk, and of those the one with the
+ highest sequence number. A replacement that was never synced says it has no samples, so it loses.
+
+ The footer holds the number of samples in the block and a CRC32 of them. It is updated by
+ range_log_sync. Blocks are only ever full once they stop being the last one and vouched for
+ samples are never rewritten, so on open only the tail block and blocks that replaced older
+ ones have their CRC checked. If that fails we fall
+ back on an older copy of the block or, for the tail, keep the samples up to the last sync that checks out.
+
+ Samples appended after the last range_log_sync are in the file (the OS has them even if the app is killed)
+ but will only be trusted once a sync has recorded them.
+ */
+
+#define RANGE_LOG_FILE_EXTENSION "rangelog"
+
+typedef struct range_log range_log_t;
+
+/*
+ Opens (creating it if needed) the segment at path for uid and loads it into store.
+ store must be empty. From then on new chunks of store come from the file.
+ Returns NULL if the file can't be used (the store is left empty).
+ */
+range_log_t* range_log_open(const char* path, const char* uid, range_store_t* store);
+
+/*
+ Closes the file. Chunks already handed out stay mapped until they are released.
+ The store must not get any new chunks after this.
+ */
+void range_log_close(range_log_t* log);
+
+/*
+ Drops the first chunk_count chunks of store (see range_store_drop_front) and records that in the file.
+ Their blocks are reused for new chunks once no frozen copy is reading them and a range_log_sync
+ has made sure the file no longer names them. Waits on the disk.
+ Returns the number of chunks dropped.
+ */
+int range_log_drop_front(range_log_t* log, range_store_t* store, int chunk_count);
+
+/*
+ Writes the footers of every block store changed since the last sync, waiting for the OS to
+ write out the samples before each footer and the footer before a block it replaced is reused.
+ Blocks on the disk, so callers space it out (RangeDataManager syncs every few seconds).
+ Must be called on the thread that writes to store.
+ Returns false if the file could not be updated; the next sync tries again.
+ */
+bool range_log_sync(range_log_t* log, range_store_t* store);
+
+#endif /* RangeSampleLog_h */
@@ -0,0 +1,393 @@
+//
+//  RangeSamplePyramid.c
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "RangeSamplePyramid.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Bucket widths in seconds, finest first. Each one divides the next
+// so a rewind to a coarse bucket boundary is a boundary on every level.
+static const double rp_level_widths[RANGE_PYRAMID_LEVELS] = { 1.0, 10.0, 60.0, 600.0 };
+
+#pragma mark - blocks
+
+static range_pyramid_block_t* rp_block_create(void)
+{
+    range_pyramid_block_t* block = malloc(sizeof(range_pyramid_block_t));
+    if(block == NULL)
+    {
+        return NULL;
+    }
+    atomic_init(&block->ref_count, 1);
+    return block;
+}
+
+static void rp_block_release(range_pyramid_block_t* block)
+{
+    if(block == NULL)
+    {
+        return;
+    }
+
+    if(atomic_fetch_sub_explicit(&block->ref_count, 1, memory_order_acq_rel) == 1)
+    {
+        free(block);
+    }
+}
+
+static range_pyramid_bucket_t* rp_bucket_at(const range_pyramid_level_t* level, int index)
+{
+    return &(level->blocks[index / RANGE_PYRAMID_BLOCK_CAPACITY]->buckets[index % RANGE_PYRAMID_BLOCK_CAPACITY]);
+}
+
+// Before writing the bucket at index, make sure no frozen copy is reading the block it lives in.
+static bool rp_level_make_writable(range_pyramid_level_t* level, int index)
+{
+    if(index >= level->frozen_length)
+    {
+        return true;
+    }
+
+    int block_index = index / RANGE_PYRAMID_BLOCK_CAPACITY;
+    range_pyramid_block_t* block = level->blocks[block_index];
+    if(atomic_load_explicit(&block->ref_count, memory_order_acquire) == 1)
+    {
+        return true;
+    }
+
+    range_pyramid_block_t* copy = rp_block_create();
+    if(copy == NULL)
+    {
+        return false;
+    }
+    memcpy(copy->buckets, block->buckets, sizeof(copy->buckets));
+
+    level->blocks[block_index] = copy;
+    rp_block_release(block);
+    return true;
+}
+
+static bool rp_level_push(range_pyramid_level_t* level, int64_t slot, float temperature)
+{
+    int block_index = level->length / RANGE_PYRAMID_BLOCK_CAPACITY;
+    if(block_index >= level->block_count)
+    {
+        if(level->block_count == level->block_directory_size)
+        {
+            int new_size = level->block_directory_size ? level->block_directory_size * 2 : 4;
+            range_pyramid_block_t** new_blocks = realloc(level->blocks, sizeof(range_pyramid_block_t*) * new_size);
+            if(new_blocks == NULL)
+            {
+                return false;
+            }
+            level->blocks = new_blocks;
+            level->block_directory_size = new_size;
+        }
+
+        range_pyramid_block_t* block = rp_block_create();
+        if(block == NULL)
+        {
+            return false;
+        }
+        level->blocks[level->block_count++] = block;
+    }
+
+    if(!rp_level_make_writable(level, level->length))
+    {
+        return false;
+    }
+
+    range_pyramid_bucket_t* bucket = rp_bucket_at(level, level->length);
+    bucket->slot = slot;
+    bucket->min_temperature = temperature;
+    bucket->max_temperature = temperature;
+    bucket->sum = temperature;
+    bucket->count = 1;
+    level->length++;
+    return true;
+}
+
+// First bucket index with a slot >= slot.
+static int rp_level_lower_bound(const range_pyramid_level_t* level, int64_t slot)
+{
+    int low = 0;
+    int high = level->length;
+    while(low < high)
+    {
+        int mid = low + (high - low) / 2;
+        if(rp_bucket_at(level, mid)->slot < slot)
+        {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static int64_t rp_slot(const range_pyramid_level_t* level, double time)
+{
+    return (int64_t)floor(time / level->width);
+}
+
+static void rp_write_bucket(range_bucket_t* output, const range_pyramid_level_t* level,
+                            const range_pyramid_bucket_t* first, const range_pyramid_bucket_t* last,
+                            float min_temperature, float max_temperature, double sum, int count)
+{
+    output->start_time = (double)first->slot * level->width;
+    output->stop_time = (double)(last->slot + 1) * level->width;
+    output->min_temperature = min_temperature;
+    output->max_temperature = max_temperature;
+    output->mean_temperature = (float)(sum / count);
+    output->count = count;
+}
+
+#pragma mark - pyramid
+
+void range_pyramid_init(range_pyramid_t* pyramid)
+{
+    memset(pyramid, 0, sizeof(range_pyramid_t));
+    for(int i = 0; i < RANGE_PYRAMID_LEVELS; i++)
+    {
+        pyramid->levels[i].width = rp_level_widths[i];
+    }
+}
+
+void range_pyramid_destroy(range_pyramid_t* pyramid)
+{
+    for(int i = 0; i < RANGE_PYRAMID_LEVELS; i++)
+    {
+        range_pyramid_level_t* level = &(pyramid->levels[i]);
+        for(int j = 0; j < level->block_count; j++)
+        {
+            rp_block_release(level->blocks[j]);
+        }
+        free(level->blocks);
+    }
+    range_pyramid_init(pyramid);
+}
+
+bool range_pyramid_init_frozen_copy(range_pyramid_t* copy, range_pyramid_t* source)
+{
+    range_pyramid_init(copy);
+
+    for(int i = 0; i < RANGE_PYRAMID_LEVELS; i++)
+    {
+        range_pyramid_level_t* from = &(source->levels[i]);
+        range_pyramid_level_t* to = &(copy->levels[i]);
+
+        int block_count = (from->length + RANGE_PYRAMID_BLOCK_CAPACITY - 1) / RANGE_PYRAMID_BLOCK_CAPACITY;
+        if(block_count == 0)
+        {
+            continue;
+        }
+
+        to->blocks = malloc(sizeof(range_pyramid_block_t*) * block_count);
+        if(to->blocks == NULL)
+        {
+            range_pyramid_destroy(copy);
+            return false;
+        }
+
+        for(int j = 0; j < block_count; j++)
+        {
+            atomic_fetch_add_explicit(&from->blocks[j]->ref_count, 1, memory_order_relaxed);
+            to->blocks[j] = from->blocks[j];
+        }
+        to->block_count = block_count;
+        to->block_directory_size = block_count;
+        to->length = from->length;
+        to->frozen_length = from->length;
+
+        // The last bucket is still being filled in, so it counts as seen too.
+        if(from->frozen_length < from->length)
+        {
+            from->frozen_length = from->length;
+        }
+    }
+    return true;
+}
+
+bool range_pyramid_add(range_pyramid_t* pyramid, double time, float temperature)
+{
+    for(int i = 0; i < RANGE_PYRAMID_LEVELS; i++)
+    {
+        range_pyramid_level_t* level = &(pyramid->levels[i]);
+        int64_t slot = rp_slot(level, time);
+
+        if(level->length == 0 || rp_bucket_at(level, level->length - 1)->slot != slot)
+        {
+            if(!rp_level_push(level, slot, temperature))
+            {
+                return false;
+            }
+            continue;
+        }
+
+        if(!rp_level_make_writable(level, level->length - 1))
+        {
+            return false;
+        }
+
+        range_pyramid_bucket_t* bucket = rp_bucket_at(level, level->length - 1);
+        if(temperature < bucket->min_temperature)
+        {
+            bucket->min_temperature = temperature;
+        }
+        if(temperature > bucket->max_temperature)
+        {
+            bucket->max_temperature = temperature;
+        }
+        bucket->sum += temperature;
+        bucket->count++;
+    }
+    return true;
+}
+
+double range_pyramid_rewind(range_pyramid_t* pyramid, double time)
+{
+    // Start of the coarsest bucket holding time. That is a bucket boundary on every level.
+    const range_pyramid_level_t* coarsest = &(pyramid->levels[RANGE_PYRAMID_LEVELS - 1]);
+    double resume_time = (double)rp_slot(coarsest, time) * coarsest->width;
+
+    for(int i = 0; i < RANGE_PYRAMID_LEVELS; i++)
+    {
+        range_pyramid_level_t* level = &(pyramid->levels[i]);
+        level->length = rp_level_lower_bound(level, rp_slot(level, resume_time));
+    }
+    return resume_time;
+}
+
+double range_pyramid_sealed_after(const range_pyramid_t* pyramid, double time)
+{
+    const range_pyramid_level_t* coarsest = &(pyramid->levels[RANGE_PYRAMID_LEVELS - 1]);
+    return (double)(rp_slot(coarsest, time) + 1) * coarsest->width;
+}
+
+int range_pyramid_drop_before(range_pyramid_t* pyramid, double time, int max_blocks)
+{
+    int dropped = 0;
+    for(int i = 0; i < RANGE_PYRAMID_LEVELS && dropped < max_blocks; i++)
+    {
+        range_pyramid_level_t* level = &(pyramid->levels[i]);
+
+        // Only full blocks that are not the last one, so the bucket being filled in never goes.
+        int block_count = 0;
+        int full_blocks = (level->length - 1) / RANGE_PYRAMID_BLOCK_CAPACITY;
+        while(block_count < full_blocks && dropped + block_count < max_blocks)
+        {
+            const range_pyramid_bucket_t* last = &(level->blocks[block_count]->buckets[RANGE_PYRAMID_BLOCK_CAPACITY - 1]);
+            if((double)(last->slot + 1) * level->width > time)
+            {
+                break;
+            }
+            block_count++;
+        }
+        if(block_count == 0)
+        {
+            continue;
+        }
+
+        for(int j = 0; j < block_count; j++)
+        {
+            rp_block_release(level->blocks[j]);
+        }
+        memmove(level->blocks, level->blocks + block_count, sizeof(range_pyramid_block_t*) * (level->block_count - block_count));
+        level->block_count -= block_count;
+
+        int removed = block_count * RANGE_PYRAMID_BLOCK_CAPACITY;
+        level->length -= removed;
+        level->frozen_length = level->frozen_length > removed ? level->frozen_length - removed : 0;
+        dropped += block_count;
+    }
+    return dropped;
+}
+
+size_t range_pyramid_memory_usage(const range_pyramid_t* pyramid)
+{
+    size_t output = 0;
+    for(int i = 0; i < RANGE_PYRAMID_LEVELS; i++)
+    {
+        output += (size_t)pyramid->levels[i].block_count * sizeof(range_pyramid_block_t);
+    }
+    return output;
+}
+
+int range_pyramid_query(const range_pyramid_t* pyramid, double start_time, double stop_time,
+                        int max_buckets, range_bucket_t* buckets_out)
+{
+    if(max_buckets <= 0 || stop_time < start_time)
+    {
+        return 0;
+    }
+
+    const range_pyramid_level_t* level = NULL;
+    int first = 0;
+    int end = 0;
+    for(int i = 0; i < RANGE_PYRAMID_LEVELS; i++)
+    {
+        level = &(pyramid->levels[i]);
+        first = rp_level_lower_bound(level, rp_slot(level, start_time));
+        end = rp_level_lower_bound(level, rp_slot(level, stop_time) + 1);
+        if(end - first <= max_buckets)
+        {
+            break;
+        }
+    }
+
+    int available = end - first;
+    if(available <= 0)
+    {
+        return 0;
+    }
+
+    // Combine neighbours on the coarsest level if it still has too many.
+    int group = (available + max_buckets - 1) / max_buckets;
+    int output_count = 0;
+    for(int index = first; index < end; index += group)
+    {
+        int group_end = index + group < end ? index + group : end;
+        const range_pyramid_bucket_t* first_bucket = rp_bucket_at(level, index);
+        float min_temperature = first_bucket->min_temperature;
+        float max_temperature = first_bucket->max_temperature;
+        double sum = first_bucket->sum;
+        int count = first_bucket->count;
+
+        for(int j = index + 1; j < group_end; j++)
+        {
+            const range_pyramid_bucket_t* bucket = rp_bucket_at(level, j);
+            if(bucket->min_temperature < min_temperature)
+            {
+                min_temperature = bucket->min_temperature;
+            }
+            if(bucket->max_temperature > max_temperature)
+            {
+                max_temperature = bucket->max_temperature;
+            }
+            sum += bucket->sum;
+            count += bucket->count;
+        }
+
+        rp_write_bucket(&buckets_out[output_count++], level, first_bucket, rp_bucket_at(level, group_end - 1),
+                        min_temperature, max_temperature, sum, count);
+    }
+    return output_count;
+}
@@ -0,0 +1,125 @@
+//
+//  RangeSamplePyramid.h
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RangeSamplePyramid_h
+#define RangeSamplePyramid_h
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "RangeTypes.h"
+
+/*
+ Downsampled copies of a RangeData for graphing long sessions.
+
+ Every level splits time into buckets of a fixed width (1s, 10s, 1min, 10min)
+ and keeps the min/max/sum/count of the samples in each. Buckets with no samples are not stored.
+ Samples are added in time order as they are appended to the RangeData, so only
+ the last bucket of each level ever changes.
+
+ Buckets live in blocks that are reference counted the same way as the store's chunks,
+ so a frozen copy can be read on another thread while the original keeps growing.
+
+ None of these functions lock.
+ */
+
+#define RANGE_PYRAMID_LEVELS 4
+#define RANGE_PYRAMID_BLOCK_CAPACITY 256
+
+typedef struct {
+    // floor(time / width) of the samples in this bucket.
+    int64_t     slot;
+    float       min_temperature;
+    float       max_temperature;
+    double      sum;
+    int         count;
+} range_pyramid_bucket_t;
+
+typedef struct {
+    range_pyramid_bucket_t  buckets[RANGE_PYRAMID_BLOCK_CAPACITY];
+    _Atomic int             ref_count;
+} range_pyramid_block_t;
+
+typedef struct {
+    double                  width;
+    range_pyramid_block_t** blocks;
+    int                     block_count;
+    int                     block_directory_size;
+    int                     length;
+    // Largest length any frozen copy of this level was made with.
+    int                     frozen_length;
+} range_pyramid_level_t;
+
+typedef struct {
+    range_pyramid_level_t   levels[RANGE_PYRAMID_LEVELS];
+} range_pyramid_t;
+
+void range_pyramid_init(range_pyramid_t* pyramid);
+void range_pyramid_destroy(range_pyramid_t* pyramid);
+
+/*
+ Makes copy a read only view of pyramid as it is right now. Blocks are shared, not copied.
+ Must be called on the thread that writes to pyramid.
+ Returns false if we ran out of memory.
+ */
+bool range_pyramid_init_frozen_copy(range_pyramid_t* copy, range_pyramid_t* source);
+
+/*
+ Folds one sample into every level. time must not be earlier than the last sample added.
+ Returns false if we ran out of memory.
+ */
+bool range_pyramid_add(range_pyramid_t* pyramid, double time, float temperature);
+
+/*
+ Forgets every bucket that could hold a sample at or after time.
+ Returns the time from which the samples have to be added again. Always <= time.
+ */
+double range_pyramid_rewind(range_pyramid_t* pyramid, double time);
+
+/*
+ End of the coarsest bucket holding time. Rewinding to any time from there on
+ leaves every bucket with samples at or before time alone.
+ */
+double range_pyramid_sealed_after(const range_pyramid_t* pyramid, double time);
+
+/*
+ Forgets buckets that end at or before time, a whole block at a time, dropping at most max_blocks blocks
+ (over all levels). Blocks with room left, or that a frozen copy is reading, are handled the same way:
+ copies keep the blocks they have.
+ Returns the number of blocks dropped.
+ */
+int range_pyramid_drop_before(range_pyramid_t* pyramid, double time, int max_blocks);
+
+/*
+ Number of bytes held in blocks, including ones shared with frozen copies.
+ */
+size_t range_pyramid_memory_usage(const range_pyramid_t* pyramid);
+
+/*
+ Summarizes [start_time, stop_time] into at most max_buckets buckets.
+ Uses the finest level that fits. If even the coarsest level has too many buckets,
+ neighbouring buckets are combined. The first and last bucket may cover a little
+ time outside the window, as buckets are never split.
+ Returns the number of buckets written to buckets_out.
+ */
+int range_pyramid_query(const range_pyramid_t* pyramid, double start_time, double stop_time,
+                        int max_buckets, range_bucket_t* buckets_out);
+
+#endif /* RangeSamplePyramid_h */
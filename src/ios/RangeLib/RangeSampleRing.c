@@ -0,0 +1,112 @@
+//
+//  RangeSampleRing.c
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "RangeSampleRing.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+bool range_ring_init(range_ring_t* ring, size_t capacity)
+{
+    size_t size = 2;
+    while(size < capacity)
+    {
+        size <<= 1;
+    }
+
+    ring->entries = calloc(size, sizeof(range_ring_entry_t));
+    if(ring->entries == NULL)
+    {
+        ring->mask = 0;
+        return false;
+    }
+
+    ring->mask = size - 1;
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->pushed_count, 0);
+    atomic_init(&ring->dropped_count, 0);
+    return true;
+}
+
+void range_ring_destroy(range_ring_t* ring)
+{
+    free(ring->entries);
+    ring->entries = NULL;
+    ring->mask = 0;
+}
+
+bool range_ring_push(range_ring_t* ring, const range_ring_entry_t* entry)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    if(ring->entries == NULL || tail - head > ring->mask)
+    {
+        atomic_fetch_add_explicit(&ring->dropped_count, 1, memory_order_relaxed);
+        return false;
+    }
+
+    ring->entries[tail & ring->mask] = *entry;
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    atomic_fetch_add_explicit(&ring->pushed_count, 1, memory_order_relaxed);
+    return true;
+}
+
+size_t range_ring_pop(range_ring_t* ring, range_ring_entry_t* out_entries, size_t max_entries)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    size_t available = tail - head;
+    if(available > max_entries)
+    {
+        available = max_entries;
+    }
+
+    for(size_t i = 0; i < available; i++)
+    {
+        out_entries[i] = ring->entries[(head + i) & ring->mask];
+    }
+
+    atomic_store_explicit(&ring->head, head + available, memory_order_release);
+    return available;
+}
+
+size_t range_ring_capacity(const range_ring_t* ring)
+{
+    return ring->entries == NULL ? 0 : ring->mask + 1;
+}
+
+size_t range_ring_count(range_ring_t* ring)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    return tail - head;
+}
+
+uint64_t range_ring_pushed_count(range_ring_t* ring)
+{
+    return atomic_load_explicit(&ring->pushed_count, memory_order_relaxed);
+}
+
+uint64_t range_ring_dropped_count(range_ring_t* ring)
+{
+    return atomic_load_explicit(&ring->dropped_count, memory_order_relaxed);
+}
@@ -0,0 +1,88 @@
+//
+//  RangeSampleRing.h
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RangeSampleRing_h
+#define RangeSampleRing_h
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "RangeTypes.h"
+
+/*
+ Single producer / single consumer queue of decoded samples.
+
+ The producer is the audio decode (the AudioQueue callback thread). It must never block,
+ so pushing never locks or allocates. If the consumer falls behind and the ring is full
+ the new sample is dropped and counted instead.
+
+ The consumer is whoever calls refreshRangeDataManager. It drains everything that is there.
+
+ Only one thread may push and only one thread may pop. Init/destroy must not race either side.
+ */
+
+typedef struct {
+    range_sample_t sample;
+    range_uid_t    uid;
+} range_ring_entry_t;
+
+// Keeps the producer and consumer indices on separate cache lines.
+#define RANGE_RING_CACHE_LINE 64
+
+typedef struct {
+    range_ring_entry_t* entries;
+    size_t              mask;
+
+    _Alignas(RANGE_RING_CACHE_LINE) _Atomic size_t tail;     // written by the producer
+    _Atomic uint64_t    pushed_count;
+    _Atomic uint64_t    dropped_count;
+
+    _Alignas(RANGE_RING_CACHE_LINE) _Atomic size_t head;     // written by the consumer
+} range_ring_t;
+
+/*
+ capacity is rounded up to a power of two.
+ Returns false if we ran out of memory.
+ */
+bool range_ring_init(range_ring_t* ring, size_t capacity);
+void range_ring_destroy(range_ring_t* ring);
+
+/*
+ Producer side. Returns false (and counts a dropped sample) if the ring is full.
+ */
+bool range_ring_push(range_ring_t* ring, const range_ring_entry_t* entry);
+
+/*
+ Consumer side. Copies up to max_entries out of the ring and returns how many were copied.
+ */
+size_t range_ring_pop(range_ring_t* ring, range_ring_entry_t* out_entries, size_t max_entries);
+
+size_t range_ring_capacity(const range_ring_t* ring);
+
+// Entries waiting to be popped. Either side may ask; the answer may be stale by the time it is used.
+size_t range_ring_count(range_ring_t* ring);
+
+// Samples accepted by range_ring_push since init.
+uint64_t range_ring_pushed_count(range_ring_t* ring);
+
+// Samples thrown away because the ring was full.
+uint64_t range_ring_dropped_count(range_ring_t* ring);
+
+#endif /* RangeSampleRing_h */
@@ -0,0 +1,997 @@
+//
+//  RangeSampleStore.c
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "RangeSampleStore.h"
+#include "RangeSampleCodec.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+// Interpolation probes inside a chunk before falling back to a binary search.
+// Evenly spaced samples land within a probe or two; bursty ones can't make us slower than log2.
+#define RS_INTERPOLATION_PROBES 3
+
+// Queries handled per pass of range_store_interpolate. The per pass arrays live on the stack.
+#define RS_INTERPOLATE_BATCH 64
+
+#pragma mark - chunks
+
+static range_chunk_t* rs_heap_chunk_create(void)
+{
+    range_chunk_t* chunk = calloc(1, sizeof(range_chunk_t));
+    if(chunk == NULL)
+    {
+        return NULL;
+    }
+
+    chunk->times = malloc(sizeof(double) * RANGE_STORE_CHUNK_CAPACITY);
+    chunk->temperatures = malloc(sizeof(float) * RANGE_STORE_CHUNK_CAPACITY);
+    if(chunk->times == NULL || chunk->temperatures == NULL)
+    {
+        free(chunk->times);
+        free(chunk->temperatures);
+        free(chunk);
+        return NULL;
+    }
+
+    atomic_init(&chunk->ref_count, 1);
+    atomic_init(&chunk->inflated, NULL);
+    return chunk;
+}
+
+static range_chunk_t* rs_chunk_create(range_store_t* store, int chunk_index)
+{
+    if(store->allocator.create_chunk != NULL)
+    {
+        return store->allocator.create_chunk(store->allocator.context, chunk_index);
+    }
+    return rs_heap_chunk_create();
+}
+
+static void rs_chunk_retain(range_chunk_t* chunk)
+{
+    atomic_fetch_add_explicit(&chunk->ref_count, 1, memory_order_relaxed);
+}
+
+static void rs_chunk_release(range_chunk_t* chunk)
+{
+    if(chunk == NULL)
+    {
+        return;
+    }
+
+    if(atomic_fetch_sub_explicit(&chunk->ref_count, 1, memory_order_acq_rel) == 1)
+    {
+        if(chunk->mapping != NULL)
+        {
+            munmap(chunk->mapping, chunk->mapping_size);
+        }
+        else if(chunk->compressed != NULL)
+        {
+            free(chunk->compressed);
+            rs_chunk_release(atomic_load_explicit(&chunk->inflated, memory_order_acquire));
+        } else {
+            free(chunk->times);
+            free(chunk->temperatures);
+        }
+        free(chunk);
+    }
+}
+
+// The plain chunk holding the samples of chunk.
+static range_chunk_t* rs_chunk_plain(range_chunk_t* chunk)
+{
+    if(chunk->compressed == NULL)
+    {
+        return chunk;
+    }
+
+    range_chunk_t* inflated = atomic_load_explicit(&chunk->inflated, memory_order_acquire);
+    if(inflated != NULL)
+    {
+        return inflated;
+    }
+
+    inflated = rs_heap_chunk_create();
+    if(inflated == NULL)
+    {
+        return NULL;
+    }
+    if(!range_codec_decode(chunk->compressed, chunk->compressed_size, RANGE_STORE_CHUNK_CAPACITY,
+                           inflated->times, inflated->temperatures))
+    {
+        // Can't happen unless memory was stomped on. Better wrong values than a crash.
+        for(int i = 0; i < RANGE_STORE_CHUNK_CAPACITY; i++)
+        {
+            inflated->times[i] = NAN;
+            inflated->temperatures[i] = NAN;
+        }
+    }
+
+    // Somebody else may have been decoding it at the same time. First one in wins.
+    range_chunk_t* expected = NULL;
+    if(!atomic_compare_exchange_strong_explicit(&chunk->inflated, &expected, inflated,
+                                                memory_order_acq_rel, memory_order_acquire))
+    {
+        rs_chunk_release(inflated);
+        return expected;
+    }
+    return inflated;
+}
+
+// A compressed chunk holding the first RANGE_STORE_CHUNK_CAPACITY samples of data.
+static range_chunk_t* rs_compressed_chunk_create(const uint8_t* data, size_t size)
+{
+    range_chunk_t* chunk = calloc(1, sizeof(range_chunk_t));
+    if(chunk == NULL)
+    {
+        return NULL;
+    }
+
+    chunk->compressed = malloc(size > 0 ? size : 1);
+    if(chunk->compressed == NULL)
+    {
+        free(chunk);
+        return NULL;
+    }
+    memcpy(chunk->compressed, data, size);
+    chunk->compressed_size = size;
+    atomic_init(&chunk->ref_count, 1);
+    atomic_init(&chunk->inflated, NULL);
+    return chunk;
+}
+
+static void rs_store_retire_chunk(range_store_t* store, range_chunk_t* chunk)
+{
+    if(store->allocator.retire_chunk != NULL)
+    {
+        store->allocator.retire_chunk(store->allocator.context, chunk);
+    } else {
+        rs_chunk_release(chunk);
+    }
+}
+
+static bool rs_store_grow_directory(range_store_t* store)
+{
+    if(store->chunk_count == store->chunk_directory_size)
+    {
+        // Only the directory of chunk pointers grows. The samples themselves stay put.
+        int new_size = store->chunk_directory_size ? store->chunk_directory_size * 2 : 16;
+        range_chunk_t** new_chunks = realloc(store->chunks, sizeof(range_chunk_t*) * new_size);
+        if(new_chunks == NULL)
+        {
+            return false;
+        }
+        store->chunks = new_chunks;
+
+        range_chunk_rows_t* new_rows = realloc(store->rows, sizeof(range_chunk_rows_t) * new_size);
+        if(new_rows == NULL)
+        {
+            return false;
+        }
+        memset(new_rows + store->chunk_directory_size, 0, sizeof(range_chunk_rows_t) * (new_size - store->chunk_directory_size));
+        store->rows = new_rows;
+
+        range_chunk_bounds_t* new_bounds = realloc(store->bounds, sizeof(range_chunk_bounds_t) * new_size);
+        if(new_bounds == NULL)
+        {
+            return false;
+        }
+        store->bounds = new_bounds;
+
+        store->chunk_directory_size = new_size;
+    }
+    return true;
+}
+
+static bool rs_store_add_chunk(range_store_t* store)
+{
+    if(!rs_store_grow_directory(store))
+    {
+        return false;
+    }
+
+    range_chunk_t* chunk = rs_chunk_create(store, store->chunk_count);
+    if(chunk == NULL)
+    {
+        return false;
+    }
+
+    store->chunks[store->chunk_count++] = chunk;
+    return true;
+}
+
+// Before writing at index into a chunk a frozen copy may still be reading (or a compressed one,
+// or one whose file vouches for that slot), give the store its own copy.
+static bool rs_store_make_writable(range_store_t* store, int index)
+{
+    int chunk_index = index / RANGE_STORE_CHUNK_CAPACITY;
+    range_chunk_t* chunk = store->chunks[chunk_index];
+    if(chunk->compressed == NULL &&
+       (index % RANGE_STORE_CHUNK_CAPACITY) >= chunk->synced_count &&
+       (index >= store->frozen_length || atomic_load_explicit(&chunk->ref_count, memory_order_acquire) == 1))
+    {
+        // Nobody else has been shown this slot, or nobody else has the chunk.
+        return true;
+    }
+
+    // Compressed chunks are never written to, so they are always swapped for a plain copy.
+    range_chunk_t* plain = rs_chunk_plain(chunk);
+    range_chunk_t* copy = plain != NULL ? rs_chunk_create(store, chunk_index) : NULL;
+    if(copy == NULL)
+    {
+        return false;
+    }
+
+    int offset = index % RANGE_STORE_CHUNK_CAPACITY;
+    memcpy(copy->times, plain->times, sizeof(double) * offset);
+    memcpy(copy->temperatures, plain->temperatures, sizeof(float) * offset);
+
+    store->chunks[chunk_index] = copy;
+    rs_store_retire_chunk(store, chunk);
+
+    // The copied samples are new as far as whoever provided the chunk is concerned.
+    if(store->dirty_from > chunk_index * RANGE_STORE_CHUNK_CAPACITY)
+    {
+        store->dirty_from = chunk_index * RANGE_STORE_CHUNK_CAPACITY;
+    }
+    return true;
+}
+
+static void rs_store_truncate(range_store_t* store, int new_length)
+{
+    for(int i = new_length / RANGE_STORE_CHUNK_CAPACITY; i < store->chunk_count; i++)
+    {
+        int count = new_length - (i * RANGE_STORE_CHUNK_CAPACITY);
+        if(count < 0)
+        {
+            count = 0;
+        }
+        if(store->rows[i].row_count > count)
+        {
+            store->rows[i].row_count = count;
+        }
+    }
+    store->length = new_length;
+    if(store->dirty_from > new_length)
+    {
+        store->dirty_from = new_length;
+    }
+
+    if(new_length > 0)
+    {
+        int last_index = new_length - 1;
+        store->bounds[last_index / RANGE_STORE_CHUNK_CAPACITY].last_time = range_store_time_at(store, last_index);
+    }
+}
+
+#pragma mark - store
+
+void range_store_init(range_store_t* store)
+{
+    memset(store, 0, sizeof(range_store_t));
+}
+
+int range_store_drop_front(range_store_t* store, int chunk_count)
+{
+    int full_chunks = store->length / RANGE_STORE_CHUNK_CAPACITY;
+    if(full_chunks > 0 && full_chunks * RANGE_STORE_CHUNK_CAPACITY == store->length)
+    {
+        // The last full chunk is still the one being appended to until the next sample comes in.
+        full_chunks--;
+    }
+    if(chunk_count > full_chunks)
+    {
+        chunk_count = full_chunks;
+    }
+    if(chunk_count <= 0)
+    {
+        return 0;
+    }
+
+    for(int i = 0; i < chunk_count; i++)
+    {
+        rs_store_retire_chunk(store, store->chunks[i]);
+        free(store->rows[i].rows);
+    }
+
+    int remaining = store->chunk_count - chunk_count;
+    memmove(store->chunks, store->chunks + chunk_count, sizeof(range_chunk_t*) * remaining);
+    memmove(store->rows, store->rows + chunk_count, sizeof(range_chunk_rows_t) * remaining);
+    memmove(store->bounds, store->bounds + chunk_count, sizeof(range_chunk_bounds_t) * remaining);
+    memset(store->rows + remaining, 0, sizeof(range_chunk_rows_t) * chunk_count);
+    store->chunk_count = remaining;
+
+    int dropped = chunk_count * RANGE_STORE_CHUNK_CAPACITY;
+    store->length -= dropped;
+    store->frozen_length = store->frozen_length > dropped ? store->frozen_length - dropped : 0;
+    store->dirty_from = store->dirty_from > dropped ? store->dirty_from - dropped : 0;
+    return chunk_count;
+}
+
+void range_store_release_chunk(range_chunk_t* chunk)
+{
+    rs_chunk_release(chunk);
+}
+
+void range_store_destroy(range_store_t* store)
+{
+    for(int i = 0; i < store->chunk_count; i++)
+    {
+        rs_chunk_release(store->chunks[i]);
+        free(store->rows[i].rows);
+    }
+    free(store->chunks);
+    free(store->rows);
+    free(store->bounds);
+    memset(store, 0, sizeof(range_store_t));
+}
+
+bool range_store_init_frozen_copy(range_store_t* copy, range_store_t* source)
+{
+    range_store_init(copy);
+
+    int chunk_count = (source->length + RANGE_STORE_CHUNK_CAPACITY - 1) / RANGE_STORE_CHUNK_CAPACITY;
+    if(chunk_count == 0)
+    {
+        return true;
+    }
+
+    copy->chunks = malloc(sizeof(range_chunk_t*) * chunk_count);
+    copy->rows = calloc(chunk_count, sizeof(range_chunk_rows_t));
+    copy->bounds = malloc(sizeof(range_chunk_bounds_t) * chunk_count);
+    if(copy->chunks == NULL || copy->rows == NULL || copy->bounds == NULL)
+    {
+        free(copy->chunks);
+        free(copy->rows);
+        free(copy->bounds);
+        range_store_init(copy);
+        return false;
+    }
+    memcpy(copy->bounds, source->bounds, sizeof(range_chunk_bounds_t) * chunk_count);
+
+    for(int i = 0; i < chunk_count; i++)
+    {
+        rs_chunk_retain(source->chunks[i]);
+        copy->chunks[i] = source->chunks[i];
+    }
+    copy->chunk_count = chunk_count;
+    copy->chunk_directory_size = chunk_count;
+    copy->length = source->length;
+    copy->frozen_length = source->length;
+
+    if(source->frozen_length < source->length)
+    {
+        source->frozen_length = source->length;
+    }
+    return true;
+}
+
+range_chunk_t* range_store_wrap_chunk(double* times, float* temperatures, void* mapping, size_t mapping_size)
+{
+    range_chunk_t* chunk = calloc(1, sizeof(range_chunk_t));
+    if(chunk == NULL)
+    {
+        return NULL;
+    }
+
+    chunk->times = times;
+    chunk->temperatures = temperatures;
+    chunk->mapping = mapping;
+    chunk->mapping_size = mapping_size;
+    atomic_init(&chunk->ref_count, 1);
+    atomic_init(&chunk->inflated, NULL);
+    return chunk;
+}
+
+const double* range_chunk_times(range_chunk_t* chunk)
+{
+    if(chunk->times != NULL)
+    {
+        return chunk->times;
+    }
+    range_chunk_t* plain = rs_chunk_plain(chunk);
+    return plain != NULL ? plain->times : NULL;
+}
+
+const float* range_chunk_temperatures(range_chunk_t* chunk)
+{
+    if(chunk->temperatures != NULL)
+    {
+        return chunk->temperatures;
+    }
+    range_chunk_t* plain = rs_chunk_plain(chunk);
+    return plain != NULL ? plain->temperatures : NULL;
+}
+
+int range_store_compress_sealed(range_store_t* store, int max_chunks)
+{
+    int sealed_count = store->length / RANGE_STORE_CHUNK_CAPACITY;
+    int swapped = 0;
+
+    for(int i = 0; i < sealed_count && swapped < max_chunks; i++)
+    {
+        range_chunk_t* chunk = store->chunks[i];
+        range_chunk_t* replacement = NULL;
+
+        if(chunk->mapping != NULL)
+        {
+            // The OS already pages these in and out for us.
+            continue;
+        }
+        else if(chunk->compressed != NULL)
+        {
+            if(atomic_load_explicit(&chunk->inflated, memory_order_acquire) == NULL)
+            {
+                continue;
+            }
+            if(!chunk->inflated_seen)
+            {
+                // Give whoever is reading it until the next pass.
+                chunk->inflated_seen = true;
+                continue;
+            }
+            replacement = rs_compressed_chunk_create(chunk->compressed, chunk->compressed_size);
+        } else {
+            uint8_t* data = NULL;
+            size_t size = 0;
+            if(range_codec_encode(chunk->times, chunk->temperatures, RANGE_STORE_CHUNK_CAPACITY, &data, &size))
+            {
+                replacement = rs_compressed_chunk_create(data, size);
+                free(data);
+            }
+        }
+
+        if(replacement == NULL)
+        {
+            // Out of memory. Compressing can wait.
+            break;
+        }
+
+        store->chunks[i] = replacement;
+        rs_store_retire_chunk(store, chunk);
+        swapped++;
+    }
+    return swapped;
+}
+
+void range_store_memory_usage(const range_store_t* store, size_t* raw_bytes_out, size_t* stored_bytes_out)
+{
+    size_t plain_chunk_size = (sizeof(double) + sizeof(float)) * RANGE_STORE_CHUNK_CAPACITY;
+    size_t stored = 0;
+
+    int chunk_count = (store->length + RANGE_STORE_CHUNK_CAPACITY - 1) / RANGE_STORE_CHUNK_CAPACITY;
+    for(int i = 0; i < chunk_count; i++)
+    {
+        range_chunk_t* chunk = store->chunks[i];
+        if(chunk->compressed != NULL)
+        {
+            stored += chunk->compressed_size;
+            if(atomic_load_explicit(&chunk->inflated, memory_order_acquire) != NULL)
+            {
+                stored += plain_chunk_size;
+            }
+        } else {
+            stored += plain_chunk_size;
+        }
+        if(store->rows[i].rows != NULL)
+        {
+            stored += sizeof(range_sample_t) * RANGE_STORE_CHUNK_CAPACITY;
+        }
+    }
+
+    if(raw_bytes_out != NULL)
+    {
+        *raw_bytes_out = (sizeof(double) + sizeof(float)) * (size_t)store->length;
+    }
+    if(stored_bytes_out != NULL)
+    {
+        *stored_bytes_out = stored;
+    }
+}
+
+bool range_store_adopt_chunk(range_store_t* store, range_chunk_t* chunk, int count)
+{
+    if(store->length != store->chunk_count * RANGE_STORE_CHUNK_CAPACITY || !rs_store_grow_directory(store))
+    {
+        rs_chunk_release(chunk);
+        return false;
+    }
+
+    int chunk_index = store->chunk_count++;
+    store->chunks[chunk_index] = chunk;
+    store->length += count;
+    if(count > 0)
+    {
+        store->bounds[chunk_index].first_time = chunk->times[0];
+        store->bounds[chunk_index].last_time = chunk->times[count - 1];
+    }
+    return true;
+}
+
+void range_store_clear_dirty(range_store_t* store)
+{
+    store->dirty_from = store->length;
+}
+
+int range_store_chunk_length(const range_store_t* store, int chunk_index)
+{
+    int count = store->length - (chunk_index * RANGE_STORE_CHUNK_CAPACITY);
+    if(count < 0)
+    {
+        return 0;
+    }
+    return count < RANGE_STORE_CHUNK_CAPACITY ? count : RANGE_STORE_CHUNK_CAPACITY;
+}
+
+bool range_store_append(range_store_t* store, double time, float temperature)
+{
+    int chunk_index = store->length / RANGE_STORE_CHUNK_CAPACITY;
+    if(chunk_index >= store->chunk_count)
+    {
+        if(!rs_store_add_chunk(store))
+        {
+            return false;
+        }
+    }
+
+    if(!rs_store_make_writable(store, store->length))
+    {
+        return false;
+    }
+
+    range_chunk_t* chunk = store->chunks[chunk_index];
+    range_chunk_rows_t* rows = &(store->rows[chunk_index]);
+    int offset = store->length % RANGE_STORE_CHUNK_CAPACITY;
+
+    chunk->times[offset] = time;
+    chunk->temperatures[offset] = temperature;
+
+    if(offset == 0)
+    {
+        store->bounds[chunk_index].first_time = time;
+    }
+    store->bounds[chunk_index].last_time = time;
+
+    // Keep an already built row view in step so we don't have to rebuild it later.
+    if(rows->rows != NULL && rows->row_count == offset)
+    {
+        rows->rows[offset].temperature = temperature;
+        rows->rows[offset].unix_time = time;
+        rows->row_count++;
+    }
+
+    store->length++;
+    return true;
+}
+
+bool range_store_append_run(range_store_t* store, const double* times, const float* temperatures, int count)
+{
+    for(int i = 0; i < count; i++)
+    {
+        if(!range_store_append(store, times[i], temperatures[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool range_store_merge(range_store_t* store, const double* times, const float* temperatures, int count)
+{
+    if(count <= 0)
+    {
+        return true;
+    }
+
+    int split = range_store_lower_bound(store, times[0]);
+    int tail_length = store->length - split;
+
+    double* tail_times = NULL;
+    float* tail_temperatures = NULL;
+    if(tail_length > 0)
+    {
+        tail_times = malloc(sizeof(double) * tail_length);
+        tail_temperatures = malloc(sizeof(float) * tail_length);
+        if(tail_times == NULL || tail_temperatures == NULL)
+        {
+            free(tail_times);
+            free(tail_temperatures);
+            return false;
+        }
+
+        for(int i = 0; i < tail_length; i++)
+        {
+            tail_times[i] = range_store_time_at(store, split + i);
+            tail_temperatures[i] = range_store_temperature_at(store, split + i);
+        }
+        rs_store_truncate(store, split);
+    }
+
+    bool success = true;
+    int i = 0;
+    int j = 0;
+    while(success && (i < tail_length || j < count))
+    {
+        double time;
+        float temperature;
+
+        // On equal timestamps the sample we already had wins.
+        if(j >= count || (i < tail_length && tail_times[i] <= times[j]))
+        {
+            time = tail_times[i];
+            temperature = tail_temperatures[i];
+            i++;
+        } else {
+            time = times[j];
+            temperature = temperatures[j];
+            j++;
+        }
+
+        if(store->length > 0 && range_store_time_at(store, store->length - 1) >= time)
+        {
+            continue;
+        }
+
+        success = range_store_append(store, time, temperature);
+    }
+
+    free(tail_times);
+    free(tail_temperatures);
+    return success;
+}
+
+double range_store_time_at(const range_store_t* store, int index)
+{
+    range_chunk_t* chunk = store->chunks[index / RANGE_STORE_CHUNK_CAPACITY];
+    const double* times = chunk->times != NULL ? chunk->times : range_chunk_times(chunk);
+    return times != NULL ? times[index % RANGE_STORE_CHUNK_CAPACITY] : NAN;
+}
+
+float range_store_temperature_at(const range_store_t* store, int index)
+{
+    range_chunk_t* chunk = store->chunks[index / RANGE_STORE_CHUNK_CAPACITY];
+    const float* temperatures = chunk->temperatures != NULL ? chunk->temperatures : range_chunk_temperatures(chunk);
+    return temperatures != NULL ? temperatures[index % RANGE_STORE_CHUNK_CAPACITY] : NAN;
+}
+
+const range_sample_t* range_store_row_at(range_store_t* store, int index, int* contiguous_out)
+{
+    if(index < 0 || index >= store->length)
+    {
+        if(contiguous_out != NULL)
+        {
+            *contiguous_out = 0;
+        }
+        return NULL;
+    }
+
+    int chunk_index = index / RANGE_STORE_CHUNK_CAPACITY;
+    range_chunk_t* chunk = store->chunks[chunk_index];
+    range_chunk_rows_t* rows = &(store->rows[chunk_index]);
+    int offset = index % RANGE_STORE_CHUNK_CAPACITY;
+    int chunk_length = range_store_chunk_length(store, chunk_index);
+
+    if(rows->rows == NULL)
+    {
+        rows->rows = malloc(sizeof(range_sample_t) * RANGE_STORE_CHUNK_CAPACITY);
+        rows->row_count = 0;
+        if(rows->rows == NULL)
+        {
+            if(contiguous_out != NULL)
+            {
+                *contiguous_out = 0;
+            }
+            return NULL;
+        }
+    }
+
+    if(rows->row_count < chunk_length)
+    {
+        const double* times = range_chunk_times(chunk);
+        const float* temperatures = range_chunk_temperatures(chunk);
+        if(times == NULL || temperatures == NULL)
+        {
+            if(contiguous_out != NULL)
+            {
+                *contiguous_out = 0;
+            }
+            return NULL;
+        }
+
+        for(int i = rows->row_count; i < chunk_length; i++)
+        {
+            rows->rows[i].temperature = temperatures[i];
+            rows->rows[i].unix_time = times[i];
+        }
+        rows->row_count = chunk_length;
+    }
+
+    if(contiguous_out != NULL)
+    {
+        *contiguous_out = chunk_length - offset;
+    }
+    return &(rows->rows[offset]);
+}
+
+#pragma mark - time lookups
+
+// Is the sample at sample_time before the one we are looking for?
+// A lower bound looks for the first time >= time, an upper bound for the first time > time.
+static inline bool rs_is_before(double sample_time, double time, bool upper)
+{
+    return upper ? sample_time <= time : sample_time < time;
+}
+
+// First chunk that holds the answer. chunk_count if it is past the end.
+static int rs_find_chunk(const range_store_t* store, double time, bool upper)
+{
+    int low = 0;
+    int high = (store->length + RANGE_STORE_CHUNK_CAPACITY - 1) / RANGE_STORE_CHUNK_CAPACITY;
+    while(low < high)
+    {
+        int mid = low + (high - low) / 2;
+        if(rs_is_before(store->bounds[mid].last_time, time, upper))
+        {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static int rs_search_chunk(const double* times, int count, double time, bool upper)
+{
+    // Everything before low is before time, everything from high on is not.
+    int low = 0;
+    int high = count;
+
+    for(int probe = 0; probe < RS_INTERPOLATION_PROBES && low < high; probe++)
+    {
+        double low_time = times[low];
+        double high_time = times[high - 1];
+        if(!rs_is_before(low_time, time, upper))
+        {
+            return low;
+        }
+        if(rs_is_before(high_time, time, upper))
+        {
+            return high;
+        }
+
+        int guess = low + (int)((time - low_time) / (high_time - low_time) * (double)(high - 1 - low));
+        if(guess < low)
+        {
+            guess = low;
+        }
+        else if(guess > high - 1)
+        {
+            guess = high - 1;
+        }
+
+        if(rs_is_before(times[guess], time, upper))
+        {
+            low = guess + 1;
+        } else {
+            high = guess;
+        }
+    }
+
+    while(low < high)
+    {
+        int mid = low + (high - low) / 2;
+        if(rs_is_before(times[mid], time, upper))
+        {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static int rs_store_search(const range_store_t* store, double time, bool upper)
+{
+    int chunk_index = rs_find_chunk(store, time, upper);
+    int first_index = chunk_index * RANGE_STORE_CHUNK_CAPACITY;
+    if(first_index >= store->length)
+    {
+        return store->length;
+    }
+
+    int count = range_store_chunk_length(store, chunk_index);
+    const double* times = range_chunk_times(store->chunks[chunk_index]);
+    if(times == NULL)
+    {
+        return store->length;
+    }
+    return first_index + rs_search_chunk(times, count, time, upper);
+}
+
+int range_store_lower_bound(const range_store_t* store, double time)
+{
+    return rs_store_search(store, time, false);
+}
+
+int range_store_upper_bound(const range_store_t* store, double time)
+{
+    return rs_store_search(store, time, true);
+}
+
+#pragma mark - interpolation
+
+// First index at or after from with a time >= time. Everything before from must be earlier than time.
+// Gallops forward inside the chunk holding from, so a query close to the last one only looks at a few samples.
+// Anything past that chunk goes through the chunk index instead.
+static int rs_store_walk(const range_store_t* store, int from, double time)
+{
+    if(from >= store->length)
+    {
+        return from;
+    }
+
+    int chunk_index = from / RANGE_STORE_CHUNK_CAPACITY;
+    if(time > store->bounds[chunk_index].last_time)
+    {
+        return range_store_lower_bound(store, time);
+    }
+
+    const double* times = range_chunk_times(store->chunks[chunk_index]);
+    if(times == NULL)
+    {
+        return range_store_lower_bound(store, time);
+    }
+
+    // The chunk's last sample is >= time, so the answer is in this chunk.
+    int base = chunk_index * RANGE_STORE_CHUNK_CAPACITY;
+    int end = range_store_chunk_length(store, chunk_index);
+    int low = from - base;
+    if(times[low] >= time)
+    {
+        return from;
+    }
+
+    int step = 1;
+    int high = low + step;
+    while(high < end && times[high] < time)
+    {
+        low = high;
+        step *= 2;
+        high = low + step;
+    }
+    if(high > end - 1)
+    {
+        high = end - 1;
+    }
+
+    // times[low] < time <= times[high]
+    low++;
+    while(low < high)
+    {
+        int mid = low + (high - low) / 2;
+        if(times[mid] < time)
+        {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return base + low;
+}
+
+void range_store_interpolate(const range_store_t* store, const double* times, int count,
+                             float* temperatures_out, double* intervals_out)
+{
+    int length = store->length;
+    if(length == 0)
+    {
+        for(int i = 0; i < count; i++)
+        {
+            temperatures_out[i] = 0.0f;
+            if(intervals_out != NULL)
+            {
+                intervals_out[i] = -1.0;
+            }
+        }
+        return;
+    }
+
+    double first_time = range_store_time_at(store, 0);
+    double last_time = range_store_time_at(store, length - 1);
+    float first_temperature = range_store_temperature_at(store, 0);
+    float last_temperature = range_store_temperature_at(store, length - 1);
+
+    // The search is done first for a whole batch, leaving the lerp as one branch free loop
+    // the compiler can vectorize. Samples that aren't interpolated get a slope of 0.
+    float bases[RS_INTERPOLATE_BATCH];
+    float slopes[RS_INTERPOLATE_BATCH];
+    double offsets[RS_INTERPOLATE_BATCH];
+    double spans[RS_INTERPOLATE_BATCH];
+
+    int index = 0;
+    double previous_time = -INFINITY;
+    for(int done = 0; done < count; done += RS_INTERPOLATE_BATCH)
+    {
+        int batch = count - done < RS_INTERPOLATE_BATCH ? count - done : RS_INTERPOLATE_BATCH;
+        for(int i = 0; i < batch; i++)
+        {
+            double time = times[done + i];
+            double interval = -1.0;
+            bases[i] = 0.0f;
+            slopes[i] = 0.0f;
+            offsets[i] = 0.0;
+            spans[i] = 1.0;
+
+            if(!(time > first_time))
+            {
+                // Before (or at) the first sample. NaN ends up here too.
+                bases[i] = first_temperature;
+                interval = time == first_time ? 0.0 : -1.0;
+            }
+            else if(time >= last_time)
+            {
+                // After (or at) the last sample
+                bases[i] = last_temperature;
+                interval = time == last_time ? 0.0 : -1.0;
+            } else {
+                // Sorted queries keep walking forward. Anything else starts a new search.
+                index = time >= previous_time ? rs_store_walk(store, index, time) : range_store_lower_bound(store, time);
+                previous_time = time;
+
+                // Both samples are normally in the same chunk.
+                int offset = index % RANGE_STORE_CHUNK_CAPACITY;
+                range_chunk_t* chunk = store->chunks[index / RANGE_STORE_CHUNK_CAPACITY];
+                const double* chunk_times = offset > 0 ? range_chunk_times(chunk) : NULL;
+                const float* chunk_temperatures = offset > 0 ? range_chunk_temperatures(chunk) : NULL;
+                bool same_chunk = chunk_times != NULL && chunk_temperatures != NULL;
+
+                double t1 = same_chunk ? chunk_times[offset] : range_store_time_at(store, index);
+                if(t1 == time)
+                {
+                    bases[i] = same_chunk ? chunk_temperatures[offset] : range_store_temperature_at(store, index);
+                    interval = 0.0;
+                } else {
+                    double t0 = same_chunk ? chunk_times[offset - 1] : range_store_time_at(store, index - 1);
+                    float v0 = same_chunk ? chunk_temperatures[offset - 1] : range_store_temperature_at(store, index - 1);
+                    float v1 = same_chunk ? chunk_temperatures[offset] : range_store_temperature_at(store, index);
+                    interval = t1 - t0;
+                    bases[i] = v0;
+                    slopes[i] = v1 - v0;
+                    offsets[i] = time - t0;
+                    spans[i] = interval;
+                }
+            }
+
+            if(intervals_out != NULL)
+            {
+                intervals_out[done + i] = interval;
+            }
+        }
+
+        // Same arithmetic as RangeData interpolateTemperatureAtTime, so both give the same answer.
+        float* output = temperatures_out + done;
+        for(int i = 0; i < batch; i++)
+        {
+            output[i] = bases[i] + slopes[i] * (float)(offsets[i] / spans[i]);
+        }
+    }
+}
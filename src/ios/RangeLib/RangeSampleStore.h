@@ -0,0 +1,253 @@
+//
+//  RangeSampleStore.h
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RangeSampleStore_h
+#define RangeSampleStore_h
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "RangeTypes.h"
+
+/*
+ Backing store for a single RangeData.
+
+ Samples live in fixed size chunks. Each chunk keeps its timestamps and temperatures
+ in two separate arrays so that searches only walk the timestamps.
+ Growing the store allocates a new chunk; existing chunks are never moved or copied to make room.
+
+ Every chunk except the last one is always full, so an index maps straight to
+ (index / RANGE_STORE_CHUNK_CAPACITY, index % RANGE_STORE_CHUNK_CAPACITY).
+
+ The range_sample_t view of a chunk (used by the pointer based RangeData functions)
+ is only built the first time somebody asks for it. It belongs to the store, not the chunk,
+ so it stays where it is when the chunk is copied or compressed. An address handed out by
+ range_store_row_at stays valid for the life of the store, unless range_store_drop_front drops its chunk.
+ A frozen copy builds its own views, which go when the copy is destroyed.
+
+ Chunks are reference counted so a frozen copy of a store (see range_store_init_frozen_copy)
+ can keep reading them from another thread while the original keeps growing.
+ Appending never touches samples a frozen copy can see. Rewriting them (an out of order merge)
+ first gives the store its own copy of the chunk. The same goes for samples of a mapped chunk
+ that its file already vouches for, so a crash in the middle of a merge can't tear them.
+
+ Lookups by time go through a small index of the first and last timestamp of every chunk.
+ That picks the chunk without touching the sample arrays, then an interpolation search
+ (samples are close to evenly spaced) finds the sample inside the chunk in a few probes.
+
+ Full chunks can be compressed (see RangeSampleCodec) with range_store_compress_sealed.
+ That swaps in a new chunk that only holds the compressed bytes. The first read decodes it again
+ into a plain chunk that hangs off the compressed one, until the next compression pass reseals it.
+
+ None of these functions lock. Apart from frozen copies (which are read only)
+ the owner is expected to serialize access.
+ */
+
+#define RANGE_STORE_CHUNK_CAPACITY 4096
+
+typedef struct range_chunk {
+    // NULL for compressed chunks. Use range_chunk_times / range_chunk_temperatures unless you know better.
+    double*         times;
+    float*          temperatures;
+    _Atomic int     ref_count;
+    // Set for chunks that live in a memory mapped file (see RangeSampleLog). Unmapped on the last release.
+    void*           mapping;
+    size_t          mapping_size;
+    // Where mapping starts in its file.
+    long long       mapping_offset;
+    // Samples of a mapped chunk the file vouches for (see RangeSampleLog). These are never written over;
+    // rewriting them gives the store a new chunk instead.
+    int             synced_count;
+    // Set for compressed chunks. These are never written to.
+    uint8_t*        compressed;
+    size_t          compressed_size;
+    // Decoded copy of a compressed chunk. Made by whichever reader needs it first.
+    _Atomic(struct range_chunk*) inflated;
+    // Only used by the thread that writes to the store: a compression pass saw the decoded copy.
+    bool            inflated_seen;
+} range_chunk_t;
+
+/*
+ Lets something other than the heap provide the chunks of a store.
+ create_chunk returns a new chunk (ref_count 1) that will hold the samples from
+ chunk_index * RANGE_STORE_CHUNK_CAPACITY on, or NULL if it can't.
+ retire_chunk (optional) is handed the store's reference to a chunk it no longer uses,
+ instead of the store releasing it.
+ */
+typedef struct {
+    range_chunk_t*  (*create_chunk)(void* context, int chunk_index);
+    void            (*retire_chunk)(void* context, range_chunk_t* chunk);
+    void*           context;
+} range_chunk_allocator_t;
+
+typedef struct {
+    // range_sample_t copy of the first row_count samples of a chunk. NULL until first requested.
+    range_sample_t* rows;
+    int             row_count;
+} range_chunk_rows_t;
+
+typedef struct {
+    // Timestamps of the first and last sample in a chunk. Only valid for chunks holding samples.
+    double          first_time;
+    double          last_time;
+} range_chunk_bounds_t;
+
+typedef struct {
+    range_chunk_t**     chunks;
+    // Parallel to chunks.
+    range_chunk_rows_t* rows;
+    // Parallel to chunks. Kept apart from the chunks so picking a chunk stays in cache.
+    range_chunk_bounds_t* bounds;
+    // Chunks in use or kept around (empty) for reuse after a truncate.
+    int                 chunk_count;
+    int                 chunk_directory_size;
+    int                 length;
+    // Largest length any frozen copy of this store was made with.
+    int                 frozen_length;
+    // Samples from this index on were written since range_store_clear_dirty. length if none were.
+    int                 dirty_from;
+    // Zeroed for plain heap chunks.
+    range_chunk_allocator_t allocator;
+} range_store_t;
+
+void range_store_init(range_store_t* store);
+void range_store_destroy(range_store_t* store);
+
+/*
+ Makes copy a read only view of the first source->length samples of source.
+ The chunks are shared, not copied. The copy can be read on any thread while
+ source keeps being written on its own thread, and it stays valid after source is destroyed.
+ Must be called on the thread that writes to source.
+ Returns false if we ran out of memory.
+ */
+bool range_store_init_frozen_copy(range_store_t* copy, range_store_t* source);
+
+/*
+ Wraps arrays that something else allocated (a memory mapping) into a chunk with a ref_count of 1.
+ When the last reference goes away mapping is unmapped rather than the arrays freed.
+ Returns NULL if we ran out of memory.
+ */
+range_chunk_t* range_store_wrap_chunk(double* times, float* temperatures, void* mapping, size_t mapping_size);
+
+/*
+ Puts a chunk (that holds count samples) on the end of a store whose length is a multiple of
+ RANGE_STORE_CHUNK_CAPACITY. The store takes over the reference (even when this fails).
+ Used to load stores from disk. Returns false if we ran out of memory.
+ */
+bool range_store_adopt_chunk(range_store_t* store, range_chunk_t* chunk, int count);
+
+/*
+ Marks every sample as written out. See dirty_from.
+ */
+void range_store_clear_dirty(range_store_t* store);
+
+/*
+ The samples of a chunk, decoding it first if it is compressed. Safe to call from any thread
+ that holds a reference to chunk. Returns NULL if we ran out of memory decoding it.
+ */
+const double* range_chunk_times(range_chunk_t* chunk);
+const float* range_chunk_temperatures(range_chunk_t* chunk);
+
+/*
+ Compresses up to max_chunks full chunks that are kept in memory, and reseals compressed chunks
+ whose decoded copy was already there on the previous pass. The range_sample_t views are kept.
+ Frozen copies keep the chunks they have; they only get the compressed ones when they are made again.
+ Must be called on the thread that writes to the store.
+ Returns the number of chunks swapped out.
+ */
+int range_store_compress_sealed(range_store_t* store, int max_chunks);
+
+/*
+ raw_bytes_out gets what the samples take up uncompressed (12 bytes each), and stored_bytes_out
+ what they really use: compressed chunks (including any decoded copies), whole plain chunks,
+ and the range_sample_t views built for the pointer based functions.
+ */
+void range_store_memory_usage(const range_store_t* store, size_t* raw_bytes_out, size_t* stored_bytes_out);
+
+/*
+ Gives up on the first chunk_count chunks. Only full chunks go, never the one being appended to.
+ The remaining samples move down to index 0. Frozen copies keep the chunks they have.
+ Returns the number of chunks dropped.
+ */
+int range_store_drop_front(range_store_t* store, int chunk_count);
+
+/*
+ Releases a reference to a chunk (see retire_chunk).
+ */
+void range_store_release_chunk(range_chunk_t* chunk);
+
+/*
+ Number of samples in the chunk at chunk_index.
+ */
+int range_store_chunk_length(const range_store_t* store, int chunk_index);
+
+/*
+ Appends a sample to the end of the store.
+ The caller guarantees time is not earlier than the last sample.
+ Returns false if we ran out of memory.
+ */
+bool range_store_append(range_store_t* store, double time, float temperature);
+
+/*
+ Appends a run of samples (sorted ascending by time) that are all later than the last sample.
+ Returns false if we ran out of memory.
+ */
+bool range_store_append_run(range_store_t* store, const double* times, const float* temperatures, int count);
+
+/*
+ Merges a run of samples (sorted ascending by time) into the store.
+ Samples that share a timestamp with one already stored are dropped.
+ Samples later than everything in the store are a plain append. Otherwise
+ only the part of the store at or after the first new sample is rewritten (in place).
+ Returns false if we ran out of memory.
+ */
+bool range_store_merge(range_store_t* store, const double* times, const float* temperatures, int count);
+
+double range_store_time_at(const range_store_t* store, int index);
+float range_store_temperature_at(const range_store_t* store, int index);
+
+/*
+ Pointer to the range_sample_t view of a sample. Builds the view for the chunk if needed.
+ contiguous_out (optional) gets the number of samples that can be read
+ from the returned pointer before hitting the end of the chunk.
+ */
+const range_sample_t* range_store_row_at(range_store_t* store, int index, int* contiguous_out);
+
+/*
+ First index with a time >= time. Returns length if there is none.
+ */
+int range_store_lower_bound(const range_store_t* store, double time);
+
+/*
+ First index with a time > time. Returns length if there is none.
+ */
+int range_store_upper_bound(const range_store_t* store, double time);
+
+/*
+ Linear interpolation at count times, same as RangeData interpolateTemperatureAtTime does for one.
+ times should be sorted ascending: then the whole call is one walk forward through the store,
+ galloping over the samples between neighbouring times. Unsorted times work but each one is a full search.
+ intervals_out (optional) gets the time between the two samples used, 0 for a time that has a sample,
+ and -1 for a time outside the samples (which gets the first or last temperature).
+ */
+void range_store_interpolate(const range_store_t* store, const double* times, int count,
+                             float* temperatures_out, double* intervals_out);
+
+#endif /* RangeSampleStore_h */
@@ -0,0 +1,194 @@
+//
+//  RangeSampleWriter.c
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "RangeSampleWriter.h"
+#include "RangeTemperatureFormat.h"
+#include "RangeTemperatureKernels.h"
+#include <math.h>
+#include <string.h>
+
+// Temperatures translated at a time.
+#define RSW_BATCH 256
+// Room one sample can take: a time, a temperature and the punctuation around them.
+#define RSW_SAMPLE_LENGTH (2 * RANGE_FORMAT_MAX_LENGTH + 32)
+
+static bool rsw_flush(range_sample_writer_t* writer)
+{
+    if(writer->used > 0 && !writer->failed)
+    {
+        writer->failed = !writer->sink(writer->sink_context, writer->buffer, writer->used);
+    }
+    writer->used = 0;
+    return !writer->failed;
+}
+
+static void rsw_append(range_sample_writer_t* writer, const char* text, size_t length)
+{
+    memcpy(writer->buffer + writer->used, text, length);
+    writer->used += length;
+}
+
+#define rsw_append_literal(writer, text) rsw_append((writer), (text), sizeof(text) - 1)
+
+static void rsw_start(range_sample_writer_t* writer)
+{
+    if(!writer->started)
+    {
+        if(writer->kind == RANGE_WRITER_CSV)
+        {
+            rsw_append_literal(writer, "time,temperature\n");
+        } else {
+            rsw_append_literal(writer, "[");
+        }
+        writer->started = true;
+    }
+}
+
+bool range_sample_writer_init(range_sample_writer_t* writer, int kind, int scale, int format,
+                              range_writer_sink_t sink, void* sink_context)
+{
+    int decimals = range_format_decimals(scale, format);
+    if(decimals < 0 || (kind != RANGE_WRITER_CSV && kind != RANGE_WRITER_JSON))
+    {
+        return false;
+    }
+    writer->kind = kind;
+    writer->scale = scale;
+    writer->format = format;
+    writer->decimals = decimals;
+    writer->sink = sink;
+    writer->sink_context = sink_context;
+    writer->started = false;
+    writer->samples_written = 0;
+    writer->failed = false;
+    writer->used = 0;
+    return true;
+}
+
+// Prints at most RSW_BATCH samples.
+static bool rsw_write_batch(range_sample_writer_t* writer, const double* times, const float* temperatures, int batch)
+{
+    float rounded[RSW_BATCH];
+    char number[RANGE_FORMAT_MAX_LENGTH];
+    bool json = writer->kind == RANGE_WRITER_JSON;
+    range_translate_and_round_temperatures(temperatures, rounded, batch, writer->scale, writer->format);
+
+    for(int i = 0; i < batch; i++)
+    {
+        if(RANGE_WRITER_BUFFER - writer->used < RSW_SAMPLE_LENGTH && !rsw_flush(writer))
+        {
+            return false;
+        }
+
+        if(json)
+        {
+            if(writer->samples_written > 0)
+            {
+                rsw_append_literal(writer, ",");
+            }
+            rsw_append_literal(writer, "{\"time\":");
+        }
+        if(isfinite(times[i]))
+        {
+            rsw_append(writer, number, range_format_time(number, times[i]));
+        } else if(json) {
+            rsw_append_literal(writer, "null");
+        }
+        if(json)
+        {
+            rsw_append_literal(writer, ",\"temperature\":");
+        } else {
+            rsw_append_literal(writer, ",");
+        }
+        if(isfinite(rounded[i]))
+        {
+            rsw_append(writer, number, range_format_decimal(number, rounded[i], writer->decimals));
+        } else if(json) {
+            rsw_append_literal(writer, "null");
+        }
+        if(json)
+        {
+            rsw_append_literal(writer, "}");
+        } else {
+            rsw_append_literal(writer, "\n");
+        }
+        writer->samples_written++;
+    }
+    return true;
+}
+
+bool range_sample_writer_write(range_sample_writer_t* writer, const range_sample_t* samples, int count)
+{
+    if(writer->failed)
+    {
+        return false;
+    }
+    rsw_start(writer);
+
+    double times[RSW_BATCH];
+    float temperatures[RSW_BATCH];
+    for(int done = 0; done < count; done += RSW_BATCH)
+    {
+        int batch = count - done < RSW_BATCH ? count - done : RSW_BATCH;
+        for(int i = 0; i < batch; i++)
+        {
+            times[i] = samples[done + i].unix_time;
+            temperatures[i] = samples[done + i].temperature;
+        }
+        if(!rsw_write_batch(writer, times, temperatures, batch))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool range_sample_writer_write_columns(range_sample_writer_t* writer, const double* times, const float* temperatures,
+                                       int count)
+{
+    if(writer->failed)
+    {
+        return false;
+    }
+    rsw_start(writer);
+
+    for(int done = 0; done < count; done += RSW_BATCH)
+    {
+        int batch = count - done < RSW_BATCH ? count - done : RSW_BATCH;
+        if(!rsw_write_batch(writer, times + done, temperatures + done, batch))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool range_sample_writer_finish(range_sample_writer_t* writer)
+{
+    if(writer->failed)
+    {
+        return false;
+    }
+    rsw_start(writer);
+    if(writer->kind == RANGE_WRITER_JSON)
+    {
+        rsw_append_literal(writer, "]");
+    }
+    return rsw_flush(writer);
+}
@@ -0,0 +1,90 @@
+//
+//  RangeSampleWriter.h
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RangeSampleWriter_h
+#define RangeSampleWriter_h
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "RangeTypes.h"
+
+/*
+ Streams samples out as CSV or JSON text, translated and rounded like RangeTemperatureTranslator does.
+
+ Text is put together in a fixed buffer inside the writer and handed to the sink whenever it fills up,
+ so any number of samples can be written, a run at a time, without allocating anything.
+ Temperatures are translated a batch at a time with range_translate_and_round_temperatures and
+ printed with range_format_decimal; times are printed to the millisecond.
+
+ CSV:  time,temperature  then one line per sample. NaN and infinities are empty fields.
+ JSON: [{"time":1400000000.125,"temperature":70.5},...]  NaN and infinities are null.
+ */
+
+#define RANGE_WRITER_CSV    0
+#define RANGE_WRITER_JSON   1
+
+#define RANGE_WRITER_BUFFER 4096
+
+/*
+ Takes length bytes of text. Returns false to stop the writer.
+ */
+typedef bool (*range_writer_sink_t)(void* context, const char* data, size_t length);
+
+typedef struct {
+    int                 kind;
+    int                 scale;
+    int                 format;
+    // Digits after the decimal point for the scale and format.
+    int                 decimals;
+    range_writer_sink_t sink;
+    void*               sink_context;
+    // Header (CSV) or opening bracket (JSON) written, and samples written so far.
+    bool                started;
+    long long           samples_written;
+    // Set once the sink said no. Nothing more is written.
+    bool                failed;
+    size_t              used;
+    char                buffer[RANGE_WRITER_BUFFER];
+} range_sample_writer_t;
+
+/*
+ kind is RANGE_WRITER_, scale and format RANGE_SCALE_ and RANGE_FORMAT_ values.
+ Returns false if scale or format isn't valid.
+ */
+bool range_sample_writer_init(range_sample_writer_t* writer, int kind, int scale, int format,
+                              range_writer_sink_t sink, void* sink_context);
+
+/*
+ Writes count more samples. Returns false if the sink failed.
+ */
+bool range_sample_writer_write(range_sample_writer_t* writer, const range_sample_t* samples, int count);
+
+/*
+ The same, for samples kept as separate time and temperature arrays (like the chunks of a range_store_t).
+ */
+bool range_sample_writer_write_columns(range_sample_writer_t* writer, const double* times, const float* temperatures,
+                                       int count);
+
+/*
+ Closes the text (writing the header or the brackets of an empty file if needed) and hands the rest to the sink.
+ Returns false if the sink failed.
+ */
+bool range_sample_writer_finish(range_sample_writer_t* writer);
+
+#endif /* RangeSampleWriter_h */
@@ -0,0 +1,70 @@
+//
+//  RangeSignalAudioInput.h
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "RangeDataManager.h"
+#import "RangeSampleRing.h"
+#import "RangeSignalDecoder.h"
+
+/*!
+ Records from the microphone and decodes with RangeSignalDecoder, with the same methods as RangeAudioInput.
+ It only records: the AudioQueue callback hands each buffer to the decoder,
+ and every decoded sample goes into sampleRing.
+ Development tooling, not part of the plugin: RangeSignalDecoder's protocol is a placeholder,
+ so this can't hear shipping Ranges yet. A test app can create one and pop its sampleRing.
+ 
+ It is unnecessary for the SDK end-user to directly use this class.
+ */
+@interface RangeSignalAudioInput : NSObject
+
+/*!
+ Samples are handed over through sampleRing, so these are always empty.
+ They are here so the class can stand in for RangeAudioInput.
+ */
+- (RangeDataManager*) allTemperatures;
+- (RangeDataManager*) allTemperaturesSample;
+- (RangeDataManager*) sampleTemperatureCurve;
+
+/*!
+ Start the audio data aquisition.
+ */
+- (void) startRec;
+
+/*!
+ Pause the audio data aquisition.
+ */
+- (void) pauseRec;
+
+/*!
+ Destroys all state related to this object. The underlying AudioQueues require us to use global resources.
+ We can't rely on dealloc to do things in the proper order.
+ */
+-(void) immediateDestroyState;
+
+/*!
+ The ring the decoder pushes every decoded sample into.
+ Only refreshRangeDataManager should pop from it.
+ */
+- (range_ring_t *) sampleRing;
+
+/*!
+ NSDate of the last time we have properly parsed any data.
+ */
+@property (strong, readonly) NSDate* lastParsedDataRead;
+
+@end
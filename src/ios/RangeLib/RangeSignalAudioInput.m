@@ -0,0 +1,215 @@
+//
+//  RangeSignalAudioInput.m
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "RangeSignalAudioInput.h"
+#import <AudioToolbox/AudioToolbox.h>
+#include <stdatomic.h>
+
+#define kRSAINumberOfBuffers 3
+// About 23ms of audio per buffer at 44.1kHz.
+#define kRSAIBufferFrames 1024
+// Room for a couple of minutes of samples if nobody refreshes.
+#define kRSAIRingCapacity 4096
+
+// Everything the audio thread touches. Plain C, so the callbacks never send a message.
+typedef struct {
+    range_signal_decoder_t decoder;
+    bool decoder_ready;
+    range_ring_t ring;
+    bool ring_ready;
+    // Time (since 1970) the last sample was decoded. Written on the audio thread.
+    _Atomic double last_parsed_time;
+    // Set by pauseRec. The audio thread resets the decoder before the next buffer.
+    _Atomic bool reset_requested;
+} rsai_state_t;
+
+@interface RangeSignalAudioInput()
+{
+    AudioQueueRef _queue;
+    AudioQueueBufferRef _buffers[kRSAINumberOfBuffers];
+    rsai_state_t _state;
+}
+
+@end
+
+static double rsai_now(void)
+{
+    return CFAbsoluteTimeGetCurrent() + kCFAbsoluteTimeIntervalSince1970;
+}
+
+// Decoder sink. Runs on the audio thread, so it only touches the ring and an atomic.
+static void rsai_sample_decoded(void* context, const range_uid_t* uid, range_sample_t sample)
+{
+    rsai_state_t* state = context;
+    range_ring_entry_t entry;
+    entry.sample = sample;
+    entry.uid = *uid;
+    range_ring_push(&state->ring, &entry);
+    atomic_store_explicit(&state->last_parsed_time, sample.unix_time, memory_order_relaxed);
+}
+
+// Runs on the queue's own thread. Only touches the state the object handed it.
+static void rsai_input_callback(void* userData, AudioQueueRef queue, AudioQueueBufferRef buffer,
+                                const AudioTimeStamp* startTime, UInt32 packetCount,
+                                const AudioStreamPacketDescription* packetDescriptions)
+{
+    rsai_state_t* state = userData;
+    UInt32 frames = buffer->mAudioDataByteSize / sizeof(float);
+    if(atomic_exchange_explicit(&state->reset_requested, false, memory_order_acquire))
+    {
+        range_signal_decoder_reset(&state->decoder);
+    }
+    if(frames > 0)
+    {
+        // The buffer ends about now.
+        double firstSampleTime = rsai_now() - frames / RANGE_SIGNAL_SAMPLE_RATE;
+        range_signal_decoder_push(&state->decoder, (const float*)buffer->mAudioData, (int)frames, firstSampleTime);
+    }
+    AudioQueueEnqueueBuffer(queue, buffer, 0, NULL);
+}
+
+
+@implementation RangeSignalAudioInput
+
+- (instancetype) init
+{
+    if (self = [super init])
+    {
+        _state.ring_ready = range_ring_init(&_state.ring, kRSAIRingCapacity);
+        _state.decoder_ready = range_signal_decoder_init(&_state.decoder, NULL, rsai_sample_decoded, &_state);
+        atomic_init(&_state.last_parsed_time, 0.0);
+        atomic_init(&_state.reset_requested, false);
+        if(!_state.ring_ready || !_state.decoder_ready)
+        {
+            NSLog(@"RDC - Out of memory.");
+            [self immediateDestroyState];
+            return nil;
+        }
+
+        AudioStreamBasicDescription format;
+        memset(&format, 0, sizeof(format));
+        format.mSampleRate = RANGE_SIGNAL_SAMPLE_RATE;
+        format.mFormatID = kAudioFormatLinearPCM;
+        format.mFormatFlags = kAudioFormatFlagIsFloat | kAudioFormatFlagIsPacked;
+        format.mChannelsPerFrame = 1;
+        format.mBitsPerChannel = 32;
+        format.mBytesPerFrame = sizeof(float);
+        format.mFramesPerPacket = 1;
+        format.mBytesPerPacket = sizeof(float);
+
+        // The callback runs on the queue's own thread, not the main run loop, so decoding never waits on the UI.
+        OSStatus status = AudioQueueNewInput(&format, rsai_input_callback, &_state,
+                                             NULL, NULL, 0, &_queue);
+        if(status != noErr)
+        {
+            NSLog(@"%s - AudioQueueNewInput failed: %@", __PRETTY_FUNCTION__,
+                  [NSError errorWithDomain:NSOSStatusErrorDomain code:status userInfo:nil]);
+            [self immediateDestroyState];
+            return nil;
+        }
+
+        for(int i = 0; i < kRSAINumberOfBuffers; i++)
+        {
+            AudioQueueAllocateBuffer(_queue, kRSAIBufferFrames * sizeof(float), &_buffers[i]);
+            AudioQueueEnqueueBuffer(_queue, _buffers[i], 0, NULL);
+        }
+
+        return self;
+    } else {
+        return nil;
+    }
+}
+
+- (void) dealloc
+{
+    [self immediateDestroyState];
+}
+
+-(void) immediateDestroyState
+{
+    if(_queue != NULL)
+    {
+        AudioQueueStop(_queue, true);
+        AudioQueueDispose(_queue, true);
+        _queue = NULL;
+    }
+    if(_state.decoder_ready)
+    {
+        range_signal_decoder_destroy(&_state.decoder);
+        _state.decoder_ready = false;
+    }
+    if(_state.ring_ready)
+    {
+        range_ring_destroy(&_state.ring);
+        _state.ring_ready = false;
+    }
+}
+
+- (range_ring_t *) sampleRing
+{
+    return _state.ring_ready ? &_state.ring : NULL;
+}
+
+- (NSDate*) lastParsedDataRead
+{
+    double time = atomic_load_explicit(&_state.last_parsed_time, memory_order_relaxed);
+    return time > 0.0 ? [NSDate dateWithTimeIntervalSince1970:time] : nil;
+}
+
+- (RangeDataManager*) allTemperatures
+{
+    return [[RangeDataManager alloc] init];
+}
+
+- (RangeDataManager*) allTemperaturesSample
+{
+    return [[RangeDataManager alloc] init];
+}
+
+- (RangeDataManager*) sampleTemperatureCurve
+{
+    return [[RangeDataManager alloc] init];
+}
+
+- (void) startRec
+{
+    if(_queue == NULL)
+    {
+        return;
+    }
+    OSStatus status = AudioQueueStart(_queue, NULL);
+    if(status != noErr)
+    {
+        NSLog(@"%s - AudioQueueStart failed: %d", __PRETTY_FUNCTION__, (int)status);
+    }
+}
+
+- (void) pauseRec
+{
+    if(_queue == NULL)
+    {
+        return;
+    }
+    AudioQueuePause(_queue);
+    // The next buffer won't follow on from the last one. The callback may still be running on the
+    // queue's thread, so it does the reset itself.
+    atomic_store_explicit(&_state.reset_requested, true, memory_order_release);
+}
+
+@end
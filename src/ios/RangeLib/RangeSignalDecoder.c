@@ -0,0 +1,452 @@
+//
+//  RangeSignalDecoder.c
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "RangeSignalDecoder.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// PCM samples handled per pass. The tone tables and product arrays are this long.
+#define RSD_BLOCK 256
+
+// The sliding sums are added up again from the history this often, so rounding errors can't build up.
+#define RSD_RESUM_INTERVAL 65536
+
+// Bits of mark that have to come before a start bit (see rsd_bit_sample). Between two bytes there can be as little
+// as one (a stop bit after a 0), so half a bit leaves room for noise at both ends of it.
+#define RSD_MIN_MARK_BITS 0.5
+
+// M_PI isn't there in strict C builds.
+#define RSD_TWO_PI 6.283185307179586476925
+
+enum {
+    RSD_MARK_I,
+    RSD_MARK_Q,
+    RSD_SPACE_I,
+    RSD_SPACE_Q
+};
+
+#pragma mark - framing
+
+static uint8_t rsd_crc8(const uint8_t* bytes, int length)
+{
+    uint8_t crc = 0;
+    for(int i = 0; i < length; i++)
+    {
+        crc ^= bytes[i];
+        for(int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+// Bytes in a frame whose uid is uid_length long.
+static int rsd_frame_length(int uid_length)
+{
+    return 2 + uid_length + 2 + 1;
+}
+
+static double rsd_time_of(const range_signal_decoder_t* decoder, uint64_t sample)
+{
+    return decoder->anchor_time + ((double)sample - (double)decoder->anchor_sample) / decoder->config.sample_rate;
+}
+
+static void rsd_frame_byte(range_signal_decoder_t* decoder, uint8_t byte, uint64_t sample)
+{
+    if(decoder->frame_length == 0)
+    {
+        if(byte == RANGE_SIGNAL_SYNC_BYTE)
+        {
+            decoder->frame[decoder->frame_length++] = byte;
+        }
+        return;
+    }
+
+    decoder->frame[decoder->frame_length++] = byte;
+    int uid_length = decoder->frame[1];
+    if(uid_length < 1 || uid_length > RANGE_UID_MAX_BYTES)
+    {
+        // Not a frame after all. The byte might start the real one.
+        decoder->frames_rejected++;
+        decoder->frame_length = 0;
+        if(byte == RANGE_SIGNAL_SYNC_BYTE)
+        {
+            decoder->frame[decoder->frame_length++] = byte;
+        }
+        return;
+    }
+
+    int length = rsd_frame_length(uid_length);
+    if(decoder->frame_length < length)
+    {
+        return;
+    }
+    decoder->frame_length = 0;
+
+    const uint8_t* frame = decoder->frame;
+    if(rsd_crc8(frame + 1, length - 2) != frame[length - 1])
+    {
+        decoder->frames_rejected++;
+        return;
+    }
+
+    range_uid_t uid;
+    memset(&uid, 0, sizeof(uid));
+    uid.length = uid_length;
+    memcpy(uid.bytes, frame + 2, uid_length);
+
+    int16_t tenths = (int16_t)(frame[2 + uid_length] | (frame[3 + uid_length] << 8));
+    range_sample_t output;
+    output.temperature = (float)tenths / 10.0f;
+    output.unix_time = rsd_time_of(decoder, sample);
+
+    decoder->frames_decoded++;
+    if(decoder->sink != NULL)
+    {
+        decoder->sink(decoder->sink_context, &uid, output);
+    }
+}
+
+#pragma mark - bits
+
+// One correlator output. mark_wins is whether the mark tone is stronger over the last bit of samples.
+static void rsd_bit_sample(range_signal_decoder_t* decoder, uint64_t sample, bool heard, bool mark_wins)
+{
+    if(!heard)
+    {
+        // Silence (or unplugged) drops whatever was half way through.
+        decoder->mark_run = 0;
+        decoder->in_byte = false;
+        decoder->frame_length = 0;
+        return;
+    }
+
+    int mark_run = decoder->mark_run;
+    decoder->mark_run = mark_wins ? mark_run + 1 : 0;
+
+    if(!decoder->in_byte)
+    {
+        // In noise space can win for a few samples anywhere in a stretch of mark. Only a mark to space
+        // change after a good run of mark (idle, or the stop bit and what is left of the bit before) starts a byte.
+        if(!mark_wins && mark_run >= decoder->min_mark_run)
+        {
+            // Mark to space: the window is about half way into a start bit.
+            // Each bit is read when the window lines up with it, half a bit later.
+            decoder->in_byte = true;
+            decoder->bit_index = 0;
+            decoder->byte_value = 0;
+            decoder->byte_start_sample = sample;
+            decoder->next_bit_sample = sample + (uint64_t)llround(decoder->bit_period * 0.5);
+        }
+        return;
+    }
+
+    if(sample != decoder->next_bit_sample)
+    {
+        return;
+    }
+
+    int bit = decoder->bit_index++;
+    decoder->next_bit_sample = decoder->byte_start_sample + (uint64_t)llround(decoder->bit_period * (decoder->bit_index + 0.5));
+
+    if(bit == 0)
+    {
+        if(mark_wins)
+        {
+            // A glitch, not a start bit.
+            decoder->in_byte = false;
+        }
+    }
+    else if(bit <= 8)
+    {
+        decoder->byte_value |= (mark_wins ? 1 : 0) << (bit - 1);
+    } else {
+        decoder->in_byte = false;
+        if(mark_wins)
+        {
+            rsd_frame_byte(decoder, (uint8_t)decoder->byte_value, sample);
+        } else {
+            // No stop bit. Whatever frame this was part of is lost.
+            decoder->frame_length = 0;
+        }
+    }
+}
+
+#pragma mark - tones
+
+static void rsd_resum(range_signal_decoder_t* decoder)
+{
+    for(int k = 0; k < 4; k++)
+    {
+        double sum = 0.0;
+        for(int i = 0; i < decoder->bit_length; i++)
+        {
+            sum += decoder->history[k][i];
+        }
+        decoder->sums[k] = sum;
+    }
+    decoder->samples_since_resum = 0;
+}
+
+// Phase of a tone at the first sample of the next block, as cos / sin.
+static void rsd_block_phase(const range_signal_decoder_t* decoder, double frequency, float* cos_out, float* sin_out)
+{
+    double cycles = frequency * (double)decoder->sample_count / decoder->config.sample_rate;
+    double phase = RSD_TWO_PI * (cycles - floor(cycles));
+    *cos_out = (float)cos(phase);
+    *sin_out = (float)sin(phase);
+}
+
+// products = pcm * cos/sin(phase + w n), using cos(a + b) = cos a cos b - sin a sin b (and the same for sin).
+static void rsd_correlate(const float* pcm, int count, const float* table_cos, const float* table_sin,
+                          float phase_cos, float phase_sin, float* i_out, float* q_out)
+{
+    for(int n = 0; n < count; n++)
+    {
+        i_out[n] = pcm[n] * (phase_cos * table_cos[n] - phase_sin * table_sin[n]);
+        q_out[n] = pcm[n] * (phase_sin * table_cos[n] + phase_cos * table_sin[n]);
+    }
+}
+
+#pragma mark - public
+
+void range_signal_default_config(range_signal_config_t* config_out)
+{
+    config_out->sample_rate = RANGE_SIGNAL_SAMPLE_RATE;
+    config_out->baud_rate = RANGE_SIGNAL_BAUD_RATE;
+    config_out->mark_frequency = RANGE_SIGNAL_MARK_FREQUENCY;
+    config_out->space_frequency = RANGE_SIGNAL_SPACE_FREQUENCY;
+    config_out->squelch_energy = 1e-4;
+}
+
+bool range_signal_decoder_init(range_signal_decoder_t* decoder, const range_signal_config_t* config,
+                               range_signal_sink_t sink, void* sink_context)
+{
+    memset(decoder, 0, sizeof(range_signal_decoder_t));
+    if(config != NULL)
+    {
+        decoder->config = *config;
+    } else {
+        range_signal_default_config(&decoder->config);
+    }
+    decoder->sink = sink;
+    decoder->sink_context = sink_context;
+
+    const range_signal_config_t* c = &decoder->config;
+    if(!(c->sample_rate > 0.0) || !(c->baud_rate > 0.0) || c->baud_rate * 4.0 > c->sample_rate ||
+       !(c->mark_frequency > 0.0) || !(c->space_frequency > 0.0) ||
+       c->mark_frequency * 2.0 >= c->sample_rate || c->space_frequency * 2.0 >= c->sample_rate)
+    {
+        return false;
+    }
+
+    decoder->bit_period = c->sample_rate / c->baud_rate;
+    decoder->bit_length = (int)lround(decoder->bit_period);
+    decoder->min_mark_run = (int)lround(decoder->bit_period * RSD_MIN_MARK_BITS);
+
+    decoder->mark_cos = malloc(sizeof(float) * RSD_BLOCK);
+    decoder->mark_sin = malloc(sizeof(float) * RSD_BLOCK);
+    decoder->space_cos = malloc(sizeof(float) * RSD_BLOCK);
+    decoder->space_sin = malloc(sizeof(float) * RSD_BLOCK);
+    bool allocated = decoder->mark_cos != NULL && decoder->mark_sin != NULL &&
+                     decoder->space_cos != NULL && decoder->space_sin != NULL;
+    for(int k = 0; k < 4; k++)
+    {
+        decoder->products[k] = malloc(sizeof(float) * RSD_BLOCK);
+        decoder->history[k] = calloc(decoder->bit_length, sizeof(float));
+        allocated = allocated && decoder->products[k] != NULL && decoder->history[k] != NULL;
+    }
+    if(!allocated)
+    {
+        range_signal_decoder_destroy(decoder);
+        return false;
+    }
+
+    for(int n = 0; n < RSD_BLOCK; n++)
+    {
+        double mark = RSD_TWO_PI * c->mark_frequency * n / c->sample_rate;
+        double space = RSD_TWO_PI * c->space_frequency * n / c->sample_rate;
+        decoder->mark_cos[n] = (float)cos(mark);
+        decoder->mark_sin[n] = (float)sin(mark);
+        decoder->space_cos[n] = (float)cos(space);
+        decoder->space_sin[n] = (float)sin(space);
+    }
+
+    range_signal_decoder_reset(decoder);
+    return true;
+}
+
+void range_signal_decoder_destroy(range_signal_decoder_t* decoder)
+{
+    free(decoder->mark_cos);
+    free(decoder->mark_sin);
+    free(decoder->space_cos);
+    free(decoder->space_sin);
+    for(int k = 0; k < 4; k++)
+    {
+        free(decoder->products[k]);
+        free(decoder->history[k]);
+    }
+    memset(decoder, 0, sizeof(range_signal_decoder_t));
+}
+
+void range_signal_decoder_reset(range_signal_decoder_t* decoder)
+{
+    for(int k = 0; k < 4; k++)
+    {
+        memset(decoder->history[k], 0, sizeof(float) * decoder->bit_length);
+        decoder->sums[k] = 0.0;
+    }
+    decoder->history_position = 0;
+    decoder->samples_since_resum = 0;
+    decoder->sample_count = 0;
+    decoder->anchor_sample = 0;
+    decoder->anchor_time = 0.0;
+    decoder->mark_run = 0;
+    decoder->in_byte = false;
+    decoder->frame_length = 0;
+}
+
+void range_signal_decoder_push(range_signal_decoder_t* decoder, const float* pcm, int count, double first_sample_time)
+{
+    if(!isnan(first_sample_time))
+    {
+        decoder->anchor_sample = decoder->sample_count;
+        decoder->anchor_time = first_sample_time;
+    }
+
+    // Energies are compared against the squelch with the window sums, which scale with the window.
+    double squelch = decoder->config.squelch_energy * decoder->bit_length * decoder->bit_length;
+
+    while(count > 0)
+    {
+        int block = count < RSD_BLOCK ? count : RSD_BLOCK;
+
+        float phase_cos;
+        float phase_sin;
+        rsd_block_phase(decoder, decoder->config.mark_frequency, &phase_cos, &phase_sin);
+        rsd_correlate(pcm, block, decoder->mark_cos, decoder->mark_sin, phase_cos, phase_sin,
+                      decoder->products[RSD_MARK_I], decoder->products[RSD_MARK_Q]);
+        rsd_block_phase(decoder, decoder->config.space_frequency, &phase_cos, &phase_sin);
+        rsd_correlate(pcm, block, decoder->space_cos, decoder->space_sin, phase_cos, phase_sin,
+                      decoder->products[RSD_SPACE_I], decoder->products[RSD_SPACE_Q]);
+
+        for(int n = 0; n < block; n++)
+        {
+            int position = decoder->history_position;
+            for(int k = 0; k < 4; k++)
+            {
+                float product = decoder->products[k][n];
+                decoder->sums[k] += (double)product - (double)decoder->history[k][position];
+                decoder->history[k][position] = product;
+            }
+            decoder->history_position = position + 1 == decoder->bit_length ? 0 : position + 1;
+
+            double mark = decoder->sums[RSD_MARK_I] * decoder->sums[RSD_MARK_I] + decoder->sums[RSD_MARK_Q] * decoder->sums[RSD_MARK_Q];
+            double space = decoder->sums[RSD_SPACE_I] * decoder->sums[RSD_SPACE_I] + decoder->sums[RSD_SPACE_Q] * decoder->sums[RSD_SPACE_Q];
+            rsd_bit_sample(decoder, decoder->sample_count + n, mark + space > squelch, mark > space);
+        }
+
+        decoder->sample_count += block;
+        decoder->samples_since_resum += block;
+        if(decoder->samples_since_resum >= RSD_RESUM_INTERVAL)
+        {
+            rsd_resum(decoder);
+        }
+        pcm += block;
+        count -= block;
+    }
+}
+
+int range_signal_encode_frame(const range_signal_config_t* config, const range_uid_t* uid, float temperature,
+                              float amplitude, double* phase_inout, float* pcm_out, int capacity)
+{
+    range_signal_config_t defaults;
+    if(config == NULL)
+    {
+        range_signal_default_config(&defaults);
+        config = &defaults;
+    }
+    if(uid->length < 1 || uid->length > RANGE_UID_MAX_BYTES)
+    {
+        return 0;
+    }
+
+    uint8_t frame[RANGE_SIGNAL_MAX_FRAME];
+    int length = rsd_frame_length(uid->length);
+    long tenths = lroundf(temperature * 10.0f);
+    if(tenths > INT16_MAX)
+    {
+        tenths = INT16_MAX;
+    }
+    if(tenths < INT16_MIN)
+    {
+        tenths = INT16_MIN;
+    }
+    frame[0] = RANGE_SIGNAL_SYNC_BYTE;
+    frame[1] = (uint8_t)uid->length;
+    memcpy(frame + 2, uid->bytes, uid->length);
+    frame[2 + uid->length] = (uint8_t)((uint16_t)tenths & 0xFF);
+    frame[3 + uid->length] = (uint8_t)((uint16_t)tenths >> 8);
+    frame[length - 1] = rsd_crc8(frame + 1, length - 2);
+
+    // Two bits of idle mark, then 10 bits per byte.
+    double bit_period = config->sample_rate / config->baud_rate;
+    int bit_count = 2 + 10 * length;
+    int sample_count = (int)lround(bit_count * bit_period);
+    if(sample_count > capacity)
+    {
+        return 0;
+    }
+
+    double phase = *phase_inout;
+    for(int bit = 0; bit < bit_count; bit++)
+    {
+        bool mark = true;
+        int byte_bit = bit - 2;
+        if(byte_bit >= 0)
+        {
+            int position = byte_bit % 10;
+            if(position == 0)
+            {
+                mark = false;
+            }
+            else if(position <= 8)
+            {
+                mark = (frame[byte_bit / 10] >> (position - 1)) & 1;
+            }
+        }
+
+        double step = RSD_TWO_PI * (mark ? config->mark_frequency : config->space_frequency) / config->sample_rate;
+        int first = (int)lround(bit * bit_period);
+        int end = (int)lround((bit + 1) * bit_period);
+        for(int n = first; n < end; n++)
+        {
+            pcm_out[n] = amplitude * (float)sin(phase);
+            phase += step;
+        }
+        phase = fmod(phase, RSD_TWO_PI);
+    }
+
+    *phase_inout = phase;
+    return sample_count;
+}
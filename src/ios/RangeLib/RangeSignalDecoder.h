@@ -0,0 +1,154 @@
+//
+//  RangeSignalDecoder.h
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RangeSignalDecoder_h
+#define RangeSignalDecoder_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "RangeTypes.h"
+
+/*
+ Turns the audio coming back from a Range into samples. Plain C, so it builds and runs anywhere
+ (a Mac, Linux, a test harness) and not just inside an AudioQueue callback.
+
+ Push PCM in blocks of any size with range_signal_decoder_push. Every frame that decodes
+ is handed to the sink right away. All memory is allocated by range_signal_decoder_init,
+ so pushing never allocates or locks and is safe on a real time audio thread.
+
+ The signal is binary FSK sent as UART style bytes (1 start bit, 8 data bits LSB first, 1 stop bit,
+ mark while idle). Tones are detected with a sliding window correlator one bit long,
+ whose per sample products are worked out a block at a time in loops the compiler can vectorize.
+
+ The bytes make up frames of
+     RANGE_SIGNAL_SYNC_BYTE, uid length (1 to RANGE_UID_MAX_BYTES), uid, temperature (int16, tenths of a degree F,
+     little endian), CRC-8 (polynomial 0x07) of everything after the sync byte.
+
+ NOTE: this protocol is a placeholder. The rates, tones and framing below are not what a shipping Range
+ sends; the real signal is only decoded by the decoder built into libRangeLib. This decoder only
+ understands its own range_signal_encode_frame, so it can't stand in for that one until it has been
+ matched against captures from real hardware. They are in range_signal_config_t so they can be
+ changed without touching the decoder.
+ Until then it is not part of the plugin. It and what is built on it (RangeSignalAudioInput, RangePcmReader,
+ RangeReplayStream, RangeDecodePool, RangeReplay) are development tooling for the benches and test apps.
+ */
+
+#define RANGE_SIGNAL_SAMPLE_RATE        44100.0
+#define RANGE_SIGNAL_BAUD_RATE          1225.0
+// Tones for 1 (mark) and 0 (space). Whole numbers of cycles per bit keep them orthogonal over one bit.
+#define RANGE_SIGNAL_MARK_FREQUENCY     4900.0
+#define RANGE_SIGNAL_SPACE_FREQUENCY    2450.0
+#define RANGE_SIGNAL_SYNC_BYTE          0xA5
+// Largest frame in bytes, sync byte included.
+#define RANGE_SIGNAL_MAX_FRAME          (4 + RANGE_UID_MAX_BYTES + 1)
+
+typedef struct {
+    double      sample_rate;
+    double      baud_rate;
+    double      mark_frequency;
+    double      space_frequency;
+    // Tone power (a quarter of the squared amplitude, for PCM in [-1, 1]) below which we treat the input as silence.
+    // The default of 1e-4 is a tone of about 2% of full scale.
+    double      squelch_energy;
+} range_signal_config_t;
+
+/*
+ Receives every decoded sample. Called on the thread that pushes.
+ */
+typedef void (*range_signal_sink_t)(void* context, const range_uid_t* uid, range_sample_t sample);
+
+typedef struct {
+    range_signal_config_t config;
+    range_signal_sink_t sink;
+    void*       sink_context;
+
+    // Samples per bit, and the (rounded) length of the correlator window.
+    double      bit_period;
+    int         bit_length;
+    // cos / sin of mark and space over one block, starting at phase 0.
+    float*      mark_cos;
+    float*      mark_sin;
+    float*      space_cos;
+    float*      space_sin;
+    // Per sample correlator products of the current block.
+    float*      products[4];
+    // The last bit_length products, for the sliding window sums.
+    float*      history[4];
+    double      sums[4];
+    int         history_position;
+    int         samples_since_resum;
+
+    // Count of samples pushed since init or reset, and the time of one of them.
+    uint64_t    sample_count;
+    uint64_t    anchor_sample;
+    double      anchor_time;
+
+    // UART state. A start bit only counts after mark has won for min_mark_run samples in a row.
+    int         min_mark_run;
+    int         mark_run;
+    bool        in_byte;
+    uint64_t    byte_start_sample;
+    uint64_t    next_bit_sample;
+    int         bit_index;
+    int         byte_value;
+
+    // Frame state.
+    uint8_t     frame[RANGE_SIGNAL_MAX_FRAME];
+    int         frame_length;
+
+    // Counters, for tuning.
+    uint64_t    frames_decoded;
+    uint64_t    frames_rejected;
+} range_signal_decoder_t;
+
+/*
+ The config we expect from a Range (the RANGE_SIGNAL_ defaults).
+ */
+void range_signal_default_config(range_signal_config_t* config_out);
+
+/*
+ config can be NULL for the defaults. sink is called with sink_context for every sample.
+ Returns false if the config makes no sense or we ran out of memory.
+ */
+bool range_signal_decoder_init(range_signal_decoder_t* decoder, const range_signal_config_t* config,
+                               range_signal_sink_t sink, void* sink_context);
+void range_signal_decoder_destroy(range_signal_decoder_t* decoder);
+
+/*
+ Forgets any half decoded frame and the sample clock, as if the decoder was just made. Doesn't allocate.
+ */
+void range_signal_decoder_reset(range_signal_decoder_t* decoder);
+
+/*
+ Decodes count mono PCM samples in [-1, 1].
+ first_sample_time is the time (since 1970) of pcm[0]. Pass NAN to carry on from the time of the previous block.
+ Sample times are the time of the end of the frame's last bit.
+ */
+void range_signal_decoder_push(range_signal_decoder_t* decoder, const float* pcm, int count, double first_sample_time);
+
+/*
+ Writes the PCM a Range would send for one frame (preceded by a bit of idle mark tone)
+ into pcm_out. phase_inout carries the tone phase from one call to the next so frames can be joined.
+ Used to make test signals.
+ Returns the number of samples written, or 0 if they would not fit in capacity.
+ */
+int range_signal_encode_frame(const range_signal_config_t* config, const range_uid_t* uid, float temperature,
+                              float amplitude, double* phase_inout, float* pcm_out, int capacity);
+
+#endif /* RangeSignalDecoder_h */
@@ -0,0 +1,141 @@
+//
+//  RangeTemperatureFormat.c
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "RangeTemperatureFormat.h"
+#include "RangeTemperatureKernels.h"
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Integers up to this go through the integer path (see the top of RangeTemperatureFormat.h).
+#define RTF_EXACT_LIMIT 1000000.0f
+#define RTF_TIME_EXACT_LIMIT 1e15
+// U+00BA, what printSample: has always put after human readable temperatures.
+#define RTF_DEGREE_SIGN "\xC2\xBA"
+
+static const float rtf_powers[] = { 1.0f, 10.0f, 100.0f, 1000.0f };
+
+// Writes value (>= 0) with decimals digits after the point.
+static int rtf_write_fixed(char* buffer, unsigned long long value, int decimals)
+{
+    char digits[24];
+    int count = 0;
+    do
+    {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while(value > 0 || count <= decimals);
+
+    int length = 0;
+    for(int i = count - 1; i >= 0; i--)
+    {
+        buffer[length++] = digits[i];
+        if(i == decimals && decimals > 0)
+        {
+            buffer[length++] = '.';
+        }
+    }
+    buffer[length] = '\0';
+    return length;
+}
+
+int range_format_decimals(int scale, int format)
+{
+    if(scale != RANGE_SCALE_KELVIN && scale != RANGE_SCALE_CELCIUS && scale != RANGE_SCALE_FAHRENHEIT)
+    {
+        return -1;
+    }
+    switch(format)
+    {
+        case RANGE_FORMAT_HUMAN_READABLE:
+            return 0;
+        case RANGE_FORMAT_HUMAN_READABLE_PRECISION:
+            return 1;
+        case RANGE_FORMAT_RAW_DATA:
+            return scale == RANGE_SCALE_FAHRENHEIT ? 1 : 2;
+        default:
+            return -1;
+    }
+}
+
+int range_format_decimal(char* buffer, float rounded, int decimals)
+{
+    if(decimals < 0 || decimals > 3)
+    {
+        return snprintf(buffer, RANGE_FORMAT_MAX_LENGTH, "%.*f", decimals < 0 ? 0 : decimals, rounded);
+    }
+    float scaled = roundf(rounded * rtf_powers[decimals]);
+    if(!(fabsf(scaled) < RTF_EXACT_LIMIT))
+    {
+        // NaN ends up here too.
+        return snprintf(buffer, RANGE_FORMAT_MAX_LENGTH, "%.*f", decimals, rounded);
+    }
+
+    int length = 0;
+    // printf keeps the sign of -0.0, and roundf hands those out for anything just under 0.
+    if(signbit(rounded))
+    {
+        buffer[length++] = '-';
+    }
+    return length + rtf_write_fixed(buffer + length, (unsigned long long)fabsf(scaled), decimals);
+}
+
+int range_format_time(char* buffer, double time)
+{
+    double scaled = time * 1000.0;
+    double milliseconds = round(scaled);
+    // The multiply rounds, so a time within rounding error of half a millisecond could go either way.
+    if(!(fabs(milliseconds) < RTF_TIME_EXACT_LIMIT) ||
+       fabs(fabs(scaled - milliseconds) - 0.5) <= fabs(scaled) * 4.0 * DBL_EPSILON)
+    {
+        return snprintf(buffer, RANGE_FORMAT_MAX_LENGTH, "%.3f", time);
+    }
+
+    int length = 0;
+    if(signbit(time))
+    {
+        buffer[length++] = '-';
+    }
+    return length + rtf_write_fixed(buffer + length, (unsigned long long)fabs(milliseconds), 3);
+}
+
+int range_format_temperature(char* buffer, float raw, int scale, int format)
+{
+    if(format != RANGE_FORMAT_RAW_DATA && format != RANGE_FORMAT_HUMAN_READABLE &&
+       format != RANGE_FORMAT_HUMAN_READABLE_PRECISION)
+    {
+        strcpy(buffer, "ErrorTemperatureFormat");
+        return (int)strlen(buffer);
+    }
+    int decimals = range_format_decimals(scale, format);
+    if(decimals < 0)
+    {
+        strcpy(buffer, "ErrorTemperatureScale");
+        return (int)strlen(buffer);
+    }
+
+    int length = range_format_decimal(buffer, range_translate_and_round_temperature(raw, scale, format), decimals);
+    if(format != RANGE_FORMAT_RAW_DATA)
+    {
+        memcpy(buffer + length, RTF_DEGREE_SIGN, sizeof(RTF_DEGREE_SIGN));
+        length += (int)sizeof(RTF_DEGREE_SIGN) - 1;
+    }
+    return length;
+}
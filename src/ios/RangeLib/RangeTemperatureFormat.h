@@ -0,0 +1,62 @@
+//
+//  RangeTemperatureFormat.h
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RangeTemperatureFormat_h
+#define RangeTemperatureFormat_h
+
+#include <stddef.h>
+
+/*
+ Printing temperatures and times without allocating or parsing a format string.
+
+ A rounded temperature is roundf(t * p) / p (see RangeTemperatureKernels), so its digits are the
+ integer roundf(t * p) with a decimal point put in. That is what "%.*f" would print for it too,
+ as long as the float is close enough to the decimal value: below a million in the last digit it
+ always is. Anything bigger, and NaN and infinities, go through snprintf so the text never differs.
+
+ The buffers are plain bytes, UTF-8, null terminated. RANGE_FORMAT_MAX_LENGTH is always enough.
+ */
+
+#define RANGE_FORMAT_MAX_LENGTH 64
+
+/*
+ Digits after the decimal point printSample:withFormat:withScale: shows for scale and format
+ (RANGE_SCALE_ and RANGE_FORMAT_ values). -1 if either isn't valid.
+ */
+int range_format_decimals(int scale, int format);
+
+/*
+ Writes rounded with decimals digits after the point, like "%.*f". Returns the length.
+ rounded has to be rounded to decimals already (range_translate_and_round_temperature);
+ halfway values would round away from zero here where printf rounds them to even.
+ */
+int range_format_decimal(char* buffer, float rounded, int decimals);
+
+/*
+ Writes a time like "%.3f". Returns the length.
+ */
+int range_format_time(char* buffer, double time);
+
+/*
+ Writes the same text printSample:withFormat:withScale: returns for a raw temperature,
+ degree sign and error strings included. Returns the length.
+ */
+int range_format_temperature(char* buffer, float raw, int scale, int format);
+
+#endif /* RangeTemperatureFormat_h */
@@ -0,0 +1,136 @@
+//
+//  RangeTemperatureKernels.c
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "RangeTemperatureKernels.h"
+#include <math.h>
+
+// The expressions are written out the way RangeTemperatureTranslator always had them;
+// (t - 32) * 5 / 9 and (t - 32) * (5 / 9) don't round the same.
+static inline float rtk_celcius(float raw)
+{
+    return (raw - 32.0f) * 5.0f/9.0f;
+}
+
+static inline float rtk_kelvin(float raw)
+{
+    return ((raw - 32.0f) * (5.0f/9.0f)) + 273.15f;
+}
+
+static inline float rtk_round(float translated, float precision)
+{
+    return roundf(translated * precision) / precision;
+}
+
+float range_translate_temperature(float raw, int scale)
+{
+    switch(scale)
+    {
+        case RANGE_SCALE_KELVIN:
+            return rtk_kelvin(raw);
+        case RANGE_SCALE_CELCIUS:
+            return rtk_celcius(raw);
+        case RANGE_SCALE_FAHRENHEIT:
+            return raw;
+        default:
+            return 0.0f;
+    }
+}
+
+float range_rounding_precision(int scale, int format)
+{
+    if(scale != RANGE_SCALE_KELVIN && scale != RANGE_SCALE_CELCIUS && scale != RANGE_SCALE_FAHRENHEIT)
+    {
+        return 0.0f;
+    }
+    switch(format)
+    {
+        case RANGE_FORMAT_HUMAN_READABLE:
+            // nearest degree (Celcius and Kelvin used to be to the tenth)
+            return 1.0f;
+        case RANGE_FORMAT_HUMAN_READABLE_PRECISION:
+            // nearest tenth of a degree
+            return 10.0f;
+        case RANGE_FORMAT_RAW_DATA:
+            // nearest hundreth of a degree, tenth for Fahrenheit
+            return scale == RANGE_SCALE_FAHRENHEIT ? 10.0f : 100.0f;
+        default:
+            return 0.0f;
+    }
+}
+
+float range_translate_and_round_temperature(float raw, int scale, int format)
+{
+    float precision = range_rounding_precision(scale, format);
+    if(precision == 0.0f)
+    {
+        return NAN;
+    }
+    return rtk_round(range_translate_temperature(raw, scale), precision);
+}
+
+void range_translate_temperatures(const float* raw, float* out, int count, int scale)
+{
+    switch(scale)
+    {
+        case RANGE_SCALE_KELVIN:
+            for(int i = 0; i < count; i++)
+            {
+                out[i] = rtk_kelvin(raw[i]);
+            }
+            break;
+        case RANGE_SCALE_CELCIUS:
+            for(int i = 0; i < count; i++)
+            {
+                out[i] = rtk_celcius(raw[i]);
+            }
+            break;
+        case RANGE_SCALE_FAHRENHEIT:
+            for(int i = 0; i < count; i++)
+            {
+                out[i] = raw[i];
+            }
+            break;
+        default:
+            for(int i = 0; i < count; i++)
+            {
+                out[i] = 0.0f;
+            }
+            break;
+    }
+}
+
+void range_translate_and_round_temperatures(const float* raw, float* out, int count, int scale, int format)
+{
+    float precision = range_rounding_precision(scale, format);
+    if(precision == 0.0f)
+    {
+        for(int i = 0; i < count; i++)
+        {
+            out[i] = NAN;
+        }
+        return;
+    }
+
+    range_translate_temperatures(raw, out, count, scale);
+    // roundf(t * 1) / 1 is roundf(t), so the human readable format needs no loop of its own.
+    for(int i = 0; i < count; i++)
+    {
+        out[i] = rtk_round(out[i], precision);
+    }
+}
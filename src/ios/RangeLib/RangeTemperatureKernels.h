@@ -0,0 +1,63 @@
+//
+//  RangeTemperatureKernels.h
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RangeTemperatureKernels_h
+#define RangeTemperatureKernels_h
+
+#include <stdbool.h>
+
+/*
+ The arithmetic behind RangeTemperatureTranslator, on one temperature or a whole array of them.
+
+ The array versions work out the scale and format once and then run one loop with no branches and
+ no calls but roundf, which the compiler vectorizes (roundf is a single instruction on ARMv8).
+ They use exactly the same float expressions as the single temperature versions, so a graph drawn
+ from them matches labels printed one at a time to the bit. out may be the same array as raw.
+ */
+
+// The same values as RangeTemperatureScale.
+#define RANGE_SCALE_FAHRENHEIT      0
+#define RANGE_SCALE_CELCIUS         1
+#define RANGE_SCALE_KELVIN          2
+
+// The same values as RangeTemperaturePrintFormat.
+#define RANGE_FORMAT_RAW_DATA                   0
+#define RANGE_FORMAT_HUMAN_READABLE             1
+#define RANGE_FORMAT_HUMAN_READABLE_PRECISION   2
+
+/*
+ A raw temperature (degrees F) in scale. 0 if scale isn't one of RANGE_SCALE_.
+ */
+float range_translate_temperature(float raw, int scale);
+
+/*
+ What a rounded temperature in scale is a multiple of the inverse of (1, 10 or 100), for format.
+ 0 if either isn't valid.
+ */
+float range_rounding_precision(int scale, int format);
+
+/*
+ A raw temperature in scale, rounded for format. NAN if either isn't valid.
+ */
+float range_translate_and_round_temperature(float raw, int scale, int format);
+
+void range_translate_temperatures(const float* raw, float* out, int count, int scale);
+void range_translate_and_round_temperatures(const float* raw, float* out, int count, int scale, int format);
+
+#endif /* RangeTemperatureKernels_h */
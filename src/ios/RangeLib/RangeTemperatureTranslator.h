@@ -18,6 +18,7 @@
 // limitations under the License.
 
 #import <Foundation/Foundation.h>
+#import "RangeTemperatureFormat.h"
 
 //==================================================================================================
 #pragma mark    RangeTemperature Scales
@@ -173,6 +174,38 @@ typedef NS_ENUM(UInt32, RangeTemperaturePrintFormat) {
  */
 - (float) translateAndRoundSample: (float) rawSample withFormat: (RangeTemperaturePrintFormat) formatType toScale: (RangeTemperatureScale) scaleType;
 
+#pragma mark - Array functions
+
+/*!
+ Translate count raw temperatures to the current temperature scale at once, for a whole graph series.
+ The current scale is read once, and the values match translateSample: exactly.
+ 
+ @param rawSamples
+ The raw temperature values to be converted.
+ 
+ @param output
+ Gets the count translated values. Can be rawSamples itself.
+ */
+- (void) translateSamples: (const float*) rawSamples count: (int) count output: (float*) output;
+
+/*!
+ Translate count raw temperatures to scaleType at once. The values match translateSample:toScale: exactly.
+ */
+- (void) translateSamples: (const float*) rawSamples count: (int) count toScale: (RangeTemperatureScale) scaleType output: (float*) output;
+
+/*!
+ Translate and round count raw temperatures to the current temperature scale at once.
+ The values match translateAndRoundSample:withFormat: exactly.
+ */
+- (void) translateAndRoundSamples: (const float*) rawSamples count: (int) count withFormat: (RangeTemperaturePrintFormat) formatType output: (float*) output;
+
+/*!
+ Translate and round count raw temperatures to scaleType at once.
+ The values match translateAndRoundSample:withFormat:toScale: exactly.
+ */
+- (void) translateAndRoundSamples: (const float*) rawSamples count: (int) count withFormat: (RangeTemperaturePrintFormat) formatType
+                          toScale: (RangeTemperatureScale) scaleType output: (float*) output;
+
 #pragma mark - String output functions
 
 /*!
@@ -204,4 +237,16 @@ typedef NS_ENUM(UInt32, RangeTemperaturePrintFormat) {
  */
 - (NSString *) printSample:(float) rawSample withFormat: (RangeTemperaturePrintFormat) formatType withScale: (RangeTemperatureScale) scaleType;
 
+/*!
+ The same text as printSample:withFormat:withScale:, written into a buffer instead of a new NSString.
+ Nothing is allocated, so it can be called for every cell of a big table.
+ 
+ @param buffer
+ Gets the text, UTF-8 and null terminated. Must have room for RANGE_FORMAT_MAX_LENGTH bytes.
+ 
+ @return The length of the text in bytes.
+ */
+- (int) printSample:(float) rawSample withFormat: (RangeTemperaturePrintFormat) formatType withScale: (RangeTemperatureScale) scaleType
+           toBuffer: (char*) buffer;
+
 @end
@@ -22,10 +22,13 @@
 #endif
 
 #import "RangeTemperatureTranslator.h"
+#import "RangeTemperatureKernels.h"
+#include <stdatomic.h>
 
 @interface RangeTemperatureTranslator()
 {
-    RangeTemperatureScale _currentScale;
+    // A RangeTemperatureScale. Read on every translation, from any thread, so it isn't behind a lock.
+    atomic_uint _currentScale;
 }
 
 @end
@@ -49,7 +52,7 @@
 - (instancetype)init
 {
     if ( self = [super init] ) {
-        _currentScale = kRangeTemperatureScaleFahrenheit;
+        atomic_init(&_currentScale, kRangeTemperatureScaleFahrenheit);
         
         return self;
     } else {
@@ -60,43 +63,23 @@
 #pragma mark - Scale functions
 - (RangeTemperatureScale) currentScale
 {
-    @synchronized(self)
-    {
-        return _currentScale;
-    }
+    return (RangeTemperatureScale) atomic_load_explicit(&_currentScale, memory_order_relaxed);
 }
 
 - (void) setCurrentScale:(RangeTemperatureScale) scaleType
 {
-    @synchronized(self)
-    {
-        _currentScale = scaleType;
-    }
+    atomic_store_explicit(&_currentScale, scaleType, memory_order_relaxed);
 }
 
 #pragma mark - Translation functions
 - (float) translateSample: (float) rawSample
 {
-    return [self translateSample:rawSample toScale:_currentScale];
+    return [self translateSample:rawSample toScale:self.currentScale];
 }
 
 - (float) translateSample: (float) rawSample toScale: (RangeTemperatureScale) scaleType
 {
-    switch (scaleType) {
-        case kRangeTemperatureScaleKelvin:
-            return ((rawSample - 32.0f) * (5.0f/9.0f)) + 273.15f;
-            break;
-        case kRangeTemperatureScaleCelcius:
-            return (rawSample - 32.0f) * 5.0f/9.0f;
-            break;
-        case kRangeTemperatureScaleFahrenheit:
-            return rawSample;
-            break;
-        default:
-            // ERROR
-            return 0.0f;
-            break;
-    }
+    return range_translate_temperature(rawSample, (int) scaleType);
 }
 
 - (float) translateToRawSampleOtherSample: (float) otherScaleSample fromScale:(RangeTemperatureScale) startingScaleType
@@ -127,77 +110,35 @@
 #pragma mark - Rounding functions
 - (float) translateAndRoundSample: (float) rawSample withFormat: (RangeTemperaturePrintFormat) formatType
 {
-    return [self translateAndRoundSample:rawSample withFormat:formatType toScale:_currentScale];
+    return [self translateAndRoundSample:rawSample withFormat:formatType toScale:self.currentScale];
 }
 
 - (float) translateAndRoundSample: (float) rawSample withFormat: (RangeTemperaturePrintFormat) formatType toScale: (RangeTemperatureScale) scaleType
 {
-    float translatedSample = [self translateSample:rawSample toScale:scaleType];
-    
-    switch (formatType) {
-        case kRangeTemperaturePrintFormatHumanReadable:
-        {
-            switch (scaleType) {
-                case kRangeTemperatureScaleKelvin:
-                case kRangeTemperatureScaleCelcius:
-                    // round to the nearest tenth of a degree
-//                    return roundf(translatedSample * 10.0f) / 10.0f;
-                    return roundf(translatedSample);
-                    break;
-                case kRangeTemperatureScaleFahrenheit:
-                    // round to the nearest degree
-                    return roundf(translatedSample);
-                    break;
-                default:
-                    // ERROR
-                    return NAN;
-                    break;
-            }
-        }
-            break;
-        case kRangeTemperaturePrintFormatHumanReadablePrecision:
-        {
-            switch (scaleType) {
-                case kRangeTemperatureScaleKelvin:
-                case kRangeTemperatureScaleCelcius:
-                    // round to the nearest tenth of a degree
-                    return roundf(translatedSample * 10.0f) / 10.0f;
-                    break;
-                case kRangeTemperatureScaleFahrenheit:
-                    // round to the nearest tenth of a degree
-                    return roundf(translatedSample * 10.0f) / 10.0f;
-                    break;
-                default:
-                    // ERROR
-                    return NAN;
-                    break;
-            }
-        }
-            break;
-        case kRangeTemperaturePrintFormatRawData:
-        {
-            switch (scaleType) {
-                case kRangeTemperatureScaleKelvin:
-                case kRangeTemperatureScaleCelcius:
-                    // round to the nearest hundreth of a degree
-                    return roundf(translatedSample * 100.0f) / 100.0f;
-                    break;
-                case kRangeTemperatureScaleFahrenheit:
-                    // round to the nearest tenth of a degree
-                    return roundf(translatedSample * 10.0f) / 10.0f;
-                    break;
-                default:
-                    // ERROR
-                    return NAN;
-                    break;
-            }
-        }
-            break;
-        default:
-            // ERROR
-            return NAN;
-            break;
-    }
+    return range_translate_and_round_temperature(rawSample, (int) scaleType, (int) formatType);
+}
+
+#pragma mark - Array functions
+
+- (void) translateSamples: (const float*) rawSamples count: (int) count output: (float*) output
+{
+    range_translate_temperatures(rawSamples, output, count, (int) self.currentScale);
+}
+
+- (void) translateSamples: (const float*) rawSamples count: (int) count toScale: (RangeTemperatureScale) scaleType output: (float*) output
+{
+    range_translate_temperatures(rawSamples, output, count, (int) scaleType);
+}
+
+- (void) translateAndRoundSamples: (const float*) rawSamples count: (int) count withFormat: (RangeTemperaturePrintFormat) formatType output: (float*) output
+{
+    range_translate_and_round_temperatures(rawSamples, output, count, (int) self.currentScale, (int) formatType);
+}
+
+- (void) translateAndRoundSamples: (const float*) rawSamples count: (int) count withFormat: (RangeTemperaturePrintFormat) formatType
+                          toScale: (RangeTemperatureScale) scaleType output: (float*) output
+{
+    range_translate_and_round_temperatures(rawSamples, output, count, (int) scaleType, (int) formatType);
 }
 
 
@@ -205,71 +146,20 @@
 
 - (NSString *) printSample:(float) rawSample withFormat: (RangeTemperaturePrintFormat) formatType
 {
-    return [self printSample:rawSample withFormat:formatType withScale:_currentScale];
+    return [self printSample:rawSample withFormat:formatType withScale:self.currentScale];
 }
 
 - (NSString *) printSample:(float) rawSample withFormat: (RangeTemperaturePrintFormat) formatType withScale: (RangeTemperatureScale) scaleType
 {
-    float translatedSample = [self translateAndRoundSample:rawSample withFormat:formatType toScale:scaleType];
-    
-    switch (formatType) {
-        case kRangeTemperaturePrintFormatHumanReadable:
-        {
-            switch (scaleType) {
-                case kRangeTemperatureScaleKelvin:
-                case kRangeTemperatureScaleCelcius:
-                    return [NSString stringWithFormat:@"%.0fº", translatedSample];
-                    break;
-                case kRangeTemperatureScaleFahrenheit:
-                    return [NSString stringWithFormat:@"%.0fº", translatedSample];
-                    break;
-                default:
-                    // ERROR
-                    return @"ErrorTemperatureScale";
-                    break;
-            }
-        }
-            break;
-        case kRangeTemperaturePrintFormatHumanReadablePrecision:
-        {
-            switch (scaleType) {
-                case kRangeTemperatureScaleKelvin:
-                case kRangeTemperatureScaleCelcius:
-                    return [NSString stringWithFormat:@"%.1fº", translatedSample];
-                    break;
-                case kRangeTemperatureScaleFahrenheit:
-                    return [NSString stringWithFormat:@"%.1fº", translatedSample];
-                    break;
-                default:
-                    // ERROR
-                    return @"ErrorTemperatureScale";
-                    break;
-            }
-        }
-            break;
-        case kRangeTemperaturePrintFormatRawData:
-        {
-            switch (scaleType) {
-                case kRangeTemperatureScaleKelvin:
-                case kRangeTemperatureScaleCelcius:
-                    return [NSString stringWithFormat:@"%.2f", translatedSample];
-                    break;
-                case kRangeTemperatureScaleFahrenheit:
-                    return [NSString stringWithFormat:@"%.1f", translatedSample];
-                    break;
-                default:
-                    // ERROR
-                    return @"ErrorTemperatureScale";
-                    break;
-            }
-        }
-            break;
-        default:
-            // ERROR
-            return @"ErrorTemperatureFormat";
-            break;
-    }
-    
+    char buffer[RANGE_FORMAT_MAX_LENGTH];
+    [self printSample:rawSample withFormat:formatType withScale:scaleType toBuffer:buffer];
+    return [NSString stringWithUTF8String:buffer];
+}
+
+- (int) printSample:(float) rawSample withFormat: (RangeTemperaturePrintFormat) formatType withScale: (RangeTemperatureScale) scaleType
+           toBuffer: (char*) buffer
+{
+    return range_format_temperature(buffer, rawSample, (int) scaleType, (int) formatType);
 }
 
 @end
\ No newline at end of file
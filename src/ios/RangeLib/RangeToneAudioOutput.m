@@ -0,0 +1,202 @@
+//
+//  RangeToneAudioOutput.m
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "RangeToneAudioOutput.h"
+#import <AudioToolbox/AudioToolbox.h>
+#include "RangeToneRenderer.h"
+
+#define kRTAONumberOfBuffers 3
+// About 23ms of audio per buffer at 44.1kHz.
+#define kRTAOBufferFrames 1024
+#define kRTAOChannels 2
+#define kRTAOBufferSeconds (kRTAOBufferFrames / RANGE_TONE_SAMPLE_RATE)
+
+typedef struct {
+    range_tone_renderer_t renderer;
+    // Buffers in a row that ended silent. Once there are more than kRTAONumberOfBuffers the buffer
+    // with the ramp down has been played, and so has everything queued before it.
+    _Atomic int silent_buffers;
+} rtao_state_t;
+
+@interface RangeToneAudioOutput()
+{
+    AudioQueueRef _queue;
+    AudioQueueBufferRef _buffers[kRTAONumberOfBuffers];
+    rtao_state_t _state;
+    BOOL _running;
+    // Bumped by play and pause, so a pause still waiting for the ramp down knows it was overtaken.
+    NSUInteger _pauseGeneration;
+}
+
+@end
+
+// Runs on the audio thread. Only touches the renderer and an atomic.
+static void rtao_output_callback(void* userData, AudioQueueRef queue, AudioQueueBufferRef buffer)
+{
+    rtao_state_t* state = userData;
+    range_tone_render(&state->renderer, (int16_t*)buffer->mAudioData, kRTAOBufferFrames, kRTAOChannels);
+    buffer->mAudioDataByteSize = kRTAOBufferFrames * kRTAOChannels * sizeof(int16_t);
+    AudioQueueEnqueueBuffer(queue, buffer, 0, NULL);
+
+    int silent_buffers = atomic_load_explicit(&state->silent_buffers, memory_order_relaxed);
+    if(!range_tone_is_silent(&state->renderer))
+    {
+        silent_buffers = 0;
+    } else if(silent_buffers <= kRTAONumberOfBuffers) {
+        silent_buffers++;
+    }
+    atomic_store_explicit(&state->silent_buffers, silent_buffers, memory_order_release);
+}
+
+
+@implementation RangeToneAudioOutput
+
+- (instancetype) init
+{
+    if (self = [super init])
+    {
+        range_tone_renderer_init(&_state.renderer);
+        atomic_init(&_state.silent_buffers, kRTAONumberOfBuffers + 1);
+
+        AudioStreamBasicDescription format;
+        memset(&format, 0, sizeof(format));
+        format.mSampleRate = RANGE_TONE_SAMPLE_RATE;
+        format.mFormatID = kAudioFormatLinearPCM;
+        format.mFormatFlags = kLinearPCMFormatFlagIsSignedInteger | kLinearPCMFormatFlagIsPacked;
+        format.mChannelsPerFrame = kRTAOChannels;
+        format.mBitsPerChannel = 16;
+        format.mBytesPerFrame = kRTAOChannels * sizeof(int16_t);
+        format.mFramesPerPacket = 1;
+        format.mBytesPerPacket = format.mBytesPerFrame;
+
+        // The callback runs on the queue's own thread, not the main run loop.
+        OSStatus status = AudioQueueNewOutput(&format, rtao_output_callback, &_state, NULL, NULL, 0, &_queue);
+        if(status != noErr)
+        {
+            NSLog(@"%s - AudioQueueNewOutput failed: %d", __PRETTY_FUNCTION__, (int)status);
+            _queue = NULL;
+            return nil;
+        }
+
+        for(int i = 0; i < kRTAONumberOfBuffers; i++)
+        {
+            status = AudioQueueAllocateBuffer(_queue, kRTAOBufferFrames * format.mBytesPerFrame, &_buffers[i]);
+            if(status != noErr)
+            {
+                NSLog(@"%s - AudioQueueAllocateBuffer failed: %d", __PRETTY_FUNCTION__, (int)status);
+                [self immediateDestroyState];
+                return nil;
+            }
+        }
+
+        return self;
+    } else {
+        return nil;
+    }
+}
+
+- (void) dealloc
+{
+    [self immediateDestroyState];
+}
+
+-(void) immediateDestroyState
+{
+    _pauseGeneration++;
+    range_tone_set_playing(&_state.renderer, false);
+    if(_queue != NULL)
+    {
+        AudioQueueStop(_queue, true);
+        AudioQueueDispose(_queue, true);
+        _queue = NULL;
+    }
+    _running = NO;
+}
+
+- (void) setUseLowFrequency:(BOOL) useLowFrequency
+{
+    _useLowFrequency = useLowFrequency;
+    range_tone_set_low_frequency(&_state.renderer, useLowFrequency);
+}
+
+- (BOOL) play
+{
+    if(_queue == NULL)
+    {
+        return NO;
+    }
+
+    _pauseGeneration++;
+    range_tone_set_playing(&_state.renderer, true);
+    if(_running)
+    {
+        return YES;
+    }
+
+    if(_buffers[0]->mAudioDataByteSize == 0)
+    {
+        // First time: prime the queue. After a pause the buffers still hold tone and are still queued.
+        for(int i = 0; i < kRTAONumberOfBuffers; i++)
+        {
+            rtao_output_callback(&_state, _queue, _buffers[i]);
+        }
+    }
+
+    OSStatus status = AudioQueueStart(_queue, NULL);
+    if(status != noErr)
+    {
+        NSLog(@"%s - AudioQueueStart failed: %d", __PRETTY_FUNCTION__, (int)status);
+        return NO;
+    }
+    _running = YES;
+    return YES;
+}
+
+- (void) pause
+{
+    range_tone_set_playing(&_state.renderer, false);
+    if(_queue != NULL && _running)
+    {
+        [self pauseAfterRampDown:++_pauseGeneration];
+    }
+}
+
+// Pausing the queue straight away would cut the tone off mid wave and click.
+// Waits (without blocking) for the ramp down to come out of the speaker first.
+- (void) pauseAfterRampDown:(NSUInteger) generation
+{
+    if(generation != _pauseGeneration || _queue == NULL || !_running)
+    {
+        return;
+    }
+
+    if(atomic_load_explicit(&_state.silent_buffers, memory_order_acquire) > kRTAONumberOfBuffers)
+    {
+        AudioQueuePause(_queue);
+        _running = NO;
+        return;
+    }
+
+    __weak RangeToneAudioOutput* weakSelf = self;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(kRTAOBufferSeconds * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        [weakSelf pauseAfterRampDown:generation];
+    });
+}
+
+@end
@@ -0,0 +1,143 @@
+//
+//  RangeToneRenderer.c
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "RangeToneRenderer.h"
+#include <math.h>
+#include <string.h>
+
+#define RTR_FULL_LEVEL 32768
+// M_PI isn't there in strict C builds.
+#define RTR_TWO_PI 6.283185307179586476925
+
+static void rtr_fill_table(int16_t* table, double frequency, int peak)
+{
+    for(int n = 0; n < RANGE_TONE_TABLE_LENGTH; n++)
+    {
+        double phase = RTR_TWO_PI * frequency * (double)n / RANGE_TONE_SAMPLE_RATE;
+        table[n] = (int16_t)lround(peak * sin(phase));
+    }
+}
+
+void range_tone_renderer_init(range_tone_renderer_t* renderer)
+{
+    memset(renderer, 0, sizeof(*renderer));
+    rtr_fill_table(renderer->high_table, RANGE_TONE_HIGH_FREQUENCY, RANGE_TONE_HIGH_LEVEL);
+    rtr_fill_table(renderer->low_table, RANGE_TONE_LOW_FREQUENCY, RANGE_TONE_LOW_LEVEL);
+    atomic_init(&renderer->playing, false);
+    atomic_init(&renderer->use_low, false);
+    atomic_init(&renderer->silent, true);
+    renderer->table = renderer->high_table;
+    renderer->position = 0;
+    renderer->level = 0;
+}
+
+void range_tone_set_playing(range_tone_renderer_t* renderer, bool playing)
+{
+    atomic_store_explicit(&renderer->playing, playing, memory_order_release);
+}
+
+void range_tone_set_low_frequency(range_tone_renderer_t* renderer, bool use_low)
+{
+    atomic_store_explicit(&renderer->use_low, use_low, memory_order_release);
+}
+
+bool range_tone_is_silent(const range_tone_renderer_t* renderer)
+{
+    return atomic_load_explicit(&renderer->silent, memory_order_acquire);
+}
+
+void range_tone_render(range_tone_renderer_t* renderer, int16_t* out, int frames, int channels)
+{
+    const bool playing = atomic_load_explicit(&renderer->playing, memory_order_acquire);
+    const int16_t* wanted = atomic_load_explicit(&renderer->use_low, memory_order_acquire) ? renderer->low_table : renderer->high_table;
+    const int32_t target = playing ? RTR_FULL_LEVEL : 0;
+    const int32_t step = RTR_FULL_LEVEL / RANGE_TONE_RAMP_FRAMES;
+
+    if(!playing && renderer->level == 0)
+    {
+        // Stay where we are so turning back on picks up the same phase.
+        memset(out, 0, sizeof(int16_t) * (size_t)frames * (size_t)channels);
+        atomic_store_explicit(&renderer->silent, true, memory_order_release);
+        return;
+    }
+
+    const int16_t* table = renderer->table;
+    int position = renderer->position;
+    int32_t level = renderer->level;
+    int frame = 0;
+    while(frame < frames)
+    {
+        // Run to the end of the table (or the buffer) in one go.
+        int run = RANGE_TONE_TABLE_LENGTH - position;
+        if(run > frames - frame)
+        {
+            run = frames - frame;
+        }
+
+        if(level == target && level == RTR_FULL_LEVEL)
+        {
+            if(channels == 2)
+            {
+                for(int i = 0; i < run; i++)
+                {
+                    int16_t value = table[position + i];
+                    out[2 * (frame + i)] = value;
+                    out[2 * (frame + i) + 1] = (int16_t)-value;
+                }
+            } else {
+                for(int i = 0; i < run; i++)
+                {
+                    for(int c = 0; c < channels; c++)
+                    {
+                        out[channels * (frame + i) + c] = c == 1 ? (int16_t)-table[position + i] : table[position + i];
+                    }
+                }
+            }
+        } else {
+            for(int i = 0; i < run; i++)
+            {
+                if(level < target)
+                {
+                    level = level + step > target ? target : level + step;
+                } else if(level > target) {
+                    level = level - step < target ? target : level - step;
+                }
+                int16_t value = (int16_t)(((int32_t)table[position + i] * level) / RTR_FULL_LEVEL);
+                for(int c = 0; c < channels; c++)
+                {
+                    out[channels * (frame + i) + c] = c == 1 ? (int16_t)-value : value;
+                }
+            }
+        }
+
+        frame += run;
+        position += run;
+        if(position == RANGE_TONE_TABLE_LENGTH)
+        {
+            // Both tones are back at phase 0 here, so this is where we can swap without a jump.
+            position = 0;
+            table = wanted;
+        }
+    }
+
+    renderer->table = table;
+    renderer->position = position;
+    renderer->level = level;
+    atomic_store_explicit(&renderer->silent, level == 0, memory_order_release);
+}
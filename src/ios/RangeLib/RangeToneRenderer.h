@@ -0,0 +1,93 @@
+//
+//  RangeToneRenderer.h
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RangeToneRenderer_h
+#define RangeToneRenderer_h
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ Renders the tone a Range lives on (its power) into 16 bit interleaved PCM.
+
+ The tone is read out of a table worked out once in range_tone_renderer_init.
+ At 44.1kHz both tones repeat exactly every 441 samples (200 cycles of 20kHz, 160 of 16kHz),
+ so a table that long loops with no seam and the phase carries on from one buffer to the next.
+
+ Whether the tone plays and which one plays are set through atomics, so the render call
+ (on the audio thread) never locks, allocates or waits on whoever changes them. Changes are
+ picked up at the start of the next buffer. Turning the tone on or off ramps the level over
+ RANGE_TONE_RAMP_FRAMES to keep from clicking, and switching tone waits for the table to wrap,
+ where both tones are at phase 0.
+ */
+
+#define RANGE_TONE_SAMPLE_RATE      44100.0
+#define RANGE_TONE_HIGH_FREQUENCY   20000.0
+#define RANGE_TONE_LOW_FREQUENCY    16000.0
+// Peak levels. Some devices can't play the high tone, and clip the low one at full scale.
+#define RANGE_TONE_HIGH_LEVEL       32767
+#define RANGE_TONE_LOW_LEVEL        31000
+// Samples in each table: one whole repeat of both tones at RANGE_TONE_SAMPLE_RATE.
+#define RANGE_TONE_TABLE_LENGTH     441
+#define RANGE_TONE_RAMP_FRAMES      64
+
+typedef struct {
+    int16_t         high_table[RANGE_TONE_TABLE_LENGTH];
+    int16_t         low_table[RANGE_TONE_TABLE_LENGTH];
+
+    // Parameter block. Written by anyone, read by range_tone_render.
+    _Atomic bool    playing;
+    _Atomic bool    use_low;
+
+    // Render state. Only touched by range_tone_render.
+    const int16_t*  table;
+    int             position;
+    // Level applied to the table, 0 to 32768 (1.0).
+    int32_t         level;
+
+    // Written by range_tone_render at the end of every buffer, read by anyone.
+    _Atomic bool    silent;
+} range_tone_renderer_t;
+
+void range_tone_renderer_init(range_tone_renderer_t* renderer);
+
+/*
+ Start or stop the tone. Safe to call from any thread.
+ */
+void range_tone_set_playing(range_tone_renderer_t* renderer, bool playing);
+
+/*
+ Play RANGE_TONE_LOW_FREQUENCY instead of RANGE_TONE_HIGH_FREQUENCY. Safe to call from any thread.
+ */
+void range_tone_set_low_frequency(range_tone_renderer_t* renderer, bool use_low);
+
+/*
+ True once a rendered buffer ended with the tone fully off (the level has ramped down). Safe to call from any thread.
+ */
+bool range_tone_is_silent(const range_tone_renderer_t* renderer);
+
+/*
+ Writes frames frames of channels interleaved samples. Channel 1 (the right) is the negation of the
+ others, the antiphase pair RangeAudioOutput plays. The levels stay under 32768, so that never overflows.
+ Real time safe. Must only be called from one thread at a time.
+ */
+void range_tone_render(range_tone_renderer_t* renderer, int16_t* out, int frames, int channels);
+
+#endif /* RangeToneRenderer_h */
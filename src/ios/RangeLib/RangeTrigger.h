@@ -90,6 +90,22 @@ typedef NS_ENUM(UInt32, RangeTriggerDirection) {
  */
 - (BOOL) isTriggerForRawData: (const range_sample_t*) rawData;
 
+/*!
+ Check a run of consecutive raw data points, such as what findSamplesFromStart:toStop:withOutputLength: returns,
+ with the same result as calling isTriggerForRawData: on each in turn. Use it to catch up on the samples
+ that came in while the app was in the background.
+ 
+ @param rawData
+ The first data point of the run.
+ 
+ @param length
+ The number of data points in the run.
+ 
+ @return The indexes (into rawData) of the data points a trigger occured on.
+ The time of each is rawData[index].unix_time.
+ */
+- (NSIndexSet*) triggerIndexesForRawData: (const range_sample_t*) rawData length: (int) length;
+
 /*!
  This function allows you to change the properties of the trigger.
  It resets the inner state machine of the trigger.
@@ -22,6 +22,7 @@
 #endif
 
 #import "RangeTrigger.h"
+#import "RangeTriggerIndex.h"
 
 @interface RangeTrigger()
 {
@@ -162,22 +163,46 @@
     return output;
 }
 
+- (NSIndexSet*) triggerIndexesForRawData: (const range_sample_t*) rawData length: (int) length
+{
+    NSMutableIndexSet* output = [[NSMutableIndexSet alloc] init];
+    if(length <= 0)
+    {
+        return output;
+    }
+    range_trigger_firing_t* firings = malloc(sizeof(range_trigger_firing_t) * length);
+    if(firings == NULL)
+    {
+        NSLog(@"RDC - Out of memory.");
+        return output;
+    }
+
+    range_trigger_state_t state;
+    state.temperature = self.triggerTemperature;
+    state.offset = self.hysteresisOffset;
+    state.direction = (int) self.direction;
+    state.has_last = self.isDataEverRead;
+    state.last_temperature = self.lastTemperatureRead;
+    state.held = self.isHysteresisEnabled;
+
+    int count = range_trigger_evaluate_span(&state, rawData, length, firings);
+    for(int i = 0; i < count; i++)
+    {
+        [output addIndex:firings[i].index];
+    }
+    free(firings);
+
+    self.isDataEverRead = state.has_last;
+    self.lastTemperatureRead = state.last_temperature;
+    self.isHysteresisEnabled = state.held;
+    return output;
+}
 
 // Function for determining the hysteresis range appropriate for a given alert temperature
+// (shared with RangeTriggerSet so the two always agree)
 + (float) hysOffsetBasedOnTemp: (float) alertTemp
 {
-    float offset = 0.0f;
-    // Piecewise linear function that takes alertTemp and
-    // generates offset based on these (alertTemp, offset) pairs, in degrees F:
-    // (-40, 10) (75, 2) (450, 10)
-    if( alertTemp > 75.0f)
-    {
-        offset = (8.0f/375.0f) * alertTemp + (2.0f/5.0f);
-    } else {
-        offset = (-8.0f/115.0f) * alertTemp + (166.0f/23.0f);
-    }
-    
-    return offset;
+    return range_trigger_hysteresis_offset(alertTemp);
 }
 
 //// A very simple quick unit test for sanity checking things.
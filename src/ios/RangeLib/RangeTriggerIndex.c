@@ -0,0 +1,609 @@
+//
+//  RangeTriggerIndex.c
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "RangeTriggerIndex.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+float range_trigger_hysteresis_offset(float temperature)
+{
+    // Piecewise linear through these (threshold, offset) pairs, in degrees F:
+    // (-40, 10) (75, 2) (450, 10)
+    if(temperature > 75.0f)
+    {
+        return (8.0f/375.0f) * temperature + (2.0f/5.0f);
+    } else {
+        return (-8.0f/115.0f) * temperature + (166.0f/23.0f);
+    }
+}
+
+#pragma mark - band edges
+
+// RangeTrigger re-arms a bidirectional trigger when fabsf(temperature - threshold) > offset.
+static bool rti_outside_band(float temperature, float threshold, float offset)
+{
+    return fabsf(temperature - threshold) > offset;
+}
+
+// The edges for a bidirectional trigger, worked out so that "below low" and "above high"
+// give exactly the same answer as rti_outside_band, rounding included.
+static void rti_bidirectional_edges(float threshold, float offset, float* low_out, float* high_out)
+{
+    float high = threshold + offset;
+    while(!rti_outside_band(high, threshold, offset))
+    {
+        high = nextafterf(high, INFINITY);
+    }
+    for(float below = nextafterf(high, -INFINITY); below > threshold && rti_outside_band(below, threshold, offset);
+        below = nextafterf(high, -INFINITY))
+    {
+        high = below;
+    }
+    // high is now the lowest temperature above the threshold outside the band.
+    *high_out = nextafterf(high, -INFINITY);
+
+    float low = threshold - offset;
+    while(!rti_outside_band(low, threshold, offset))
+    {
+        low = nextafterf(low, -INFINITY);
+    }
+    for(float above = nextafterf(low, INFINITY); above < threshold && rti_outside_band(above, threshold, offset);
+        above = nextafterf(low, INFINITY))
+    {
+        low = above;
+    }
+    *low_out = nextafterf(low, INFINITY);
+}
+
+#pragma mark - heaps
+
+static bool rti_entry_live(const range_trigger_index_t* index, const range_trigger_heap_entry_t* entry)
+{
+    const range_trigger_slot_t* slot = &index->slots[entry->id];
+    return slot->in_use && slot->held && slot->epoch == entry->epoch;
+}
+
+// is_max: the low heap wants its largest key on top, the high heap its smallest.
+static bool rti_before(const range_trigger_heap_entry_t* a, const range_trigger_heap_entry_t* b, bool is_max)
+{
+    return is_max ? a->key > b->key : a->key < b->key;
+}
+
+static void rti_sift_down(range_trigger_heap_entry_t* heap, int count, int position, bool is_max)
+{
+    for(;;)
+    {
+        int best = position;
+        int left = 2 * position + 1;
+        int right = left + 1;
+        if(left < count && rti_before(&heap[left], &heap[best], is_max))
+        {
+            best = left;
+        }
+        if(right < count && rti_before(&heap[right], &heap[best], is_max))
+        {
+            best = right;
+        }
+        if(best == position)
+        {
+            return;
+        }
+        range_trigger_heap_entry_t swap = heap[best];
+        heap[best] = heap[position];
+        heap[position] = swap;
+        position = best;
+    }
+}
+
+static void rti_sift_up(range_trigger_heap_entry_t* heap, int position, bool is_max)
+{
+    while(position > 0)
+    {
+        int parent = (position - 1) / 2;
+        if(!rti_before(&heap[position], &heap[parent], is_max))
+        {
+            return;
+        }
+        range_trigger_heap_entry_t swap = heap[parent];
+        heap[parent] = heap[position];
+        heap[position] = swap;
+        position = parent;
+    }
+}
+
+// Drops the entries of triggers that were re-armed or removed since they went in.
+static void rti_compact(range_trigger_index_t* index, range_trigger_heap_entry_t* heap, int* count, bool is_max)
+{
+    int kept = 0;
+    for(int i = 0; i < *count; i++)
+    {
+        if(rti_entry_live(index, &heap[i]))
+        {
+            heap[kept++] = heap[i];
+        }
+    }
+    *count = kept;
+    for(int i = kept / 2 - 1; i >= 0; i--)
+    {
+        rti_sift_down(heap, kept, i, is_max);
+    }
+}
+
+static void rti_push(range_trigger_index_t* index, range_trigger_heap_entry_t* heap, int* count, bool is_max,
+                     float key, int id)
+{
+    if(*count == index->heap_capacity)
+    {
+        // A trigger has at most one live entry in each heap, and heap_capacity is at least slot_count.
+        rti_compact(index, heap, count, is_max);
+    }
+    heap[*count].key = key;
+    heap[*count].id = id;
+    heap[*count].epoch = index->slots[id].epoch;
+    rti_sift_up(heap, (*count)++, is_max);
+}
+
+static void rti_pop(range_trigger_heap_entry_t* heap, int* count, bool is_max)
+{
+    heap[0] = heap[--(*count)];
+    rti_sift_down(heap, *count, 0, is_max);
+}
+
+static void rti_rearm(range_trigger_index_t* index, int id)
+{
+    index->slots[id].held = false;
+    index->slots[id].epoch++;
+}
+
+#pragma mark - sorted thresholds
+
+// First position in order whose temperature is > temperature (or >= when inclusive).
+static int rti_search(const range_trigger_index_t* index, float temperature, bool inclusive)
+{
+    int low = 0;
+    int high = index->count;
+    while(low < high)
+    {
+        int middle = low + (high - low) / 2;
+        float value = index->sorted_temperatures[middle];
+        if(inclusive ? value < temperature : value <= temperature)
+        {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+static bool rti_grow(range_trigger_index_t* index)
+{
+    int capacity = index->slot_capacity == 0 ? 8 : index->slot_capacity * 2;
+    range_trigger_slot_t* slots = realloc(index->slots, sizeof(range_trigger_slot_t) * capacity);
+    if(slots != NULL)
+    {
+        index->slots = slots;
+    }
+    int* order = realloc(index->order, sizeof(int) * capacity);
+    if(order != NULL)
+    {
+        index->order = order;
+    }
+    float* sorted = realloc(index->sorted_temperatures, sizeof(float) * capacity);
+    if(sorted != NULL)
+    {
+        index->sorted_temperatures = sorted;
+    }
+    range_trigger_heap_entry_t* low_heap = realloc(index->low_heap, sizeof(range_trigger_heap_entry_t) * capacity);
+    if(low_heap != NULL)
+    {
+        index->low_heap = low_heap;
+    }
+    range_trigger_heap_entry_t* high_heap = realloc(index->high_heap, sizeof(range_trigger_heap_entry_t) * capacity);
+    if(high_heap != NULL)
+    {
+        index->high_heap = high_heap;
+    }
+    int* fired = realloc(index->fired, sizeof(int) * capacity);
+    if(fired != NULL)
+    {
+        index->fired = fired;
+    }
+    if(slots == NULL || order == NULL || sorted == NULL || low_heap == NULL || high_heap == NULL || fired == NULL)
+    {
+        return false;
+    }
+    index->slot_capacity = capacity;
+    index->heap_capacity = capacity;
+    return true;
+}
+
+#pragma mark - public
+
+void range_trigger_index_init(range_trigger_index_t* index)
+{
+    memset(index, 0, sizeof(*index));
+}
+
+void range_trigger_index_destroy(range_trigger_index_t* index)
+{
+    free(index->slots);
+    free(index->order);
+    free(index->sorted_temperatures);
+    free(index->low_heap);
+    free(index->high_heap);
+    free(index->fired);
+    memset(index, 0, sizeof(*index));
+}
+
+int range_trigger_index_add(range_trigger_index_t* index, float temperature, int direction)
+{
+    if(direction != RANGE_TRIGGER_RISING && direction != RANGE_TRIGGER_FALLING && direction != RANGE_TRIGGER_BIDIRECTIONAL)
+    {
+        return -1;
+    }
+    if(!isfinite(temperature))
+    {
+        return -1;
+    }
+
+    int id = -1;
+    for(int i = 0; i < index->slot_count; i++)
+    {
+        if(!index->slots[i].in_use)
+        {
+            id = i;
+            break;
+        }
+    }
+    if(id < 0)
+    {
+        if(index->slot_count == index->slot_capacity && !rti_grow(index))
+        {
+            return -1;
+        }
+        id = index->slot_count++;
+        index->slots[id].epoch = 0;
+    }
+
+    range_trigger_slot_t* slot = &index->slots[id];
+    slot->temperature = temperature;
+    slot->offset = range_trigger_hysteresis_offset(temperature);
+    slot->direction = direction;
+    slot->in_use = true;
+    slot->held = false;
+    slot->epoch++;
+    slot->low = -INFINITY;
+    slot->high = INFINITY;
+    if(direction == RANGE_TRIGGER_RISING)
+    {
+        slot->low = temperature - slot->offset;
+    } else if(direction == RANGE_TRIGGER_FALLING) {
+        slot->high = temperature + slot->offset;
+    } else {
+        rti_bidirectional_edges(temperature, slot->offset, &slot->low, &slot->high);
+    }
+
+    // After any equal thresholds, so they are crossed in the order they were added (on the way up).
+    int position = rti_search(index, temperature, false);
+    memmove(&index->order[position + 1], &index->order[position], sizeof(int) * (index->count - position));
+    memmove(&index->sorted_temperatures[position + 1], &index->sorted_temperatures[position],
+            sizeof(float) * (index->count - position));
+    index->order[position] = id;
+    index->sorted_temperatures[position] = temperature;
+    index->count++;
+    return id;
+}
+
+void range_trigger_index_remove(range_trigger_index_t* index, int id)
+{
+    if(id < 0 || id >= index->slot_count || !index->slots[id].in_use)
+    {
+        return;
+    }
+    index->slots[id].in_use = false;
+    rti_rearm(index, id);
+
+    for(int i = 0; i < index->count; i++)
+    {
+        if(index->order[i] == id)
+        {
+            memmove(&index->order[i], &index->order[i + 1], sizeof(int) * (index->count - i - 1));
+            memmove(&index->sorted_temperatures[i], &index->sorted_temperatures[i + 1],
+                    sizeof(float) * (index->count - i - 1));
+            index->count--;
+            break;
+        }
+    }
+}
+
+void range_trigger_index_reset(range_trigger_index_t* index)
+{
+    for(int i = 0; i < index->slot_count; i++)
+    {
+        if(index->slots[i].held)
+        {
+            rti_rearm(index, i);
+        }
+    }
+    index->low_count = 0;
+    index->high_count = 0;
+    index->has_last = false;
+    index->last_temperature = 0.0f;
+}
+
+// The temperature went across the threshold of id, rising or falling.
+static void rti_cross(range_trigger_index_t* index, int id, int crossing, int* fired_out, int* fired_count)
+{
+    range_trigger_slot_t* slot = &index->slots[id];
+    if(slot->held)
+    {
+        return;
+    }
+    // Crossing the wrong way still holds the trigger off until it re-arms.
+    slot->held = true;
+    if(slot->direction != RANGE_TRIGGER_FALLING)
+    {
+        rti_push(index, index->low_heap, &index->low_count, true, slot->low, id);
+    }
+    if(slot->direction != RANGE_TRIGGER_RISING)
+    {
+        rti_push(index, index->high_heap, &index->high_count, false, slot->high, id);
+    }
+    if(slot->direction == crossing || slot->direction == RANGE_TRIGGER_BIDIRECTIONAL)
+    {
+        fired_out[(*fired_count)++] = id;
+    }
+}
+
+int range_trigger_index_evaluate(range_trigger_index_t* index, float temperature, int* fired_out)
+{
+    if(!index->has_last)
+    {
+        index->has_last = true;
+        index->last_temperature = temperature;
+        return 0;
+    }
+
+    float last = index->last_temperature;
+    int fired = 0;
+    if(temperature > last)
+    {
+        // last < threshold <= temperature
+        int end = rti_search(index, temperature, false);
+        for(int i = rti_search(index, last, false); i < end; i++)
+        {
+            rti_cross(index, index->order[i], RANGE_TRIGGER_RISING, fired_out, &fired);
+        }
+    } else if(temperature < last) {
+        // temperature <= threshold < last
+        int first = rti_search(index, temperature, true);
+        for(int i = rti_search(index, last, true) - 1; i >= first; i--)
+        {
+            rti_cross(index, index->order[i], RANGE_TRIGGER_FALLING, fired_out, &fired);
+        }
+    }
+
+    // Re-arm whatever left its band. Comparisons with NaN are false, so NaN re-arms nothing.
+    while(index->low_count > 0 && index->low_heap[0].key > temperature)
+    {
+        range_trigger_heap_entry_t entry = index->low_heap[0];
+        rti_pop(index->low_heap, &index->low_count, true);
+        if(rti_entry_live(index, &entry))
+        {
+            rti_rearm(index, entry.id);
+        }
+    }
+    while(index->high_count > 0 && index->high_heap[0].key < temperature)
+    {
+        range_trigger_heap_entry_t entry = index->high_heap[0];
+        rti_pop(index->high_heap, &index->high_count, false);
+        if(rti_entry_live(index, &entry))
+        {
+            rti_rearm(index, entry.id);
+        }
+    }
+
+    index->last_temperature = temperature;
+    return fired;
+}
+
+#pragma mark - spans
+
+// The first sample from start on whose temperature isn't in [low, high] (NaN never is), or count.
+static int rti_scan(const range_sample_t* samples, int start, int count, float low, float high)
+{
+    int i = start;
+    // No branches inside a block, so the comparisons vectorize.
+    for(; i + 16 <= count; i += 16)
+    {
+        int outside = 0;
+        for(int j = 0; j < 16; j++)
+        {
+            float temperature = samples[i + j].temperature;
+            outside |= !((temperature >= low) & (temperature <= high));
+        }
+        if(outside)
+        {
+            break;
+        }
+    }
+    for(; i < count; i++)
+    {
+        float temperature = samples[i].temperature;
+        if(!(temperature >= low && temperature <= high))
+        {
+            return i;
+        }
+    }
+    return count;
+}
+
+int range_trigger_index_evaluate_span(range_trigger_index_t* index, const range_sample_t* samples, int count,
+                                      range_trigger_firing_t* out, int capacity, int* consumed_out)
+{
+    int written = 0;
+    int i = 0;
+    while(i < count && capacity - written >= index->count)
+    {
+        float last = index->last_temperature;
+        if(index->has_last && !isnan(last))
+        {
+            // Samples that cross no threshold and re-arm nothing only move the last temperature along.
+            // Anything in (the highest threshold <= last, the lowest >= last) crosses nothing.
+            float low = -INFINITY;
+            float high = INFINITY;
+            int above = rti_search(index, last, false);
+            if(above > 0)
+            {
+                low = nextafterf(index->sorted_temperatures[above - 1], INFINITY);
+            }
+            int below = rti_search(index, last, true);
+            if(below < index->count)
+            {
+                high = nextafterf(index->sorted_temperatures[below], -INFINITY);
+            }
+            // Stale heap entries only make the band narrower than it needs to be.
+            if(index->low_count > 0 && index->low_heap[0].key > low)
+            {
+                low = index->low_heap[0].key;
+            }
+            if(index->high_count > 0 && index->high_heap[0].key < high)
+            {
+                high = index->high_heap[0].key;
+            }
+            int end = rti_scan(samples, i, count, low, high);
+            if(end > i)
+            {
+                index->last_temperature = samples[end - 1].temperature;
+                i = end;
+                continue;
+            }
+        }
+
+        int fired = range_trigger_index_evaluate(index, samples[i].temperature, index->fired);
+        for(int k = 0; k < fired; k++)
+        {
+            out[written].index = i;
+            out[written].id = index->fired[k];
+            out[written].unix_time = samples[i].unix_time;
+            written++;
+        }
+        i++;
+    }
+    *consumed_out = i;
+    return written;
+}
+
+// isTriggerForRawData: for one temperature.
+static bool rti_step(range_trigger_state_t* state, float temperature)
+{
+    if(!state->has_last)
+    {
+        state->has_last = true;
+        state->last_temperature = temperature;
+        return false;
+    }
+
+    float threshold = state->temperature;
+    float last = state->last_temperature;
+    int crossing = 0;
+    if(last < threshold && temperature >= threshold)
+    {
+        if(!state->held)
+        {
+            crossing = RANGE_TRIGGER_RISING;
+            state->held = true;
+        }
+    } else if(last > threshold && temperature <= threshold) {
+        if(!state->held)
+        {
+            crossing = RANGE_TRIGGER_FALLING;
+            state->held = true;
+        }
+    }
+
+    if(state->direction == RANGE_TRIGGER_RISING && temperature < threshold - state->offset)
+    {
+        state->held = false;
+    } else if(state->direction == RANGE_TRIGGER_FALLING && temperature > threshold + state->offset) {
+        state->held = false;
+    } else if(state->direction == RANGE_TRIGGER_BIDIRECTIONAL && rti_outside_band(temperature, threshold, state->offset)) {
+        state->held = false;
+    }
+
+    state->last_temperature = temperature;
+    return state->direction == crossing || (state->direction == RANGE_TRIGGER_BIDIRECTIONAL && crossing != 0);
+}
+
+int range_trigger_evaluate_span(range_trigger_state_t* state, const range_sample_t* samples, int count,
+                                range_trigger_firing_t* out)
+{
+    bool valid = state->direction == RANGE_TRIGGER_RISING || state->direction == RANGE_TRIGGER_FALLING ||
+                 state->direction == RANGE_TRIGGER_BIDIRECTIONAL;
+    float threshold = state->temperature;
+    float band_low = -INFINITY;
+    float band_high = INFINITY;
+    if(state->direction == RANGE_TRIGGER_RISING)
+    {
+        band_low = threshold - state->offset;
+    } else if(state->direction == RANGE_TRIGGER_FALLING) {
+        band_high = threshold + state->offset;
+    } else if(state->direction == RANGE_TRIGGER_BIDIRECTIONAL) {
+        rti_bidirectional_edges(threshold, state->offset, &band_low, &band_high);
+    }
+
+    int written = 0;
+    int i = 0;
+    while(i < count)
+    {
+        // Without a direction the trigger fires on every sample that isn't a crossing, so take them one by one.
+        if(valid && state->has_last)
+        {
+            int end = i;
+            float last = state->last_temperature;
+            if(state->held)
+            {
+                // Crossings are ignored until a temperature leaves the band.
+                end = rti_scan(samples, i, count, band_low, band_high);
+            } else if(last < threshold) {
+                end = rti_scan(samples, i, count, -INFINITY, nextafterf(threshold, -INFINITY));
+            } else if(last > threshold) {
+                end = rti_scan(samples, i, count, nextafterf(threshold, INFINITY), INFINITY);
+            }
+            if(end > i)
+            {
+                state->last_temperature = samples[end - 1].temperature;
+                i = end;
+                continue;
+            }
+        }
+
+        if(rti_step(state, samples[i].temperature))
+        {
+            out[written].index = i;
+            out[written].id = 0;
+            out[written].unix_time = samples[i].unix_time;
+            written++;
+        }
+        i++;
+    }
+    return written;
+}
@@ -0,0 +1,157 @@
+//
+//  RangeTriggerIndex.h
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RangeTriggerIndex_h
+#define RangeTriggerIndex_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "RangeTypes.h"
+
+/*
+ Many temperature triggers checked against one stream of temperatures, with the same state machine
+ as RangeTrigger isTriggerForRawData: (crossings gated by a hysteresis band that is re-armed once the
+ temperature leaves the band on the side the trigger's direction calls for).
+
+ Thresholds are kept sorted, so a new temperature only looks at the triggers whose threshold lies
+ between it and the last temperature (two binary searches). Triggers whose hysteresis is holding them
+ off sit in two heaps ordered by the edge of their band, so re-arming only touches the triggers that re-arm.
+ Evaluating a temperature is O(log n + k), k being the triggers crossed or re-armed.
+
+ Triggers are referred to by the id range_trigger_index_add hands out. Ids of removed triggers get reused.
+ None of these functions lock.
+
+ A span of samples (catching up after the app was in the background) is evaluated in runs: between two
+ events nothing can change as long as the temperature stays inside the band around the last temperature
+ bounded by the next thresholds and the nearest heap edges, so those runs are skipped with a branch free
+ scan the compiler vectorizes, and only the samples that leave the band go through the state machine.
+ */
+
+// The same values as RangeTriggerDirection.
+#define RANGE_TRIGGER_RISING          1
+#define RANGE_TRIGGER_FALLING         2
+#define RANGE_TRIGGER_BIDIRECTIONAL   3
+
+typedef struct {
+    float       temperature;
+    float       offset;
+    int         direction;
+    bool        in_use;
+    // Set after a crossing until the temperature leaves the band.
+    bool        held;
+    // Bumped every time held is cleared, so heap entries from before are ignored.
+    uint32_t    epoch;
+    // Heap keys: re-armed once a temperature is below low or above high.
+    float       low;
+    float       high;
+} range_trigger_slot_t;
+
+typedef struct {
+    float       key;
+    int         id;
+    uint32_t    epoch;
+} range_trigger_heap_entry_t;
+
+// A trigger going off in a span of samples.
+typedef struct {
+    // Index of the sample in the span.
+    int         index;
+    // Trigger id, 0 for range_trigger_evaluate_span.
+    int         id;
+    double      unix_time;
+} range_trigger_firing_t;
+
+// A single trigger and the state RangeTrigger keeps between samples.
+typedef struct {
+    float       temperature;
+    float       offset;
+    int         direction;
+    bool        has_last;
+    float       last_temperature;
+    bool        held;
+} range_trigger_state_t;
+
+typedef struct {
+    range_trigger_slot_t*       slots;
+    int                         slot_count;
+    int                         slot_capacity;
+    // Ids of the triggers in use, by ascending temperature, and their temperatures.
+    int*                        order;
+    float*                      sorted_temperatures;
+    int                         count;
+    // Held triggers that re-arm below their low edge (max heap) / above their high edge (min heap).
+    range_trigger_heap_entry_t* low_heap;
+    int                         low_count;
+    range_trigger_heap_entry_t* high_heap;
+    int                         high_count;
+    int                         heap_capacity;
+    // Ids fired by one temperature, for range_trigger_index_evaluate_span.
+    int*                        fired;
+
+    float                       last_temperature;
+    bool                        has_last;
+} range_trigger_index_t;
+
+/*
+ The hysteresis band half width RangeTrigger uses for a threshold (degrees F).
+ */
+float range_trigger_hysteresis_offset(float temperature);
+
+void range_trigger_index_init(range_trigger_index_t* index);
+void range_trigger_index_destroy(range_trigger_index_t* index);
+
+/*
+ Adds a trigger at temperature (raw) for direction (RANGE_TRIGGER_). It starts out armed and
+ is checked from the next temperature on, against the last temperature the index has seen.
+ Returns its id, or -1 if direction isn't valid or we ran out of memory.
+ */
+int range_trigger_index_add(range_trigger_index_t* index, float temperature, int direction);
+
+void range_trigger_index_remove(range_trigger_index_t* index, int id);
+
+/*
+ Forgets the last temperature and re-arms every trigger, as if no temperature had been seen.
+ */
+void range_trigger_index_reset(range_trigger_index_t* index);
+
+/*
+ Feeds the next temperature. fired_out (room for as many ids as there are triggers) gets the ids
+ of the triggers that fire, in the order the temperature crossed them.
+ Returns the number of triggers that fired.
+ */
+int range_trigger_index_evaluate(range_trigger_index_t* index, float temperature, int* fired_out);
+
+/*
+ Feeds count samples in a row. Stops early when out can't take the firings of another sample
+ (capacity must be at least the number of triggers for it to get anywhere).
+ consumed_out gets how many samples were fed; call again from there for the rest.
+ Returns the number of firings written to out, in order.
+ */
+int range_trigger_index_evaluate_span(range_trigger_index_t* index, const range_sample_t* samples, int count,
+                                      range_trigger_firing_t* out, int capacity, int* consumed_out);
+
+/*
+ Feeds count samples in a row to a single trigger, with the same results as calling isTriggerForRawData:
+ on each. state holds the trigger and what it remembers between calls.
+ out needs room for count firings. Returns the number written.
+ */
+int range_trigger_evaluate_span(range_trigger_state_t* state, const range_sample_t* samples, int count,
+                                range_trigger_firing_t* out);
+
+#endif /* RangeTriggerIndex_h */
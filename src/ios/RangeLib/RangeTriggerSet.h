@@ -0,0 +1,79 @@
+//
+//  RangeTriggerSet.h
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+#import "RangeTrigger.h"
+
+/*!
+ Called for every trigger that goes off in a run of data points.
+ index is the data point's index in the run and sample the data point itself (its unix_time is when it went off).
+ */
+typedef void (^RangeTriggerSetBlock)(RangeTrigger* trigger, int index, const range_sample_t* sample);
+
+/*!
+ Checks many RangeTriggers against one Range at once. Every trigger behaves exactly as it would on its
+ own in isTriggerForRawData:, but a sample only looks at the triggers whose temperature it went past
+ (and the ones it re-arms), so checking a sample takes O(log n + k) instead of a message send per trigger.
+ 
+ The set keeps its own copy of each trigger's state, starting from when it is added. The RangeTrigger
+ objects are never changed by the set. Don't change a trigger while it is in the set; remove it and add it again.
+ 
+ Not thread safe. Use one set per Range.
+ */
+@interface RangeTriggerSet : NSObject
+
+/*!
+ The triggers in the set, in no particular order.
+ */
+@property (nonatomic, readonly) NSArray* triggers;
+
+/*!
+ Adds trigger to the set. It is checked from the next sample on, as if it had seen the last sample the set was given.
+ @return NO if the trigger has no direction or is already in the set.
+ */
+- (BOOL) addTrigger: (RangeTrigger*) trigger;
+
+- (void) removeTrigger: (RangeTrigger*) trigger;
+
+/*!
+ Forgets the last sample and re-arms every trigger, like changeTriggerTemperature:andDirection: does for one trigger.
+ */
+- (void) reset;
+
+/*!
+ Check the supplied raw data point against every trigger in the set.
+ 
+ @return The triggers that went off on this data point, in the order the temperature crossed them. Empty if none did.
+ */
+- (NSArray*) triggersForRawData: (const range_sample_t*) rawData;
+
+/*!
+ Check a run of consecutive raw data points, such as what findSamplesFromStart:toStop:withOutputLength: returns,
+ with the same result as calling triggersForRawData: on each in turn. Runs of data points that can't set off
+ or re-arm anything are skipped over a block at a time, so catching up on minutes of samples after
+ the app was in the background is quick.
+ 
+ @param block
+ Called for every trigger that went off, in order. Can be nil. Don't add or remove triggers from it.
+ 
+ @return How many times a trigger went off.
+ */
+- (int) checkRawData: (const range_sample_t*) rawData length: (int) length withBlock: (RangeTriggerSetBlock) block;
+
+@end
@@ -0,0 +1,174 @@
+//
+//  RangeTriggerSet.m
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "RangeTriggerSet.h"
+#import "RangeTriggerIndex.h"
+
+// Firings handed to the block per call of range_trigger_index_evaluate_span (at least, see checkRawData:).
+#define kRTriggerSetFirings 256
+
+@interface RangeTriggerSet()
+{
+    range_trigger_index_t _index;
+    // Room for the ids of every trigger.
+    int* _fired;
+    int _firedCapacity;
+}
+
+// By id, NSNull where there is no trigger.
+@property (strong, readwrite) NSMutableArray* triggersById;
+
+@end
+
+
+@implementation RangeTriggerSet
+
+- (instancetype) init
+{
+    if (self = [super init])
+    {
+        range_trigger_index_init(&_index);
+        self.triggersById = [[NSMutableArray alloc] init];
+        return self;
+    } else {
+        return nil;
+    }
+}
+
+- (void) dealloc
+{
+    range_trigger_index_destroy(&_index);
+    free(_fired);
+}
+
+- (NSArray*) triggers
+{
+    NSMutableArray* output = [[NSMutableArray alloc] init];
+    for(id trigger in self.triggersById)
+    {
+        if(trigger != [NSNull null])
+        {
+            [output addObject:trigger];
+        }
+    }
+    return output;
+}
+
+- (NSUInteger) idOfTrigger: (RangeTrigger*) trigger
+{
+    return [self.triggersById indexOfObjectIdenticalTo:trigger];
+}
+
+- (BOOL) addTrigger: (RangeTrigger*) trigger
+{
+    if(trigger == nil || [self idOfTrigger:trigger] != NSNotFound)
+    {
+        return NO;
+    }
+    if(_firedCapacity <= _index.slot_count)
+    {
+        int capacity = _firedCapacity == 0 ? 8 : _firedCapacity * 2;
+        int* fired = realloc(_fired, sizeof(int) * capacity);
+        if(fired == NULL)
+        {
+            NSLog(@"RDC - Out of memory.");
+            return NO;
+        }
+        _fired = fired;
+        _firedCapacity = capacity;
+    }
+
+    int triggerId = range_trigger_index_add(&_index, trigger.triggerTemperature, (int) trigger.direction);
+    if(triggerId < 0)
+    {
+        return NO;
+    }
+    if(triggerId == [self.triggersById count])
+    {
+        [self.triggersById addObject:trigger];
+    } else {
+        self.triggersById[triggerId] = trigger;
+    }
+    return YES;
+}
+
+- (void) removeTrigger: (RangeTrigger*) trigger
+{
+    NSUInteger triggerId = [self idOfTrigger:trigger];
+    if(triggerId == NSNotFound)
+    {
+        return;
+    }
+    range_trigger_index_remove(&_index, (int) triggerId);
+    self.triggersById[triggerId] = [NSNull null];
+}
+
+- (void) reset
+{
+    range_trigger_index_reset(&_index);
+}
+
+- (NSArray*) triggersForRawData: (const range_sample_t*) rawData
+{
+    int count = range_trigger_index_evaluate(&_index, rawData->temperature, _fired);
+    if(count == 0)
+    {
+        return @[];
+    }
+    NSMutableArray* output = [[NSMutableArray alloc] initWithCapacity:count];
+    for(int i = 0; i < count; i++)
+    {
+        [output addObject:self.triggersById[_fired[i]]];
+    }
+    return output;
+}
+
+- (int) checkRawData: (const range_sample_t*) rawData length: (int) length withBlock: (RangeTriggerSetBlock) block
+{
+    // Every trigger can go off on one data point, so there has to be room for all of them.
+    int capacity = MAX(kRTriggerSetFirings, _index.count);
+    range_trigger_firing_t* firings = malloc(sizeof(range_trigger_firing_t) * capacity);
+    if(firings == NULL)
+    {
+        NSLog(@"RDC - Out of memory.");
+        return 0;
+    }
+
+    int output = 0;
+    int start = 0;
+    while(start < length)
+    {
+        int consumed = 0;
+        int count = range_trigger_index_evaluate_span(&_index, &rawData[start], length - start, firings, capacity, &consumed);
+        for(int i = 0; i < count; i++)
+        {
+            if(block != nil)
+            {
+                int index = start + firings[i].index;
+                block(self.triggersById[firings[i].id], index, &rawData[index]);
+            }
+        }
+        output += count;
+        start += consumed;
+    }
+    free(firings);
+    return output;
+}
+
+@end
@@ -0,0 +1,142 @@
+//
+//  RangeTypes.h
+//
+//  Created by David Clift-Reaves.
+//
+// Copyright 2014 Supermechanical
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RangeTypes_h
+#define RangeTypes_h
+
+// Plain C types shared by the Objective-C classes and the C sample code.
+// Nothing in here may depend on Foundation.
+
+#include <stdbool.h>
+
+typedef struct  {
+    /*!
+     Temperature (in F) of the sample.
+     */
+    float temperature;
+    /*!
+     Time since 1970 for sample.
+     Is the equivalent of what [[NSDate date] timeIntervalSince1970]
+     would return at the moment the sample was taken.
+     */
+    double unix_time;
+} range_sample_t;
+
+/*
+ Largest Range uid (in bytes) that the decoder can report.
+ The uid is shown to SDK users as a hex string of these bytes.
+ */
+#define RANGE_UID_MAX_BYTES 8
+
+typedef struct {
+    unsigned char bytes[RANGE_UID_MAX_BYTES];
+    int length;
+} range_uid_t;
+
+/*!
+ Summary of all the samples that fall in one stretch of time. Used for overview graphs.
+ */
+typedef struct {
+    /*!
+     Start of the stretch of time (inclusive).
+     */
+    double start_time;
+    /*!
+     End of the stretch of time (exclusive).
+     */
+    double stop_time;
+    float min_temperature;
+    float max_temperature;
+    float mean_temperature;
+    /*!
+     Number of samples summarized. Never 0.
+     */
+    int count;
+} range_bucket_t;
+
+/*!
+ Statistics of the samples in a rolling window (the last so many seconds of one Range).
+ */
+typedef struct {
+    /*!
+     Time of the oldest and the newest sample in the window.
+     */
+    double start_time;
+    double stop_time;
+    float min_temperature;
+    float max_temperature;
+    float mean_temperature;
+    /*!
+     Population standard deviation of the temperatures.
+     */
+    float stddev_temperature;
+    /*!
+     Slope of the least squares line through the samples, in degrees per minute. 0 for fewer than two samples.
+     */
+    float slope_per_minute;
+    /*!
+     Number of samples in the window. The other fields are 0 when this is.
+     */
+    int count;
+} range_window_stats_t;
+
+/*!
+ Frame types in range_frame_t.
+ */
+#define RANGE_FRAME_TEMPERATURE 'T'
+#define RANGE_FRAME_INFO        'I'
+
+/*!
+ One frame decoded by the RangeAudioInput in libRangeLib, as it is handed to
+ -[RangeData initWithFrames:fromSender:withNumFrames:]. The layout is fixed by that binary.
+ */
+typedef struct {
+    /*!
+     RANGE_FRAME_TEMPERATURE or RANGE_FRAME_INFO.
+     */
+    unsigned char type;
+    /*!
+     Time since 1970 the frame was decoded.
+     */
+    double unix_time;
+    unsigned char uid[6];
+    /*!
+     Set by the decoder. Not used by RangeData.
+     */
+    bool flag;
+    union {
+        struct {
+            unsigned char settings[6];
+            struct {
+                float a;
+                float b;
+                float c;
+                float d;
+            } coefficients;
+        } info;
+        struct {
+            /*!
+             Temperature (in F).
+             */
+            float temperature;
+        } sample;
+    } payload;
+} range_frame_t;
+
+#endif /* RangeTypes_h */
@@ -30,9 +30,94 @@ var PLUGIN_NAME = 'RangeReader';
  * @constructor
  */
 var RangeReader = {
+  /**
+   * Every sample of every Range.
+   * cb gets {cursor: {uid: time}, ranges: {uid: [{time: seconds since 1970, temperature: raw degrees F}]}}
+   */
   read: function (cb, ecb) {
-    exec(cb, ecb, PLUGIN_NAME, 'allRangeData');
+    exec(function (answer) {
+      cb(JSON.parse(answer));
+    }, ecb, PLUGIN_NAME, 'allRangeData');
+  },
+
+  /**
+   * Only the samples that came in after cursor, the cursor from the last answer (null the first time).
+   * cb gets the same as read, with just the new samples. Pass its cursor to the next call.
+   */
+  readSince: function (cursor, cb, ecb) {
+    exec(function (answer) {
+      cb(JSON.parse(answer));
+    }, ecb, PLUGIN_NAME, 'readSince', [cursor || null]);
+  },
+
+  /**
+   * readSince with the samples in typed arrays instead of objects, for charts.
+   * cb gets {cursor: {uid: time}, ranges: {uid: {times: Float64Array, temperatures: Float32Array}}}
+   * The arrays are views on the buffer the native side sent, nothing is copied.
+   */
+  readBinarySince: function (cursor, cb, ecb) {
+    exec(function (buffer) {
+      var answer = unpackSamples(buffer, cursor);
+      if (answer === null) {
+        if (ecb) {
+          ecb('Unknown RangeReader binary format.');
+        }
+        return;
+      }
+      cb(answer);
+    }, ecb, PLUGIN_NAME, 'readBinarySince', [cursor || null]);
+  }
+}
+
+// The layout is described in RangeReader.h.
+var BINARY_VERSION = 1;
+var BINARY_HEADER_LENGTH = 16;
+var BINARY_RANGE_HEADER_LENGTH = 16;
+
+function padTo8(offset) {
+  return (offset + 7) & ~7;
+}
+
+function decodeUtf8(bytes) {
+  if (typeof TextDecoder !== 'undefined') {
+    return new TextDecoder('utf-8').decode(bytes);
+  }
+  return decodeURIComponent(escape(String.fromCharCode.apply(null, bytes)));
+}
+
+function unpackSamples(buffer, cursor) {
+  var view = new DataView(buffer);
+  if (buffer.byteLength < BINARY_HEADER_LENGTH ||
+      String.fromCharCode(view.getUint8(0), view.getUint8(1), view.getUint8(2), view.getUint8(3)) !== 'RNGB' ||
+      view.getUint16(4, true) !== BINARY_VERSION) {
+    return null;
+  }
+
+  var answer = { cursor: {}, ranges: {} };
+  var uid;
+  for (uid in (cursor || {})) {
+    answer.cursor[uid] = cursor[uid];
+  }
+
+  var rangeCount = view.getUint16(6, true);
+  var offset = BINARY_HEADER_LENGTH;
+  for (var i = 0; i < rangeCount; i++) {
+    var count = view.getUint32(offset, true);
+    var uidLength = view.getUint32(offset + 4, true);
+    var newest = view.getFloat64(offset + 8, true);
+    offset += BINARY_RANGE_HEADER_LENGTH;
+    uid = decodeUtf8(new Uint8Array(buffer, offset, uidLength));
+    offset = padTo8(offset + uidLength);
+
+    var times = new Float64Array(buffer, offset, count);
+    offset += 8 * count;
+    var temperatures = new Float32Array(buffer, offset, count);
+    offset = padTo8(offset + 4 * count);
+
+    answer.ranges[uid] = { times: times, temperatures: temperatures };
+    answer.cursor[uid] = newest;
   }
+  return answer;
 }
 
 module.exports = RangeReader;
\ No newline at end of file